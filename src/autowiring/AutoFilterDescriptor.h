@@ -6,6 +6,7 @@
 #include "AutoFilterArgument.h"
 #include "CallExtractor.h"
 #include "Decompose.h"
+#include "filter_instruments.h"
 #include "has_autofilter.h"
 #include "is_shared_ptr.h"
 #include MEMORY_HEADER
@@ -217,11 +218,16 @@ protected:
   // A hold on the enclosed autoFilter
   AnySharedPointer m_autoFilter;
 
+  // Instruments attached by the packet factory this AutoFilter is registered with, not owned
+  autowiring::filter_instruments* m_pInstruments = nullptr;
+
 public:
   // Accessor methods:
   bool empty(void) const { return !m_pCall || m_autoFilter.empty(); }
   AnySharedPointer& GetAutoFilter(void) { return m_autoFilter; }
   const AnySharedPointer& GetAutoFilter(void) const { return m_autoFilter; }
+  autowiring::filter_instruments* GetInstruments(void) const { return m_pInstruments; }
+  void SetInstruments(autowiring::filter_instruments* pInstruments) { m_pInstruments = pInstruments; }
 
   /// <summary>
   /// Releases the bound subscriber and the corresponding arity, causing it to become disabled
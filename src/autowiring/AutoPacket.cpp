@@ -36,29 +36,18 @@ AutoPacket::~AutoPacket(void) {
     )
   );
 
-  // Mark decorations of successor packets that use decorations
-  // originating from this packet as unsatisfiable
-  for (auto& pair : m_decoration_map)
-    if (!pair.first.tshift && pair.second.m_state != DispositionState::Complete)
-      MarkSuccessorsUnsatisfiable(DecorationKey(pair.first.id, 0));
+  // Abandoned packets were already released when they were abandoned
+  if (m_admitted && !m_abandoned)
+    m_parentFactory->ReleaseAdmission();
+
+  // Complete entries for any timeshifted types this packet never decorated, successors that are
+  // waiting on them will see those decorations as unsatisfiable
+  for (auto& entry : m_timeshiftEntries)
+    CompleteTimeshiftEntry(*entry, AnySharedPointer());
 
   // Needed for the AutoPacketGraph
   NotifyTeardownListeners();
 
-  // Create vector of all successor packets that will be destroyed
-  // This prevents recursive AutoPacket destructor calls
-  std::vector<std::shared_ptr<AutoPacket>> packets;
-
-  // Recurse through unique successors, storing them in our vector
-  for (AutoPacket* current = this; current->m_successor.unique();) {
-    packets.push_back(current->m_successor);
-
-    // Reset and continue to next successor
-    AutoPacket* prev_current = current;
-    current = current->m_successor.get();
-    prev_current->m_successor.reset();
-  }
-
   // Safe linked list unwind
   for (auto cur = m_firstCounter; cur;) {
     auto next = cur->flink;
@@ -85,15 +74,70 @@ DecorationDisposition& AutoPacket::DecorateImmediateUnsafe(const DecorationKey&
   return dec;
 }
 
+void AutoPacket::DecorateImmediateSingle(const DecorationKey& key, const void* pvImmed) {
+  // Largest number of subscribers that will be invoked directly, larger sets take the general path
+  static const size_t c_maxDirectCalls = 8;
+
+  std::unique_lock<std::mutex> lk(m_lock);
+  auto q = m_decoration_map.find(key);
+  if (q == m_decoration_map.end()) {
+    // Nobody subscribes to this type, it only needs to be recorded as spent
+    m_decoration_map[key].m_state = DispositionState::Complete;
+    return;
+  }
+
+  // Subscribers were gathered on this entry when the packet was initialized.  Each of them can be called
+  // directly if this decoration is the only thing it is still waiting for; anything else requires the
+  // unsatisfiable outputs of uncalled subscribers to be propagated, which is the job of the general path.
+  DecorationDisposition& dec = q->second;
+  const DecorationDisposition::Subscriber* calls[c_maxDirectCalls];
+  size_t nCalls = 0;
+  bool direct =
+    dec.m_state == DispositionState::Unsatisfied &&
+    dec.m_modifiers.empty() &&
+    dec.m_subscribers.size() <= c_maxDirectCalls;
+  for (auto sub = dec.m_subscribers.begin(); direct && sub != dec.m_subscribers.end(); ++sub) {
+    direct =
+      sub->type == DecorationDisposition::Subscriber::Type::Normal &&
+      !sub->is_shared &&
+      !sub->satCounter->IsDeferred() &&
+      sub->satCounter->remaining == 1;
+    calls[nCalls++] = &*sub;
+  }
+
+  if (!direct) {
+    DecorationDisposition* pTypeSubs[] = { &DecorateImmediateUnsafe(key, pvImmed) };
+    MakeAtExit([this, &key, &pTypeSubs] {
+      pTypeSubs[0]->m_pImmediate = nullptr;
+      pTypeSubs[0]->m_state = DispositionState::Complete;
+      MarkUnsatisfiable(key);
+    }),
+    PulseSatisfactionUnsafe(std::move(lk), pTypeSubs, 1);
+    return;
+  }
+
+  for (size_t i = 0; i < nCalls; i++) {
+    calls[i]->satCounter->remaining = 0;
+    calls[i]->satCounter->RecordDelivery(calls[i]->argIndex);
+  }
+  dec.m_state = DispositionState::Complete;
+  dec.m_pImmediate = pvImmed;
+  lk.unlock();
+
+  // The immediate value is only valid for the duration of this call
+  auto cleanup = MakeAtExit([this, &dec] {
+    (std::lock_guard<std::mutex>)m_lock,
+    dec.m_pImmediate = nullptr;
+  });
+  for (size_t i = 0; i < nCalls; i++)
+    calls[i]->satCounter->Call(*this);
+}
+
 void AutoPacket::AddSatCounterUnsafe(SatCounter& satCounter) {
   for(auto pCur = satCounter.GetAutoFilterArguments(); *pCur; pCur++) {
     DecorationKey key(pCur->id, pCur->tshift);
     DecorationDisposition& entry = m_decoration_map[key];
 
-    // Make sure decorations exist for timeshifts less that key's timeshift
-    for (int tshift = 0; tshift < key.tshift; ++tshift)
-      m_decoration_map[DecorationKey(key.id, tshift)];
-
     // Decide what to do with this entry:
     if (pCur->is_input) {
       if (entry.m_publishers.size() > 1 && !pCur->is_multi) {
@@ -105,6 +149,8 @@ void AutoPacket::AddSatCounterUnsafe(SatCounter& satCounter) {
         // Either decorations must be present, or the decoration type must be a shared_ptr.
         if (!entry.m_decorations.empty() || pCur->is_shared) {
           satCounter.Decrement();
+          if (!entry.m_decorations.empty())
+            satCounter.RecordDelivery(pCur - satCounter.GetAutoFilterArguments());
         }
       }
     }
@@ -124,7 +170,7 @@ void AutoPacket::AddSatCounterUnsafe(SatCounter& satCounter) {
           break;
         it++;
       }
-      entry.m_modifiers.emplace(it, pCur->is_shared, satCounter.GetAltitude(), &satCounter);
+      entry.m_modifiers.emplace(it, pCur->is_shared, satCounter.GetAltitude(), &satCounter, pCur - satCounter.GetAutoFilterArguments());
     } else {
       if (pCur->is_input) {
         entry.m_subscribers.emplace(
@@ -135,7 +181,8 @@ void AutoPacket::AddSatCounterUnsafe(SatCounter& satCounter) {
           DecorationDisposition::Subscriber::Type::Optional :
           DecorationDisposition::Subscriber::Type::Normal,
           satCounter.GetAltitude(),
-          &satCounter
+          &satCounter,
+          pCur - satCounter.GetAutoFilterArguments()
         );
       }
 
@@ -253,19 +300,38 @@ void AutoPacket::MarkUnsatisfiable(const DecorationKey& key) {
   UpdateSatisfactionUnsafe(std::move(lk), entry);
 }
 
-void AutoPacket::MarkSuccessorsUnsatisfiable(DecorationKey key) {
-  std::lock_guard<std::mutex> lk(m_lock);
+void AutoPacket::MarkUnsatisfiableIfAbsent(const DecorationKey& key) {
+  std::unique_lock<std::mutex> lk(m_lock);
+  auto& entry = m_decoration_map[key];
+  if (entry.m_state == DispositionState::Complete || !entry.m_decorations.empty())
+    return;
 
-  // Update key and successor
-  key.tshift++;
-  auto successor = SuccessorUnsafe();
+  // One more producer run, even though it did not attach anything
+  if (entry.IncProducerCount())
+    UpdateSatisfactionUnsafe(std::move(lk), entry);
+}
 
-  while (m_decoration_map.count(key)) {
-    successor->MarkUnsatisfiable(key);
+void AutoPacket::CompleteTimeshiftEntry(timeshift_entry& entry, const AnySharedPointer& value) {
+  std::vector<std::pair<std::weak_ptr<AutoPacket>, int>> waiters;
+  {
+    std::lock_guard<std::mutex> lk(entry.lock);
+    if (entry.complete)
+      return;
+    entry.complete = true;
+    entry.value = value;
+    waiters.swap(entry.waiters);
+  }
+
+  for (auto& waiter : waiters) {
+    auto packet = waiter.first.lock();
+    if (!packet)
+      continue;
 
-    // Update key and successor
-    key.tshift++;
-    successor = successor->Successor();
+    DecorationKey key(entry.id, waiter.second);
+    if (value)
+      packet->DecorateNoPriors(value, key);
+    else
+      packet->MarkUnsatisfiable(key);
   }
 }
 
@@ -302,13 +368,15 @@ void AutoPacket::UpdateSatisfactionUnsafe(std::unique_lock<std::mutex> lk, const
       continue;
     auto& satCounter = *modifier.satCounter;
     if (modifier.is_shared) {
+      if (!disposition.m_decorations.empty())
+        satCounter.RecordDelivery(modifier.argIndex);
       if (satCounter.Decrement()) {
         lk.unlock();
         callQueue.push_back(&satCounter);
         {
           AutoCurrentPacketPusher apkt(*this);
           for (SatCounter* call : callQueue)
-            call->GetCall()(call->GetAutoFilter().ptr(), *this);
+            call->Call(*this);
         }
         callQueue.clear();
         lk.lock();
@@ -319,6 +387,7 @@ void AutoPacket::UpdateSatisfactionUnsafe(std::unique_lock<std::mutex> lk, const
         markOutputsUnsat(satCounter);
         break;
       case 1:
+        satCounter.RecordDelivery(modifier.argIndex);
         if (satCounter.Decrement())
           callQueue.push_back(&satCounter);
         break;
@@ -359,6 +428,7 @@ void AutoPacket::UpdateSatisfactionUnsafe(std::unique_lock<std::mutex> lk, const
     // One unique decoration available.  We should be able to call everyone.
     for (auto subscriber : disposition.m_subscribers) {
       auto& satCounter = *subscriber.satCounter;
+      satCounter.RecordDelivery(subscriber.argIndex);
       if (satCounter.Decrement())
         callQueue.push_back(&satCounter);
     }
@@ -371,6 +441,7 @@ void AutoPacket::UpdateSatisfactionUnsafe(std::unique_lock<std::mutex> lk, const
         throw autowiring_error("An AutoFilter was detected which has single-decorate inputs in a graph with multi-decorate outputs");
 
       // One more entry for this input to consider
+      subscriber.satCounter->RecordDelivery(subscriber.argIndex);
       if(subscriber.satCounter->Decrement())
         callQueue.push_back(subscriber.satCounter);
     }
@@ -382,7 +453,7 @@ void AutoPacket::UpdateSatisfactionUnsafe(std::unique_lock<std::mutex> lk, const
   {
     AutoCurrentPacketPusher apkt(*this);
     for (SatCounter* call : callQueue)
-      call->GetCall()(call->GetAutoFilter().ptr(), *this);
+      call->Call(*this);
   }
 
   // Mark all unsatisfiable output types
@@ -441,10 +512,17 @@ void AutoPacket::PulseSatisfactionUnsafe(std::unique_lock<std::mutex> lk, Decora
     for (auto& cur : reincrement)
       cur->Increment();
 
+    // Every immediate decoration taken by a counter that is about to be called was delivered to it
+    if (!callQueue.empty())
+      for (size_t i = nInfos; i--;)
+        for (const auto& cur : pTypeSubs[i]->m_subscribers)
+          if (!cur.is_shared && std::find(callQueue.begin(), callQueue.end(), cur.satCounter) != callQueue.end())
+            cur.satCounter->RecordDelivery(cur.argIndex);
+
     // Run through calls while unsynchronized:
     lk.unlock();
     for (SatCounter* call : callQueue) {
-      call->GetCall()(call->GetAutoFilter().ptr(), *this);
+      call->Call(*this);
       call->remaining = 0;
     }
     lk.lock();
@@ -482,28 +560,34 @@ void AutoPacket::DecorateNoPriors(const AnySharedPointer& ptr, DecorationKey key
   }
 
   // Decoration attaches here, if it is non-null
-  if(ptr)
+  if(ptr) {
     disposition->m_decorations.push_back(ptr);
+
+    // Credit the instrumented filter making this decoration, if there is one
+    if (!key.tshift)
+      if (filter_instruments* pInstruments = filter_instruments::current())
+        if (pInstruments->is_counting())
+          pInstruments->record_output(key.id);
+  }
   if(disposition->IncProducerCount())
     UpdateSatisfactionUnsafe(std::move(lk), *disposition);
 }
 
 void AutoPacket::Decorate(const AnySharedPointer& ptr, DecorationKey key) {
-  auto cur = shared_from_this();
-
-  do {
-    // Update satisfaction set on this entry
-    cur->DecorateNoPriors(ptr, key);
-
-    // Obtain the successor
-    cur = cur->Successor();
-    key.tshift++;
-  } while (
-    // If there are any filters on _this_ packet that desire to know the prior packet, then
-    // we must proactively preserve the value of this decoration for our successor.
-    (std::lock_guard<std::mutex>)m_lock,
-    m_decoration_map.count(key)
-  );
+  DecorateNoPriors(ptr, key);
+
+  // If later packets read this type with a timeshift, they obtain it from our entry
+  std::shared_ptr<timeshift_entry> entry;
+  {
+    std::lock_guard<std::mutex> lk(m_lock);
+    for (auto& cur : m_timeshiftEntries)
+      if (cur->id == key.id) {
+        entry = cur;
+        break;
+      }
+  }
+  if (entry)
+    CompleteTimeshiftEntry(*entry, ptr);
 }
 
 void AutoPacket::RemoveDecoration(DecorationKey key) {
@@ -631,7 +715,7 @@ const SatCounter* AutoPacket::AddRecipient(const AutoFilterDescriptor& descripto
 
   if (!sat.remaining)
     // Filter is ready to be called, oblige it
-    sat.GetCall()(sat.GetAutoFilter().ptr(), *this);
+    sat.Call(*this);
 
   return &sat;
 }
@@ -648,17 +732,7 @@ void AutoPacket::RemoveRecipient(const SatCounter& recipient) {
 }
 
 std::shared_ptr<AutoPacket> AutoPacket::Successor(void) {
-  std::lock_guard<std::mutex> lk(m_lock);
-  return SuccessorUnsafe();
-}
-
-std::shared_ptr<AutoPacket> AutoPacket::SuccessorUnsafe(void) {
-  // If successor doesn't already exists, create it
-  if (!m_successor){
-    m_successor = m_parentFactory->ConstructPacket();
-  }
-
-  return m_successor;
+  return m_parentFactory->GetSuccessor(static_cast<AutoPacketInternal&>(*this));
 }
 
 AutoPacket* AutoPacket::SetCurrent(AutoPacket* apkt) {
@@ -13,6 +13,8 @@
 #include "is_shared_ptr.h"
 #include "noop.h"
 #include "TeardownNotifier.h"
+#include "timeshift_ring.h"
+#include <atomic>
 #include <typeinfo>
 #include <unordered_set>
 #include CHRONO_HEADER
@@ -20,6 +22,7 @@
 #include STL_UNORDERED_MAP
 #include MUTEX_HEADER
 
+class AutoPacket;
 class AutoPacketInternal;
 class AutoPacketFactory;
 class CoreContext;
@@ -35,6 +38,17 @@ namespace autowiring {
 
   template<class T>
   class auto_arg;
+
+  /// <summary>
+  /// Awaitable returned by AutoPacket::Await
+  /// </summary>
+  /// <remarks>
+  /// Include autowiring/coroutine.h in order to co_await this type
+  /// </remarks>
+  template<class T>
+  struct packet_await {
+    AutoPacket& packet;
+  };
 }
 
 /// <summary>
@@ -67,8 +81,15 @@ protected:
   // A pointer back to the factory that created us. Used for recording lifetime statistics.
   const std::shared_ptr<AutoPacketFactory> m_parentFactory;
 
-  // The successor to this packet
+  // The successor to this packet, guarded by the factory's lock.  A successor is created only if
+  // one is requested before it is issued, and is held here only until it is issued; afterwards,
+  // only a weak reference is kept so that issued packets never keep one another alive.
   std::shared_ptr<AutoPacketInternal> m_successor;
+  std::weak_ptr<AutoPacketInternal> m_issuedSuccessor;
+  bool m_successorIssued = false;
+
+  // Entries for timeshifted types, completed by this packet and read by its successors
+  std::vector<std::shared_ptr<autowiring::timeshift_entry>> m_timeshiftEntries;
 
   // Hold the time point at which this packet was last initalized.
   std::chrono::high_resolution_clock::time_point m_initTime;
@@ -76,6 +97,11 @@ protected:
   // Outstanding count local and remote holds:
   const std::shared_ptr<void> m_outstanding;
 
+  // Set by the factory if this packet counts against the factory's outstanding limit, and set if
+  // this packet was abandoned to make room for a newer packet
+  bool m_admitted = false;
+  std::atomic<bool> m_abandoned{false};
+
   // Pointer to a forward linked list of saturation counters, constructed when the packet is created
   autowiring::SatCounter* m_firstCounter = nullptr;
 
@@ -93,6 +119,21 @@ protected:
   /// </remarks>
   autowiring::DecorationDisposition& DecorateImmediateUnsafe(const autowiring::DecorationKey& key, const void* pvImmed);
 
+  /// <summary>
+  /// Immediately decorates this packet with a single type
+  /// </summary>
+  /// <remarks>
+  /// When every subscriber to the type is a non-deferred AutoFilter waiting only on this decoration, the
+  /// subscribers are invoked directly in altitude order.  The decoration map is not touched beyond the
+  /// decorated entry, and the packet lock is held only briefly before and after the calls.  All other
+  /// cases fall back to a satisfaction pulse.
+  ///
+  /// This path only avoids the generic dispatch, it does not avoid the packet lock.  The lock is taken on
+  /// every call, including when the type has no subscribers, because the entry must still be recorded as
+  /// spent so that a later decoration of the same type is rejected.
+  /// </remarks>
+  void DecorateImmediateSingle(const autowiring::DecorationKey& key, const void* pvImmed);
+
   /// <summary>
   /// Adds all AutoFilter argument information for a recipient
   /// </summary>
@@ -112,9 +153,14 @@ protected:
   void MarkUnsatisfiable(const autowiring::DecorationKey& key);
 
   /// <summary>
-  /// Marks timeshifted decorations on successor packets as unsatisfiable
+  /// Completes a timeshift entry and decorates every packet waiting on it
   /// </summary>
-  void MarkSuccessorsUnsatisfiable(autowiring::DecorationKey type);
+  /// <param name="value">The decoration, or an empty pointer if the type was never decorated</param>
+  /// <remarks>
+  /// Only the first call for a given entry has any effect.  Waiting packets are decorated with the
+  /// value, or have the decoration marked unsatisfiable if the value is empty.
+  /// </remarks>
+  static void CompleteTimeshiftEntry(autowiring::timeshift_entry& entry, const AnySharedPointer& value);
 
   /// <summary>
   /// Updates subscriber statuses given that the specified type information has been satisfied
@@ -150,11 +196,6 @@ protected:
   /// <summary>Runtime counterpart to RemoveDecoration</summary>
   void RemoveDecoration(autowiring::DecorationKey key);
 
-  /// <summary>
-  /// The portion of Successor that must run under a lock
-  /// </summary>
-  std::shared_ptr<AutoPacket> SuccessorUnsafe(void);
-
   /// <summary>
   /// Retrieves the decoration disposition corresponding to some type
   /// </summary>
@@ -184,6 +225,15 @@ protected:
   static void ThrowMultiplyDecoratedException(const autowiring::DecorationKey& key);
 
 public:
+  /// <returns>
+  /// True if this packet was abandoned by its factory to make room for a newer packet
+  /// </returns>
+  /// <remarks>
+  /// AutoFilters are not invoked on an abandoned packet.  Deferred AutoFilters that were already
+  /// pended when the packet was abandoned still run.
+  /// </remarks>
+  bool IsAbandoned(void) const { return m_abandoned.load(std::memory_order_relaxed); }
+
   /// <returns>
   /// The number of distinct decoration types on this packet (this is really an implementation-detail-based count
   /// of the parameters of all relevant filters, including lambdas appended to this packet).
@@ -457,6 +507,16 @@ public:
     MarkUnsatisfiable(autowiring::DecorationKey(auto_id_t<T>{}, 0));
   }
 
+  /// <summary>
+  /// Records that a producer of the specified decoration has concluded without attaching it, unless the
+  /// decoration is already present
+  /// </summary>
+  /// <remarks>
+  /// Used when a producer cannot tell whether it attached the decoration.  If the producer was the only
+  /// one outstanding, the decoration becomes unsatisfiable.
+  /// </remarks>
+  void MarkUnsatisfiableIfAbsent(const autowiring::DecorationKey& key);
+
   /// <summary>
 
   /// Decoration method specialized for shared pointer types
@@ -549,19 +609,35 @@ public:
   /// If multiple values are specified, all will be simultaneously made valid and
   /// then invalidated.
   /// </remarks>
-  template<class T, class... Ts>
-  void DecorateImmediate(const T& immed, const Ts&... immeds) {
+  template<class T>
+  void DecorateImmediate(const T& immed) {
+    static_assert(
+      !autowiring::is_shared_ptr<T>::value,
+      "DecorateImmediate must not be used to attach a shared pointer, use Decorate on such a decoration instead"
+    );
+    DecorateImmediateSingle(autowiring::DecorationKey(auto_id_t<T>(), 0), &immed);
+  }
+
+  /// <summary>
+  /// Multi-type counterpart of DecorateImmediate
+  /// </summary>
+  /// <remarks>
+  /// All values are made valid simultaneously, so that AutoFilters taking several of them are invoked.
+  /// </remarks>
+  template<class T, class T2, class... Ts>
+  void DecorateImmediate(const T& immed, const T2& immed2, const Ts&... immeds) {
     // None of the inputs may be shared pointers--if any of the inputs are shared pointers, they must be attached
     // to this packet via Decorate, or else dereferenced and used that way.
     static_assert(
-      !autowiring::is_any<autowiring::is_shared_ptr<T>::value, autowiring::is_shared_ptr<Ts>::value...>::value,
+      !autowiring::is_any<autowiring::is_shared_ptr<T>::value, autowiring::is_shared_ptr<T2>::value, autowiring::is_shared_ptr<Ts>::value...>::value,
       "DecorateImmediate must not be used to attach a shared pointer, use Decorate on such a decoration instead"
     );
 
     // Perform standard decoration with a short initialization:
     std::unique_lock<std::mutex> lk(m_lock);
-    autowiring::DecorationDisposition* pTypeSubs[1 + sizeof...(Ts)] = {
+    autowiring::DecorationDisposition* pTypeSubs[2 + sizeof...(Ts)] = {
       &DecorateImmediateUnsafe(autowiring::DecorationKey(auto_id_t<T>(), 0), &immed),
+      &DecorateImmediateUnsafe(autowiring::DecorationKey(auto_id_t<T2>(), 0), &immed2),
       &DecorateImmediateUnsafe(autowiring::DecorationKey(auto_id_t<Ts>(), 0), &immeds)...
     };
 
@@ -577,10 +653,11 @@ public:
       // Now trigger a rescan to hit any deferred, unsatisfiable entries:
       autowiring::noop(
         (MarkUnsatisfiable(autowiring::DecorationKey(auto_id_t<T>(), 0)), false),
+        (MarkUnsatisfiable(autowiring::DecorationKey(auto_id_t<T2>(), 0)), false),
         (MarkUnsatisfiable(autowiring::DecorationKey(auto_id_t<Ts>(), 0)), false)...
       );
     }),
-    PulseSatisfactionUnsafe(std::move(lk), pTypeSubs, 1 + sizeof...(Ts));
+    PulseSatisfactionUnsafe(std::move(lk), pTypeSubs, 2 + sizeof...(Ts));
   }
 
   /// <summary>
@@ -629,6 +706,19 @@ public:
     return *this;
   }
 
+  /// <summary>
+  /// Produces an awaitable which resumes the awaiting coroutine when T is attached to this packet
+  /// </summary>
+  /// <remarks>
+  /// "co_await packet.Await<T>()" evaluates to a reference to the decoration.  The coroutine is resumed
+  /// on the thread that decorates the packet, or immediately if the decoration is already present.  If
+  /// T is marked unsatisfiable, or the packet is released without T, the co_await expression throws.
+  /// The caller is responsible for keeping the packet alive while the coroutine is suspended.  See
+  /// autowiring/coroutine.h.
+  /// </remarks>
+  template<class T>
+  autowiring::packet_await<T> Await(void) { return{ *this }; }
+
   /// <returns>A reference to the satisfaction counter for the specified type</returns>
   /// <remarks>
   /// If the type is not a subscriber GetSatisfaction().GetType() == nullptr will be true
@@ -639,6 +729,9 @@ public:
   /// <summary>
   /// Returns the next packet that will be issued by the packet factory in this context relative to this context
   /// </summary>
+  /// <remarks>
+  /// If the successor has already been issued and has since been destroyed, this method returns nullptr
+  /// </remarks>
   std::shared_ptr<AutoPacket> Successor(void);
 
   /// <returns>True if the indicated type has been requested for use by some consumer</returns>
@@ -4,6 +4,7 @@
 #include "AutoPacketInternal.hpp"
 #include "CoreContext.h"
 #include "SatCounter.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace autowiring;
@@ -26,34 +27,184 @@ std::shared_ptr<AutoPacket> AutoPacketFactory::CurrentPacket(void) {
 }
 
 std::shared_ptr<AutoPacket> AutoPacketFactory::NewPacket(void) {
+  return NewPacketInternal(nullptr);
+}
+
+std::shared_ptr<AutoPacket> AutoPacketFactory::NewPacketFor(std::chrono::nanoseconds timeout) {
+  return NewPacketInternal(&timeout);
+}
+
+std::shared_ptr<AutoPacket> AutoPacketFactory::NewPacketInternal(const std::chrono::nanoseconds* timeout) {
   std::shared_ptr<AutoPacketInternal> retVal;
-  bool isFirstPacket;
+  std::vector<std::shared_ptr<timeshift_entry>> produced;
+  std::vector<timeshift_read> consumed;
+
+  // Abandoned and prior packets, may only be released outside of the lock
+  std::shared_ptr<AutoPacketInternal> abandoned;
+  std::shared_ptr<AutoPacketInternal> prior;
   {
-    std::lock_guard<std::mutex> lk(m_lock);
+    std::unique_lock<std::mutex> lk(m_lock);
 
     if (ShouldStop())
       throw autowiring_error("Attempted to create a packet on an AutoPacketFactory that was already terminated");
     if (!IsRunning())
       throw autowiring_error("Cannot create a packet until the AutoPacketFactory is started");
+    if (!AdmitUnsafe(lk, timeout, abandoned))
+      return nullptr;
 
     // New packet issued
-    isFirstPacket = !m_packetCount;
     ++m_packetCount;
-
-    // Create a new next packet
-    retVal = m_nextPacket;
-    m_nextPacket = retVal->SuccessorInternal();
+    OpenTimeshiftEntriesUnsafe(produced, consumed);
+
+    // Issue the successor requested on the prior packet, if there was one
+    retVal = m_nextPacket ? std::move(m_nextPacket) : ConstructPacket();
+    prior = m_curPacket.lock();
+    if (prior)
+      prior->SetSuccessorIssuedUnsafe(retVal);
+    m_nextPacket = retVal->RequestedSuccessorUnsafe();
     m_curPacket = retVal;
+
+    retVal->SetAdmitted();
+    if (m_admissionPolicy == AdmissionPolicy::DropOldest)
+      TrackAdmissionUnsafe(retVal);
   }
 
-  retVal->Initialize(isFirstPacket);
+  retVal->Initialize(std::move(produced), consumed);
   return retVal;
 }
 
+bool AutoPacketFactory::AdmitUnsafe(std::unique_lock<std::mutex>& lk, const std::chrono::nanoseconds* timeout, std::shared_ptr<AutoPacketInternal>& abandoned) {
+  auto ready = [this] {
+    if (ShouldStop())
+      throw autowiring_error("AutoPacketFactory was terminated while waiting to issue a packet");
+    return m_admitted < m_outstandingLimit;
+  };
+
+  if (!ready()) {
+    // Only the Block policy waits in NewPacket, all policies wait in NewPacketFor
+    if (timeout || m_admissionPolicy == AdmissionPolicy::Block) {
+      ++m_nAdmissionWaiters;
+      auto cleanup = MakeAtExit([this] { --m_nAdmissionWaiters; });
+      if (timeout)
+        m_admissionCv.wait_for(lk, *timeout, ready);
+      else
+        m_admissionCv.wait(lk, ready);
+    }
+
+    if (!ready()) {
+      // No room was made, apply the admission policy
+      if (m_admissionPolicy == AdmissionPolicy::DropOldest)
+        abandoned = AbandonOldestUnsafe();
+      if (!abandoned) {
+        ++m_rejectedCount;
+        return false;
+      }
+    }
+  }
+
+  ++m_admitted;
+  return true;
+}
+
+void AutoPacketFactory::TrackAdmissionUnsafe(const std::shared_ptr<AutoPacketInternal>& packet) {
+  // Each expired entry pins the control block, and with it the storage, of a destroyed packet.
+  // The oldest packets are usually the first to go, so most entries can be dropped from the front.
+  while (!m_admissionOrder.empty() && m_admissionOrder.front().expired())
+    m_admissionOrder.pop_front();
+
+  // Packets released out of order leave entries behind in the middle.  There are never more live
+  // entries than admitted packets, so sweeping once expired entries could be in the majority keeps
+  // the queue proportional to the number of admitted packets at constant amortized cost.
+  if (m_admissionOrder.size() > 2 * m_admitted + 8)
+    m_admissionOrder.erase(
+      std::remove_if(
+        m_admissionOrder.begin(),
+        m_admissionOrder.end(),
+        [] (const std::weak_ptr<AutoPacketInternal>& entry) { return entry.expired(); }
+      ),
+      m_admissionOrder.end()
+    );
+
+  m_admissionOrder.push_back(packet);
+}
+
+std::shared_ptr<AutoPacketInternal> AutoPacketFactory::AbandonOldestUnsafe(void) {
+  while (!m_admissionOrder.empty()) {
+    auto packet = m_admissionOrder.front().lock();
+    m_admissionOrder.pop_front();
+
+    // Expired packets have already released their admission
+    if (packet && packet->Abandon()) {
+      --m_admitted;
+      ++m_abandonedCount;
+      return packet;
+    }
+  }
+  return nullptr;
+}
+
+void AutoPacketFactory::ReleaseAdmission(void) {
+  --m_admitted;
+
+  // The lock is only needed to avoid a lost wakeup, and only if someone is actually waiting
+  if (m_nAdmissionWaiters)
+    std::lock_guard<std::mutex>{m_lock},
+    m_admissionCv.notify_all();
+}
+
+void AutoPacketFactory::SetOutstandingLimit(size_t limit, AdmissionPolicy policy) {
+  std::lock_guard<std::mutex> lk(m_lock);
+  m_outstandingLimit = limit;
+  m_admissionPolicy = policy;
+  if (policy != AdmissionPolicy::DropOldest)
+    m_admissionOrder.clear();
+
+  // A higher limit may admit waiting packets
+  m_admissionCv.notify_all();
+}
+
+size_t AutoPacketFactory::GetOutstandingLimit(void) const {
+  std::lock_guard<std::mutex> lk(m_lock);
+  return m_outstandingLimit;
+}
+
+AdmissionPolicy AutoPacketFactory::GetAdmissionPolicy(void) const {
+  std::lock_guard<std::mutex> lk(m_lock);
+  return m_admissionPolicy;
+}
+
+void AutoPacketFactory::OpenTimeshiftEntriesUnsafe(std::vector<std::shared_ptr<timeshift_entry>>& produced, std::vector<timeshift_read>& consumed) {
+  const uint64_t serial = m_nextSerial++;
+  for (auto& cur : m_timeshiftHistory) {
+    auto& history = cur.second;
+
+    // Earlier entries are looked up before our own entry can evict any of them
+    for (auto& shift : history.shifts) {
+      const int tshift = shift.first;
+      consumed.push_back({
+        cur.first,
+        tshift,
+        (uint64_t)tshift <= serial ? history.ring.find(serial - tshift) : nullptr
+      });
+    }
+    produced.push_back(history.ring.open(cur.first, serial));
+  }
+}
+
 std::shared_ptr<AutoPacketInternal> AutoPacketFactory::ConstructPacket(void) {
   return std::make_shared<AutoPacketInternal>(*this, GetInternalOutstanding());
 }
 
+std::shared_ptr<AutoPacket> AutoPacketFactory::GetSuccessor(AutoPacketInternal& packet) {
+  std::lock_guard<std::mutex> lk(m_lock);
+  auto retVal = packet.SuccessorUnsafe();
+
+  // The successor of the most recently issued packet is the next packet to be issued
+  if (packet.IsCurrentUnsafe())
+    m_nextPacket = retVal;
+  return retVal;
+}
+
 bool AutoPacketFactory::IsAutoPacketType(const std::type_info& dataType) {
   return
     dataType == typeid(AutoPacket) ||
@@ -72,9 +223,13 @@ std::shared_ptr<void> AutoPacketFactory::GetInternalOutstanding(void) {
     [this, outstanding] (void*) mutable {
       // Weak pointer will prevent our lambda from being destroyed, so we manually reset
       // the outstanding counter in order to force it to be reset here
-      std::lock_guard<std::mutex>{m_lock},
+      std::lock_guard<std::mutex> lk(m_lock);
       outstanding.reset();
 
+      // No packet remains that could refer to retired instruments, unless one was issued since
+      if (m_outstandingInternal.expired())
+        m_retiredInstruments.clear();
+
       // Now we might be ready to wake up, if anyone was waiting on this factory
       m_cv.notify_all();
     }
@@ -111,10 +266,17 @@ SatCounter* AutoPacketFactory::CreateSatCounterList(void) const {
   return retVal;
 }
 
+std::shared_ptr<filter_instruments> AutoPacketFactory::SubscribeDeliveries(const AutoFilterDescriptor& autoFilter) {
+  std::lock_guard<std::mutex> lk(m_lock);
+  auto q = m_instruments.find(autoFilter);
+  if (q == m_instruments.end())
+    return nullptr;
+
+  q->second->nDeliverySubscribers++;
+  return q->second;
+}
+
 bool AutoPacketFactory::OnStart(void) {
-  // Initialize first packet
-  std::lock_guard<std::mutex>{m_lock},
-  m_nextPacket = ConstructPacket();
   return true;
 }
 
@@ -122,11 +284,24 @@ void AutoPacketFactory::OnStop(bool graceful) {
   // Queue of local variables to be destroyed when leaving scope
   t_autoFilterSet autoFilters;
   std::shared_ptr<AutoPacketInternal> nextPacket;
+  std::unordered_map<auto_id, TimeshiftHistory> timeshiftHistory;
 
   // Lock destruction precedes local variables
   std::lock_guard<std::mutex>{m_lock},
     autoFilters.swap(m_autoFilters),
-    nextPacket.swap(m_nextPacket);
+    nextPacket.swap(m_nextPacket),
+    timeshiftHistory.swap(m_timeshiftHistory),
+    m_admissionOrder.clear(),
+    RetireInstrumentsUnsafe();
+
+  // Callers waiting for admission must be told that no more packets will be issued
+  m_admissionCv.notify_all();
+}
+
+void AutoPacketFactory::RetireInstrumentsUnsafe(void) {
+  for (auto& entry : m_instruments)
+    m_retiredInstruments.push_back(std::move(entry.second));
+  m_instruments.clear();
 }
 
 void AutoPacketFactory::DoAdditionalWait(void) {
@@ -157,7 +332,29 @@ void AutoPacketFactory::Clear(void) {
 
 const AutoFilterDescriptor& AutoPacketFactory::AddSubscriber(const AutoFilterDescriptor& rhs) {
   std::lock_guard<std::mutex> lk(m_lock);
-  m_autoFilters.insert(rhs);
+
+  // Instruments are created once per AutoFilter, and the descriptor we keep points to them
+  auto& instruments = m_instruments[rhs];
+  if (instruments)
+    // Already registered
+    return rhs;
+
+  instruments = std::make_shared<filter_instruments>(rhs.GetAutoFilterArguments(), rhs.GetArity());
+  instruments->timing = m_latencyEnabled.load();
+
+  AutoFilterDescriptor autoFilter = rhs;
+  autoFilter.SetInstruments(instruments.get());
+  m_autoFilters.insert(autoFilter);
+
+  // Timeshifted inputs need enough history to reach back to the packet they read from
+  for (auto pCur = rhs.GetAutoFilterArguments(); pCur && *pCur; pCur++) {
+    if (!pCur->tshift)
+      continue;
+
+    auto& history = m_timeshiftHistory[pCur->id];
+    history.shifts[pCur->tshift]++;
+    history.ring.reserve(pCur->tshift);
+  }
   return rhs;
 }
 
@@ -165,6 +362,34 @@ void AutoPacketFactory::RemoveSubscriber(const AutoFilterDescriptor& autoFilter)
   // Trivial removal from the autofilter set:
   std::lock_guard<std::mutex> lk(m_lock);
   m_autoFilters.erase(autoFilter);
+
+  auto q = m_instruments.find(autoFilter);
+  if (q == m_instruments.end())
+    // Not registered, or already removed
+    return;
+  m_retiredInstruments.push_back(std::move(q->second));
+  m_instruments.erase(q);
+
+  // History is only kept as far back as the remaining readers need it
+  for (auto pCur = autoFilter.GetAutoFilterArguments(); pCur && *pCur; pCur++) {
+    if (!pCur->tshift)
+      continue;
+
+    auto history = m_timeshiftHistory.find(pCur->id);
+    if (history == m_timeshiftHistory.end())
+      continue;
+
+    auto& shifts = history->second.shifts;
+    auto shift = shifts.find(pCur->tshift);
+    if (shift != shifts.end() && !--shift->second)
+      shifts.erase(shift);
+
+    if (shifts.empty())
+      // Nobody reads this type with a timeshift anymore, new packets need not record it
+      m_timeshiftHistory.erase(history);
+    else
+      history->second.ring.shrink(shifts.rbegin()->first);
+  }
 }
 
 void AutoPacketFactory::operator-=(const AutoFilterDescriptor& desc) {
@@ -181,11 +406,15 @@ AutoFilterDescriptor AutoPacketFactory::GetTypeDescriptorUnsafe(auto_id nodeType
 }
 
 size_t AutoPacketFactory::GetOutstandingPacketCount(void) const {
-  // Next packet is stored internally, don't count that packet
-  return m_outstandingInternal.use_count() - 1;
+  // A successor that was requested ahead of its issue is stored internally, don't count that packet
+  std::lock_guard<std::mutex> lk(m_lock);
+  return m_outstandingInternal.use_count() - (m_nextPacket ? 1 : 0);
 }
 
 void AutoPacketFactory::RecordPacketDuration(std::chrono::nanoseconds duration) {
+  if (m_latencyEnabled.load(std::memory_order_relaxed))
+    m_packetLatency.record(duration);
+
   std::unique_lock<std::mutex> lk(m_lock);
   m_packetDurationSum += duration.count();
   m_packetDurationSqSum += duration.count() * duration.count();
@@ -206,6 +435,42 @@ void AutoPacketFactory::ResetPacketStatistics(void) {
   m_packetCount = 0;
   m_packetDurationSum = 0.0;
   m_packetDurationSqSum = 0.0;
+  m_rejectedCount = 0;
+  m_abandonedCount = 0;
+  m_packetLatency.reset();
+  for (auto& entry : m_instruments)
+    entry.second->latency.reset();
+}
+
+void AutoPacketFactory::EnableLatencyHistograms(bool enable) {
+  std::lock_guard<std::mutex> lk(m_lock);
+  if (m_latencyEnabled == enable)
+    return;
+  m_latencyEnabled = enable;
+
+  for (auto& entry : m_instruments) {
+    entry.second->timing = enable;
+    if (!enable)
+      entry.second->latency.reset();
+  }
+  if (!enable)
+    m_packetLatency.reset();
+}
+
+std::vector<std::pair<AutoFilterDescriptor, latency_snapshot>> AutoPacketFactory::GetFilterLatencies(void) const {
+  std::vector<std::pair<AutoFilterDescriptor, std::shared_ptr<filter_instruments>>> instruments;
+  {
+    std::lock_guard<std::mutex> lk(m_lock);
+    if (m_latencyEnabled)
+      instruments.assign(m_instruments.begin(), m_instruments.end());
+  }
+
+  // Aggregation happens outside of the lock
+  std::vector<std::pair<AutoFilterDescriptor, latency_snapshot>> retVal;
+  retVal.reserve(instruments.size());
+  for (auto& entry : instruments)
+    retVal.emplace_back(entry.first, entry.second->latency.snapshot());
+  return retVal;
 }
 
 template struct autowiring ::SlotInformationStump<AutoPacketFactory, false>;
@@ -4,13 +4,38 @@
 #include "AutoFilterDescriptor.h"
 #include "ContextMember.h"
 #include "CoreRunnable.h"
+#include "latency_histogram.h"
+#include "timeshift_ring.h"
 #include "TypeRegistry.h"
 #include CHRONO_HEADER
 #include TYPE_TRAITS_HEADER
+#include STL_UNORDERED_MAP
+#include <atomic>
+#include <deque>
+#include <map>
 #include <set>
 
 class AutoPacketInternal;
 
+/// <summary>
+/// The action taken by an AutoPacketFactory when a packet is requested while the outstanding limit is reached
+/// </summary>
+enum class AdmissionPolicy {
+  // Wait until an outstanding packet is released
+  Block,
+
+  // Refuse to issue the requested packet
+  DropNewest,
+
+  // Abandon the oldest outstanding packet and issue the requested packet in its place.  An abandoned
+  // packet no longer counts against the limit and no further AutoFilters are invoked on it, but it is
+  // not torn down:  its decorations and satisfaction state are released only when the last reference
+  // to the packet is released, because AutoFilters already running on it may still refer to them.
+  // This policy therefore bounds the number of packets in flight through the pipeline, but memory is
+  // only bounded if whoever holds a packet, such as a pended deferred AutoFilter, releases it promptly.
+  DropOldest
+};
+
 /// <summary>
 /// A configurable factory class for pipeline packets with a built-in object pool
 /// </summary>
@@ -36,24 +61,106 @@ private:
   // The most recently issued packet:
   std::weak_ptr<AutoPacketInternal> m_curPacket;
 
-  // The next packet to be issued from this factory
+  // The next packet to be issued from this factory, present only if it was requested as the
+  // successor of an earlier packet.  Otherwise, packets are constructed as they are issued.
   std::shared_ptr<AutoPacketInternal> m_nextPacket;
 
   // Collection of known subscribers
   typedef std::set<autowiring::AutoFilterDescriptor> t_autoFilterSet;
   t_autoFilterSet m_autoFilters;
 
+  // History of a type which some AutoFilter reads with a timeshift
+  struct TimeshiftHistory {
+    // The distinct timeshifts at which the type is read, in ascending order, and the number of
+    // registered AutoFilter arguments that read the type at each one
+    std::map<int, size_t> shifts;
+
+    // Entries for the most recently issued packets, enough to satisfy the largest timeshift
+    autowiring::timeshift_ring ring;
+  };
+
+  // Timeshift histories, by type, and the serial number of the next packet to be issued
+  std::unordered_map<auto_id, TimeshiftHistory> m_timeshiftHistory;
+  uint64_t m_nextSerial = 0;
+
+  // Instruments of each registered AutoFilter, the descriptors in m_autoFilters point to these
+  std::unordered_map<autowiring::AutoFilterDescriptor, std::shared_ptr<autowiring::filter_instruments>> m_instruments;
+
+  // Instruments of removed AutoFilters, kept until every packet that could refer to them is destroyed
+  std::vector<std::shared_ptr<autowiring::filter_instruments>> m_retiredInstruments;
+
   // Accumulators used to compute statistics about AutoPacket lifespan.
   long long m_packetCount = 0;
   double m_packetDurationSum = 0.0;
   double m_packetDurationSqSum = 0.0;
 
+  // Admission control.  The admitted count is the number of issued packets that are neither
+  // destroyed nor abandoned; it is decremented without holding the lock, so waiters are counted
+  // in order to allow releases to skip the notification when nobody is waiting.
+  size_t m_outstandingLimit = ~0;
+  AdmissionPolicy m_admissionPolicy = AdmissionPolicy::Block;
+  std::atomic<size_t> m_admitted{0};
+  std::atomic<size_t> m_nAdmissionWaiters{0};
+  std::condition_variable m_admissionCv;
+
+  // Packets in order of issue, only maintained under the DropOldest policy.  Entries of destroyed
+  // packets are discarded as new packets are admitted.
+  std::deque<std::weak_ptr<AutoPacketInternal>> m_admissionOrder;
+
+  // Packets refused admission, and packets abandoned to make room for newer ones
+  std::atomic<size_t> m_rejectedCount{0};
+  std::atomic<size_t> m_abandonedCount{0};
+
+  // Set if latency histograms are enabled, and the histogram of AutoPacket lifespans
+  std::atomic<bool> m_latencyEnabled{false};
+  autowiring::latency_histogram m_packetLatency;
+
   // Returns the internal outstanding count, for use with AutoPacket
   std::shared_ptr<void> GetInternalOutstanding(void);
 
   // Utility override, does nothing
   void AddSubscriber(std::false_type) {}
 
+  /// <summary>
+  /// Assigns the next serial number and opens timeshift entries for the packet being issued
+  /// </summary>
+  /// <param name="produced">Receives the entries the packet must complete</param>
+  /// <param name="consumed">Receives the entries of earlier packets that the packet may read</param>
+  void OpenTimeshiftEntriesUnsafe(std::vector<std::shared_ptr<autowiring::timeshift_entry>>& produced, std::vector<autowiring::timeshift_read>& consumed);
+
+  /// <summary>
+  /// Waits for the number of admitted packets to fall below the outstanding limit, then admits one
+  /// </summary>
+  /// <param name="timeout">The longest time to wait, or nullptr to wait indefinitely</param>
+  /// <param name="abandoned">Receives the packet abandoned to make room, the caller must release it outside of the lock</param>
+  /// <returns>False if the packet was refused admission</returns>
+  /// <remarks>
+  /// If no room is made before the timeout elapses, the admission policy is applied.  Throws an
+  /// autowiring_error if the factory is stopped while waiting.
+  /// </remarks>
+  bool AdmitUnsafe(std::unique_lock<std::mutex>& lk, const std::chrono::nanoseconds* timeout, std::shared_ptr<AutoPacketInternal>& abandoned);
+
+  /// <summary>
+  /// Appends a newly admitted packet to the admission order, discarding entries of destroyed packets
+  /// </summary>
+  void TrackAdmissionUnsafe(const std::shared_ptr<AutoPacketInternal>& packet);
+
+  /// <summary>
+  /// Retires the instruments of all registered AutoFilters
+  /// </summary>
+  void RetireInstrumentsUnsafe(void);
+
+  /// <summary>
+  /// Abandons the oldest packet that is still outstanding
+  /// </summary>
+  /// <returns>The abandoned packet, or nullptr if there was no packet to abandon</returns>
+  std::shared_ptr<AutoPacketInternal> AbandonOldestUnsafe(void);
+
+  /// <summary>
+  /// Common implementation of NewPacket and NewPacketFor
+  /// </summary>
+  std::shared_ptr<AutoPacket> NewPacketInternal(const std::chrono::nanoseconds* timeout);
+
 public:
   /// <summary>
   /// Copies the internal set of AutoFilter members to the specified container
@@ -75,6 +182,18 @@ public:
   /// <returns>The first element in the list, or nullptr if the list is empty</returns>
   autowiring::SatCounter* CreateSatCounterList(void) const;
 
+  /// <summary>
+  /// Subscribes to the delivery counters of the specified AutoFilter
+  /// </summary>
+  /// <returns>The instruments holding the counters, or nullptr if the AutoFilter is not registered</returns>
+  /// <remarks>
+  /// Deliveries are counted while the AutoFilter has at least one subscriber.  The counters are shared by
+  /// all subscribers and are never reset, so a subscriber interested only in its own period must remember
+  /// their values when it subscribes.  The subscription is released by decrementing the returned object's
+  /// nDeliverySubscribers.
+  /// </remarks>
+  std::shared_ptr<autowiring::filter_instruments> SubscribeDeliveries(const autowiring::AutoFilterDescriptor& autoFilter);
+
   // CoreRunnable overrides:
   bool OnStart(void) override;
   void OnStop(bool graceful) override;
@@ -182,13 +301,62 @@ public:
   /// Obtains a new packet from the object pool and configures it with the current
   /// satisfaction graph
   /// </summary>
+  /// <remarks>
+  /// If the outstanding limit has been reached, the admission policy decides the outcome.  Under
+  /// the Block policy, this method waits until a packet is released; under DropNewest, it returns
+  /// nullptr; under DropOldest, it abandons the oldest outstanding packet.
+  /// </remarks>
   std::shared_ptr<AutoPacket> NewPacket(void);
 
+  /// <summary>
+  /// Obtains a new packet, waiting up to the specified timeout for the outstanding count to fall below the limit
+  /// </summary>
+  /// <remarks>
+  /// If the timeout elapses, the admission policy is applied as with NewPacket, except that the Block
+  /// policy returns nullptr.  This method will throw an autowiring_error if the factory is stopped
+  /// while waiting.
+  /// </remarks>
+  std::shared_ptr<AutoPacket> NewPacketFor(std::chrono::nanoseconds timeout);
+
   std::shared_ptr<AutoPacketInternal> ConstructPacket(void);
 
+  /// <summary>
+  /// Obtains the successor of the specified packet, see AutoPacket::Successor
+  /// </summary>
+  std::shared_ptr<AutoPacket> GetSuccessor(AutoPacketInternal& packet);
+
   /// <returns>the number of outstanding AutoPackets</returns>
   size_t GetOutstandingPacketCount(void) const;
 
+  /// <summary>
+  /// Sets the maximum number of packets this factory will permit to be outstanding at a time
+  /// </summary>
+  /// <param name="limit">The maximum number of outstanding packets, or ~0 for no limit</param>
+  /// <param name="policy">The action to take when a packet is requested while the limit is reached</param>
+  /// <remarks>
+  /// A user may assign the limit to a value lower than the current number of outstanding packets.
+  /// In this case, no packets will be issued until the count falls below the new limit.  Packets
+  /// issued before the DropOldest policy is selected are never abandoned.
+  /// </remarks>
+  void SetOutstandingLimit(size_t limit, AdmissionPolicy policy = AdmissionPolicy::Block);
+
+  /// <returns>The maximum number of outstanding packets</returns>
+  size_t GetOutstandingLimit(void) const;
+
+  /// <returns>The action taken when a packet is requested while the outstanding limit is reached</returns>
+  AdmissionPolicy GetAdmissionPolicy(void) const;
+
+  /// <returns>The number of packet requests refused under the DropNewest policy or by a timed out NewPacketFor</returns>
+  size_t GetRejectedPacketCount(void) const { return m_rejectedCount; }
+
+  /// <returns>The number of packets abandoned under the DropOldest policy</returns>
+  size_t GetAbandonedPacketCount(void) const { return m_abandonedCount; }
+
+  /// <summary>
+  /// Called by each issued AutoPacket's destructor, so that the factory may admit another packet
+  /// </summary>
+  void ReleaseAdmission(void);
+
   /// <summary>
   /// Called by each AutoPacket's Finalize method to allow the factory
   /// to record statistics about packet lifespan.
@@ -226,7 +394,33 @@ public:
   /// <summary>
   /// Resets the statistics accumulators stored by the AutoPacketFactory.
   /// </summary>
+  /// <remarks>
+  /// Latency histograms and the rejected and abandoned packet counts are also cleared.  Latency
+  /// histograms remain enabled if they were enabled.
+  /// </remarks>
   void ResetPacketStatistics(void);
+
+  /// <summary>
+  /// Enables or disables the recording of latency histograms
+  /// </summary>
+  /// <remarks>
+  /// While enabled, the wall time of every AutoFilter call and the lifespan of every AutoPacket are
+  /// recorded in lock-free histograms.  Deferred AutoFilter calls are timed when they are made, not
+  /// when they are pended.  Disabling latency histograms discards all recorded samples.
+  /// </remarks>
+  void EnableLatencyHistograms(bool enable = true);
+
+  /// <returns>True if latency histograms are enabled</returns>
+  bool IsLatencyHistogramsEnabled(void) const { return m_latencyEnabled; }
+
+  /// <returns>
+  /// A snapshot of the latency histogram of each AutoFilter, or an empty vector if latency histograms
+  /// are not enabled
+  /// </returns>
+  std::vector<std::pair<autowiring::AutoFilterDescriptor, autowiring::latency_snapshot>> GetFilterLatencies(void) const;
+
+  /// <returns>A snapshot of the histogram of AutoPacket lifespans</returns>
+  autowiring::latency_snapshot GetPacketLatency(void) const { return m_packetLatency.snapshot(); }
 };
 
 // @cond
@@ -15,12 +15,21 @@
 
 using namespace autowiring;
 
-AutoPacketGraph::AutoPacketGraph(void)
+AutoPacketGraph::AutoPacketGraph(void) :
+  AutoPacketGraph(DeliveryMode::Teardown)
+{}
+
+AutoPacketGraph::AutoPacketGraph(DeliveryMode mode) :
+  m_mode(mode)
 {
   AutoCurrentContext()->newObject += [this] (const CoreObjectDescriptor&) { LoadEdges(); };
 }
 
-AutoPacketGraph::~AutoPacketGraph(void) {}
+AutoPacketGraph::~AutoPacketGraph(void) {
+  // Other graphs may still be counting deliveries, only our own subscriptions are released
+  for (auto& subscription : m_subscriptions)
+    subscription.second->nDeliverySubscribers--;
+}
 
 void AutoPacketGraph::LoadEdges() {
   std::lock_guard<std::mutex> lk(m_lock);
@@ -29,28 +38,52 @@ void AutoPacketGraph::LoadEdges() {
   m_factory->AppendAutoFiltersTo(descriptors);
 
   for (auto& descriptor : descriptors) {
-    for(auto pCur = descriptor.GetAutoFilterArguments(); *pCur; pCur++) {
-      auto_id id = pCur->id;
+    // Skip the AutoPacketGraph
+    const auto_id descType = m_factory->GetContext()->GetAutoTypeId(descriptor.GetAutoFilter());
+    if (descType == auto_id_t<AutoPacketGraph>{})
+      continue;
 
-      // Skip the AutoPacketGraph
-      const auto_id descType = m_factory->GetContext()->GetAutoTypeId(descriptor.GetAutoFilter());
-      if (descType == auto_id_t<AutoPacketGraph>{}) {
-        continue;
+    // Counters are allocated or subscribed to only the first time a filter is seen
+    std::atomic<size_t>* counters;
+    if (m_mode == DeliveryMode::Counting) {
+      auto& subscription = m_subscriptions[descriptor];
+      if (!subscription) {
+        subscription = m_factory->SubscribeDeliveries(descriptor);
+        if (!subscription) {
+          // Filter was removed after we enumerated it
+          m_subscriptions.erase(descriptor);
+          continue;
+        }
       }
+      counters = subscription->deliveries.get();
+    }
+    else {
+      auto& allocated = m_counters[descriptor];
+      if (!allocated)
+        allocated.reset(
+          new std::atomic<size_t>[descriptor.GetArity()](),
+          std::default_delete<std::atomic<size_t>[]>()
+        );
+      counters = allocated.get();
+    }
+
+    const auto* args = descriptor.GetAutoFilterArguments();
+    for (size_t i = 0; i < descriptor.GetArity(); i++) {
+      const auto& arg = args[i];
 
       DeliveryEdge::ArgType arg_type;
-      if (pCur->is_rvalue) {
+      if (arg.is_rvalue) {
         arg_type = DeliveryEdge::ArgType::Rvalue;
-      } else if (pCur->is_input) {
+      } else if (arg.is_input) {
         arg_type = DeliveryEdge::ArgType::Input;
       } else {
         arg_type = DeliveryEdge::ArgType::Output;
       }
 
-      DeliveryEdge edge {id, descriptor, arg_type};
-      if (m_deliveryGraph.find(edge) == m_deliveryGraph.end()) {
-        m_deliveryGraph[edge] = 0;
-      }
+      // Existing edges retain their counters and baselines
+      DeliveryEdge edge {arg.id, descriptor, arg_type};
+      if (!m_deliveryGraph.count(edge))
+        m_deliveryGraph.emplace(edge, DeliveryCounter{&counters[i], counters[i].load(std::memory_order_relaxed)});
     }
   }
 }
@@ -60,7 +93,13 @@ void AutoPacketGraph::RecordDelivery(auto_id id, const AutoFilterDescriptor& des
 
   auto itr = m_deliveryGraph.find(edge);
   assert(itr != m_deliveryGraph.end());
-  itr->second++;
+  itr->second.counter->fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t AutoPacketGraph::GetDeliveryCount(const DeliveryEdge& edge) const {
+  std::lock_guard<std::mutex> lk(m_lock);
+  auto itr = m_deliveryGraph.find(edge);
+  return itr == m_deliveryGraph.end() ? 0 : itr->second.count();
 }
 
 bool AutoPacketGraph::OnStart(void) {
@@ -69,6 +108,10 @@ bool AutoPacketGraph::OnStart(void) {
 }
 
 void AutoPacketGraph::AutoFilter(AutoPacket& packet) {
+  if (m_mode == DeliveryMode::Counting)
+    // Packets record their own deliveries
+    return;
+
   packet.AddTeardownListener([this, &packet] () {
     for (auto& cur : packet.GetDecorations()) {
       auto& decoration = cur.second;
@@ -113,7 +156,7 @@ bool AutoPacketGraph::WriteGV(const std::string& filename, bool numPackets) cons
     auto& edge = itr.first;
     auto type = edge.type_info;
     auto& descriptor = edge.descriptor;
-    auto count = itr.second;
+    auto count = itr.second.count();
 
     // Skip the AutoPacketGraph
     auto_id descType = m_factory->GetContext()->GetAutoTypeId(descriptor.GetAutoFilter());
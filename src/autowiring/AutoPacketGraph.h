@@ -6,6 +6,7 @@
 #include "Autowired.h"
 #include "CoreRunnable.h"
 #include STL_UNORDERED_MAP
+#include <atomic>
 
 /// \internal
 /// <summary>
@@ -58,13 +59,51 @@ class AutoPacketGraph:
   public CoreRunnable
 {
 public:
+  /// <summary>
+  /// The means by which deliveries are recorded
+  /// </summary>
+  enum class DeliveryMode {
+    // The decorations of each packet are inspected when the packet is destroyed
+    Teardown,
+
+    // Counters are incremented in place by packets as decorations are delivered to filters and
+    // attached by them, no per-packet work is done by the graph itself.  Only inputs actually
+    // delivered and outputs actually produced are counted, and deliveries made before the graph
+    // subscribed to a filter's counters are not.
+    Counting
+  };
+
+  /// <summary>
+  /// The count of deliveries on a single edge
+  /// </summary>
+  struct DeliveryCounter {
+    // The counter, and its value when the edge was first seen
+    std::atomic<size_t>* counter;
+    size_t baseline;
+
+    /// <returns>The number of deliveries since the edge was first seen</returns>
+    size_t count(void) const { return counter->load(std::memory_order_relaxed) - baseline; }
+  };
+
   AutoPacketGraph(void);
+  explicit AutoPacketGraph(DeliveryMode mode);
   ~AutoPacketGraph(void);
 
-  typedef std::unordered_map<DeliveryEdge, size_t, std::hash<DeliveryEdge>> t_deliveryEdges;
+  typedef std::unordered_map<DeliveryEdge, DeliveryCounter, std::hash<DeliveryEdge>> t_deliveryEdges;
 
 protected:
-  // A mapping of an edge to the number of times it was delivered
+  // The delivery recording mode for this graph
+  const DeliveryMode m_mode;
+
+  // Delivery counters for each AutoFilter in teardown mode, one for each argument.  Counters are
+  // allocated once, when the AutoFilter is first seen.
+  std::unordered_map<autowiring::AutoFilterDescriptor, std::shared_ptr<std::atomic<size_t>>> m_counters;
+
+  // Subscriptions to the factory's delivery counters for each AutoFilter in counting mode, released
+  // when the graph is destroyed
+  std::unordered_map<autowiring::AutoFilterDescriptor, std::shared_ptr<autowiring::filter_instruments>> m_subscriptions;
+
+  // A mapping of an edge to the number of times it was delivered, refers to one of the above
   t_deliveryEdges m_deliveryGraph;
 
   // A lock for this type
@@ -92,6 +131,12 @@ protected:
   virtual bool OnStart(void) override;
 
 public:
+  /// <returns>The delivery recording mode for this graph</returns>
+  DeliveryMode GetDeliveryMode(void) const { return m_mode; }
+
+  /// <returns>The number of times the specified edge was delivered, or zero if the edge is not known</returns>
+  size_t GetDeliveryCount(const DeliveryEdge& edge) const;
+
   /// <summary>
   /// Get a copy of the packet via AutoFilter
   /// </summary>
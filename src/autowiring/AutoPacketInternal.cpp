@@ -14,7 +14,7 @@ AutoPacketInternal::AutoPacketInternal(AutoPacketFactory& factory, std::shared_p
 
 AutoPacketInternal::~AutoPacketInternal(void) {}
 
-void AutoPacketInternal::Initialize(bool isFirstPacket) {
+void AutoPacketInternal::Initialize(std::vector<std::shared_ptr<timeshift_entry>> produced, const std::vector<timeshift_read>& consumed) {
   // Mark init time of packet
   this->m_initTime = std::chrono::high_resolution_clock::now();
 
@@ -24,6 +24,9 @@ void AutoPacketInternal::Initialize(bool isFirstPacket) {
   // Find all subscribers with no required or optional arguments:
   std::vector<SatCounter*> callCounters;
 
+  // Timeshifted types that were decorated before this packet was issued:
+  std::vector<std::pair<std::shared_ptr<timeshift_entry>, AnySharedPointer>> decorated;
+
   {
     std::lock_guard<std::mutex> lk(m_lock);
     for (auto* satCounter = m_firstCounter; satCounter; satCounter = satCounter->flink) {
@@ -32,27 +35,61 @@ void AutoPacketInternal::Initialize(bool isFirstPacket) {
       if (!satCounter->remaining)
         callCounters.push_back(satCounter);
     }
+
+    m_timeshiftEntries = std::move(produced);
+    for (auto& entry : m_timeshiftEntries) {
+      auto q = m_decoration_map.find(DecorationKey(entry->id, 0));
+      if (q != m_decoration_map.end() && !q->second.m_decorations.empty())
+        decorated.emplace_back(entry, q->second.m_decorations.front());
+    }
   }
+  for (auto& cur : decorated)
+    CompleteTimeshiftEntry(*cur.first, cur.second);
+
+  // Obtain timeshifted inputs from earlier packets, or wait for them to be decorated
+  std::shared_ptr<AutoPacket> self = shared_from_this();
+  for (const auto& read : consumed) {
+    DecorationKey key(read.id, read.tshift);
+    if (!((std::lock_guard<std::mutex>)m_lock, m_decoration_map.count(key)))
+      // No filter on this packet is interested in this timeshift
+      continue;
 
-  // Mark timeshifted decorations as unsatisfiable on the first packet
-  if (isFirstPacket)
-    for (auto& dec : m_decoration_map) {
-      auto& key = dec.first;
-      if (key.tshift) {
-        MarkUnsatisfiable(key);
-        MarkSuccessorsUnsatisfiable(key);
+    AnySharedPointer value;
+    if (read.entry) {
+      std::lock_guard<std::mutex> lk(read.entry->lock);
+      if (!read.entry->complete) {
+        read.entry->waiters.emplace_back(self, read.tshift);
+        continue;
       }
+      value = read.entry->value;
     }
 
+    if (value)
+      DecorateNoPriors(value, key);
+    else
+      // Earlier packet never decorated this type, or there was no earlier packet
+      MarkUnsatisfiable(key);
+  }
+
   // Call all subscribers with no required or optional arguments:
   // NOTE: This may result in decorations that cause other subscribers to be called.
   {
     autowiring::AutoCurrentPacketPusher pkt(*this);
     for (SatCounter* call : callCounters)
-      call->GetCall()(call->GetAutoFilter().ptr(), *this);
+      call->Call(*this);
   }
 }
 
-std::shared_ptr<AutoPacketInternal> AutoPacketInternal::SuccessorInternal(void) {
-  return std::static_pointer_cast<AutoPacketInternal>(Successor());
+std::shared_ptr<AutoPacketInternal> AutoPacketInternal::SuccessorUnsafe(void) {
+  if (m_successorIssued)
+    return m_issuedSuccessor.lock();
+  if (!m_successor)
+    m_successor = m_parentFactory->ConstructPacket();
+  return m_successor;
+}
+
+void AutoPacketInternal::SetSuccessorIssuedUnsafe(const std::shared_ptr<AutoPacketInternal>& successor) {
+  m_successor.reset();
+  m_issuedSuccessor = successor;
+  m_successorIssued = true;
 }
@@ -16,16 +16,53 @@ public:
   /// <summary>
   /// Decrements subscribers requiring AutoPacket argument then calls all initializing subscribers.
   /// </summary>
+  /// <param name="produced">Entries for each timeshifted type, to be completed by this packet</param>
+  /// <param name="consumed">Entries of earlier packets, read by this packet's timeshifted inputs</param>
   /// <remarks>
   /// Initialize is called when a packet is issued by the AutoPacketFactory.
   /// It is not called when the Packet is created since that could result in
   /// spurious calls when no packet is issued.
   /// </remarks>
-  void Initialize(bool isFirstPacket);
+  void Initialize(
+    std::vector<std::shared_ptr<autowiring::timeshift_entry>> produced,
+    const std::vector<autowiring::timeshift_read>& consumed
+  );
 
   /// <summary>
-  ///
+  /// Obtains the successor of this packet, creating it if it has not been requested or issued yet
   /// </summary>
-  std::shared_ptr<AutoPacketInternal> SuccessorInternal(void);
+  /// <returns>The successor, or nullptr if it was issued and has since been destroyed</returns>
+  /// <remarks>
+  /// The factory lock must be held
+  /// </remarks>
+  std::shared_ptr<AutoPacketInternal> SuccessorUnsafe(void);
+
+  /// <summary>
+  /// Records the issue of this packet's successor, releasing this packet's hold on it
+  /// </summary>
+  /// <remarks>
+  /// The factory lock must be held
+  /// </remarks>
+  void SetSuccessorIssuedUnsafe(const std::shared_ptr<AutoPacketInternal>& successor);
+
+  /// <returns>The successor requested on this packet, if one has been requested and not yet issued</returns>
+  const std::shared_ptr<AutoPacketInternal>& RequestedSuccessorUnsafe(void) const { return m_successor; }
+
+  /// <returns>True if this packet has been issued and its successor has not</returns>
+  /// <remarks>
+  /// The factory lock must be held
+  /// </remarks>
+  bool IsCurrentUnsafe(void) const { return m_admitted && !m_successorIssued; }
+
+  /// <summary>
+  /// Marks this packet as counting against the factory's outstanding limit
+  /// </summary>
+  void SetAdmitted(void) { m_admitted = true; }
+
+  /// <summary>
+  /// Marks this packet as abandoned, preventing any further AutoFilters from being invoked on it
+  /// </summary>
+  /// <returns>False if the packet was already abandoned</returns>
+  bool Abandon(void) { return !m_abandoned.exchange(true); }
 };
 
@@ -9,13 +9,43 @@
 #include "dispatch_aborted_exception.h"
 #include "GlobalCoreContext.h"
 #include "fast_pointer_cast.h"
+#include <algorithm>
 #include <cassert>
+#include <map>
 #include ATOMIC_HEADER
 
 using namespace autowiring;
 
 static auto mainTID = std::this_thread::get_id();
 
+namespace {
+  // Cores reserved with BasicThread::SetExclusiveCore, and the threads holding them
+  struct CoreReservations {
+    std::mutex lock;
+    std::map<int, const BasicThread*> owners;
+  };
+
+  CoreReservations& GetCoreReservations(void) {
+    static CoreReservations reservations;
+    return reservations;
+  }
+
+  // Removes cores reserved by other threads, unless that would leave nothing
+  std::vector<int> WithoutReservedCores(const std::vector<int>& cores, const BasicThread* pOwner) {
+    auto& reservations = GetCoreReservations();
+    std::vector<int> retVal;
+    {
+      std::lock_guard<std::mutex> lk(reservations.lock);
+      for (int core : cores) {
+        auto q = reservations.owners.find(core);
+        if (q == reservations.owners.end() || q->second == pOwner)
+          retVal.push_back(core);
+      }
+    }
+    return retVal.empty() ? cores : retVal;
+  }
+}
+
 BasicThread::BasicThread(const char* pName):
   ContextMember(pName),
   m_state(std::make_shared<BasicThreadStateBlock>())
@@ -23,6 +53,7 @@ BasicThread::BasicThread(const char* pName):
 
 BasicThread::~BasicThread(void) {
   NotifyTeardownListeners();
+  ReleaseExclusiveCore();
 }
 
 std::mutex& BasicThread::GetLock(void) const {
@@ -35,6 +66,9 @@ void BasicThread::DoRun(std::shared_ptr<CoreObject>&& refTracker) {
   // Make our own session current before we do anything else:
   CurrentContextPusher pusher(GetContext());
 
+  std::lock_guard<std::mutex>{m_state->m_lock},
+  m_state->m_startTime = std::chrono::steady_clock::now();
+
   // Set the thread name no matter what:
   if(GetName())
     SetCurrentThreadName();
@@ -43,6 +77,16 @@ void BasicThread::DoRun(std::shared_ptr<CoreObject>&& refTracker) {
   // we want to be sure we get the correct value assigned eventually.
   SetThreadPriority(m_priority);
 
+  // Scheduling policy next.  A realtime policy supersedes the priority assigned above.
+  {
+    ThreadScheduling scheduling = GetScheduling();
+    if (scheduling.policy != SchedulingPolicy::Default || scheduling.lockMemory || scheduling.stackPrefault)
+      m_effectivePolicy = ApplyScheduling(scheduling);
+  }
+
+  // Processor affinity, likewise, must be in place before we start running
+  ApplyStartupAffinity();
+
   // Now we wait for the thread to be good to go:
   try {
     Run();
@@ -81,14 +125,28 @@ void BasicThread::DoRunLoopCleanup(std::shared_ptr<CoreContext>&& ctxt, std::sha
   // Perform a manual notification of teardown listeners
   NotifyTeardownListeners();
 
+  // Nothing will run on a reserved core any more, let someone else have it
+  ReleaseExclusiveCore();
+
   // Tell our CoreRunnable parent that we're done to ensure that our reference count will be cleared
   Stop(false);
 
   // Release our hold on the context.  There is still at least one more hold through the refTracker
   ctxt.reset();
 
-  // Detach.  This is just a simple memory free, destruction of the lambda should have no side-effects
-  state->m_thisThread.detach();
+  // Thread times cannot be obtained once we detach, capture them now
+  std::chrono::milliseconds kernelTime, userTime;
+  GetThreadTimes(kernelTime, userTime);
+
+  // Detach.  This is just a simple memory free, destruction of the lambda should have no side-effects.
+  // Done under lock because affinity changes may be inspecting the thread handle.
+  {
+    std::lock_guard<std::mutex> lk(state->m_lock);
+    state->m_thisThread.detach();
+    state->m_stopTime = std::chrono::steady_clock::now();
+    state->m_kernelTime = kernelTime;
+    state->m_userTime = userTime;
+  }
 
   // The reference tracker internally holds a reference to the CoreContext.  If this is the last
   // reference tracker and the context is not otherwise referenced, this reset step may potentially
@@ -103,6 +161,17 @@ void BasicThread::DoRunLoopCleanup(std::shared_ptr<CoreContext>&& ctxt, std::sha
   state->m_stateCondition.notify_all();
 }
 
+ThreadStats BasicThread::GetThreadStats(void) {
+  ThreadStats retVal;
+  GetThreadTimes(retVal.kernelTime, retVal.userTime);
+
+  std::lock_guard<std::mutex> lk(m_state->m_lock);
+  retVal.running = m_state->m_thisThread.joinable();
+  if (m_state->m_startTime != std::chrono::steady_clock::time_point{})
+    retVal.wallTime = (retVal.running ? std::chrono::steady_clock::now() : m_state->m_stopTime) - m_state->m_startTime;
+  return retVal;
+}
+
 void BasicThread::WaitForStateUpdate(const std::function<bool()>& fn) const {
   std::unique_lock<std::mutex> lk(m_state->m_lock);
   m_state->m_stateCondition.wait(
@@ -134,6 +203,7 @@ bool BasicThread::OnStart(void) {
   // enables us to decide in advance the exact location in memory where the
   // object will be stored.
   auto outstanding = GetOutstanding();
+  std::lock_guard<std::mutex> lk(m_state->m_lock);
   m_state->m_thisThread.~thread();
   new (&m_state->m_thisThread) std::thread(
     [this, outstanding] () mutable {
@@ -183,6 +253,129 @@ bool BasicThread::IsCompleted(void) const {
   return m_state->m_completed;
 }
 
+void BasicThread::SetScheduling(const ThreadScheduling& scheduling) {
+  bool isThisThread;
+  {
+    std::lock_guard<std::mutex> lk(GetLock());
+    m_scheduling = scheduling;
+    isThisThread = m_state->m_thisThread.get_id() == std::this_thread::get_id();
+  }
+
+  if (isThisThread)
+    m_effectivePolicy = ApplyScheduling(scheduling);
+}
+
+ThreadScheduling BasicThread::GetScheduling(void) const {
+  std::lock_guard<std::mutex> lk(GetLock());
+  return m_scheduling;
+}
+
+void BasicThread::ApplyStartupAffinity(void) {
+  std::vector<int> cores = GetAffinity();
+  if (cores.empty()) {
+    // Nothing requested, consult the policy of the nearest context that has one
+    for (std::shared_ptr<CoreContext> ctxt = GetContext(); ctxt; ctxt = ctxt->GetParentContext()) {
+      ThreadAffinityPolicy policy = ctxt->GetThreadAffinityPolicy();
+      if (policy == ThreadAffinityPolicy::Inherit)
+        continue;
+
+      if (policy == ThreadAffinityPolicy::Spread) {
+        auto available = WithoutReservedCores(GetAvailableCores(), this);
+        if (!available.empty())
+          cores.push_back(available[ctxt->NextSpreadIndex() % available.size()]);
+      }
+      break;
+    }
+
+    if (cores.empty())
+      return;
+  }
+
+  std::lock_guard<std::mutex> lk(GetLock());
+  if (m_affinity.empty())
+    // Record the assignment made by the policy
+    m_affinity = cores;
+  SetThreadAffinity(WithoutReservedCores(m_affinity, this), true);
+}
+
+void BasicThread::ReleaseExclusiveCore(void) {
+  int core;
+  {
+    std::lock_guard<std::mutex> lk(GetLock());
+    core = m_exclusiveCore;
+    m_exclusiveCore = -1;
+  }
+  if (core == -1)
+    return;
+
+  auto& reservations = GetCoreReservations();
+  std::lock_guard<std::mutex> lk(reservations.lock);
+  auto q = reservations.owners.find(core);
+  if (q != reservations.owners.end() && q->second == this)
+    reservations.owners.erase(q);
+}
+
+void BasicThread::SetAffinity(const std::vector<int>& cores) {
+  ReleaseExclusiveCore();
+
+  std::lock_guard<std::mutex> lk(GetLock());
+  m_affinity = cores;
+  if (m_state->m_thisThread.joinable())
+    SetThreadAffinity(
+      WithoutReservedCores(m_affinity, this),
+      m_state->m_thisThread.get_id() == std::this_thread::get_id()
+    );
+}
+
+bool BasicThread::SetAffinityToMemory(const void* pMem) {
+  std::vector<int> cores;
+  if (!GetCoresForMemory(pMem, cores) || cores.empty())
+    return false;
+  SetAffinity(cores);
+  return true;
+}
+
+bool BasicThread::SetExclusiveCore(int core) {
+  auto available = GetAvailableCores();
+  if (std::find(available.begin(), available.end(), core) == available.end())
+    return false;
+
+  {
+    auto& reservations = GetCoreReservations();
+    std::lock_guard<std::mutex> lk(reservations.lock);
+    auto& owner = reservations.owners[core];
+    if (owner && owner != this)
+      return false;
+    owner = this;
+  }
+
+  int prior;
+  {
+    std::lock_guard<std::mutex> lk(GetLock());
+    prior = m_exclusiveCore;
+    m_exclusiveCore = core;
+    m_affinity.assign(1, core);
+    if (m_state->m_thisThread.joinable())
+      SetThreadAffinity(m_affinity, m_state->m_thisThread.get_id() == std::this_thread::get_id());
+  }
+
+  if (prior != -1 && prior != core) {
+    auto& reservations = GetCoreReservations();
+    std::lock_guard<std::mutex> lk(reservations.lock);
+    reservations.owners.erase(prior);
+  }
+  return true;
+}
+
+void BasicThread::ClearAffinity(void) {
+  SetAffinity(std::vector<int>{});
+}
+
+std::vector<int> BasicThread::GetAffinity(void) const {
+  std::lock_guard<std::mutex> lk(GetLock());
+  return m_affinity;
+}
+
 void BasicThread::ForceCoreThreadReidentify(void) {
   for(const auto& ctxt : ContextEnumerator(GlobalCoreContext::Get())) {
     for(const auto& thread : ctxt->CopyBasicThreadList())
@@ -2,10 +2,12 @@
 #pragma once
 #include "ContextMember.h"
 #include "CoreRunnable.h"
+#include <atomic>
 #include CHRONO_HEADER
 #include FUNCTIONAL_HEADER
 #include MEMORY_HEADER
 #include MUTEX_HEADER
+#include <vector>
 
 class BasicThread;
 class CoreContext;
@@ -42,6 +44,77 @@ enum class ThreadPriority {
   Multimedia
 };
 
+/// <summary>
+/// Scheduling policies that may be requested for a BasicThread
+/// </summary>
+/// <remarks>
+/// The realtime policies are currently only implemented on Linux.  Other platforms, and Linux
+/// processes lacking the needed privileges, fall back to Default.
+/// </remarks>
+enum class SchedulingPolicy {
+  /// The operating system's time-sharing policy.  ThreadPriority is honored under this policy.
+  Default,
+
+  /// Realtime first-in, first-out.  The thread runs until it blocks or is preempted by a thread
+  /// of higher realtime priority.
+  Fifo,
+
+  /// Realtime round-robin.  Like Fifo, except that threads of equal priority are time-sliced.
+  RoundRobin,
+
+  /// Earliest deadline first.  The thread is guaranteed a runtime budget within each period, to be
+  /// delivered before the relative deadline.  Falls back to Fifo if it cannot be granted.
+  Deadline
+};
+
+/// <summary>
+/// Scheduling parameters for BasicThread::SetScheduling
+/// </summary>
+struct ThreadScheduling {
+  SchedulingPolicy policy = SchedulingPolicy::Default;
+
+  // Priority for the Fifo and RoundRobin policies, from 1 (lowest) to 99
+  int realtimePriority = 1;
+
+  // CPU time reserved in each period, deadline relative to the start of each period, and the period
+  // itself, for the Deadline policy.  An unset deadline or period defaults to the other.
+  std::chrono::nanoseconds runtime{0};
+  std::chrono::nanoseconds deadline{0};
+  std::chrono::nanoseconds period{0};
+
+  // Lock the process's memory so that this thread does not take page faults.  Future mappings are
+  // only locked if the process may lock an unlimited amount of memory, so that a small lock limit
+  // cannot cause later allocations to fail.
+  bool lockMemory = false;
+
+  // Bytes of stack to touch before Run is called, so that the pages are resident (and locked, if
+  // lockMemory is set) before any time-sensitive work begins
+  size_t stackPrefault = 0;
+};
+
+/// <summary>
+/// CPU accounting for a BasicThread, see BasicThread::GetThreadStats
+/// </summary>
+struct ThreadStats {
+  // True if the thread is presently running
+  bool running = false;
+
+  // CPU time consumed in kernel and user mode
+  std::chrono::milliseconds kernelTime{0};
+  std::chrono::milliseconds userTime{0};
+
+  // Time since the thread started running, or the total time it ran if it has exited
+  std::chrono::nanoseconds wallTime{0};
+
+  /// <returns>The fraction of wall time that the thread spent on a CPU</returns>
+  double Utilization(void) const {
+    return
+      wallTime.count() ?
+      std::chrono::duration<double>(kernelTime + userTime) / std::chrono::duration<double>(wallTime) :
+      0.0;
+  }
+};
+
 /// <summary>
 /// An abstract class for creating a thread with a single Run method.
 /// </summary>
@@ -132,6 +205,17 @@ protected:
   // The current thread priority
   ThreadPriority m_priority = ThreadPriority::Default;
 
+  // Requested scheduling parameters, guarded by GetLock(), and the policy actually in effect
+  ThreadScheduling m_scheduling;
+  std::atomic<SchedulingPolicy> m_effectivePolicy{SchedulingPolicy::Default};
+  std::atomic<bool> m_memoryLocked{false};
+
+  // Processor cores this thread is restricted to, empty if unrestricted.  Guarded by GetLock().
+  std::vector<int> m_affinity;
+
+  // Core reserved for the exclusive use of this thread, or -1 if none.  Guarded by GetLock().
+  int m_exclusiveCore = -1;
+
   /// <summary>
   /// Assigns a name to the thread, displayed in debuggers.
   /// </summary>
@@ -152,6 +236,36 @@ protected:
   /// </remarks>
   void SetThreadPriority(ThreadPriority threadPriority);
 
+  /// <summary>
+  /// Applies the specified scheduling parameters to the calling thread, which must be this thread
+  /// </summary>
+  /// <returns>The policy in effect after any fallback</returns>
+  /// <remarks>
+  /// Requests that cannot be granted fall back to a less demanding policy rather than failing.
+  /// Sets m_memoryLocked if memory locking was requested and granted.
+  /// </remarks>
+  SchedulingPolicy ApplyScheduling(const ThreadScheduling& scheduling);
+
+  /// <summary>
+  /// Restricts this thread to the specified processor cores, or lifts the restriction if the set is empty
+  /// </summary>
+  /// <param name="fromThisThread">True if the caller is running on this thread</param>
+  /// <returns>False if the platform does not support processor affinity or rejected the request</returns>
+  bool SetThreadAffinity(const std::vector<int>& cores, bool fromThisThread);
+
+  /// <summary>
+  /// Applies the requested affinity, or the one assigned by the context's affinity policy
+  /// </summary>
+  /// <remarks>
+  /// Called from DoRun on this thread before Run is invoked
+  /// </remarks>
+  void ApplyStartupAffinity(void);
+
+  /// <summary>
+  /// Gives up this thread's exclusive core reservation, if it has one
+  /// </summary>
+  void ReleaseExclusiveCore(void);
+
   /// <summary>
   /// Recovers a general lock used to synchronize entities in this thread internally.
   /// </summary>
@@ -224,6 +338,87 @@ public:
   /// </returns>
   bool IsCompleted(void) const;
 
+  /// <summary>
+  /// Requests a scheduling policy for this thread
+  /// </summary>
+  /// <remarks>
+  /// The request takes effect when the thread starts, before Run is called.  If this method is called
+  /// from this thread while it is running, the request takes effect immediately.  Requests made by
+  /// other threads after this thread has started take effect only if this thread is restarted.
+  ///
+  /// A policy that cannot be granted, typically because the process lacks the privilege to use
+  /// realtime scheduling, falls back to a less demanding one; see GetEffectiveSchedulingPolicy.
+  /// ThreadPriority requests are ignored while a realtime policy is in effect.
+  /// </remarks>
+  void SetScheduling(const ThreadScheduling& scheduling);
+
+  /// <returns>The scheduling parameters most recently requested for this thread</returns>
+  ThreadScheduling GetScheduling(void) const;
+
+  /// <returns>The scheduling policy in effect on this thread, after any fallback</returns>
+  SchedulingPolicy GetEffectiveSchedulingPolicy(void) const { return m_effectivePolicy; }
+
+  /// <returns>True if memory locking was requested by this thread and granted</returns>
+  bool IsMemoryLocked(void) const { return m_memoryLocked; }
+
+  /// <summary>
+  /// Restricts this thread to run only on the specified processor cores
+  /// </summary>
+  /// <remarks>
+  /// This method may be called while the thread is running, or before it starts to run.  If it is
+  /// invoked before the thread starts to run, the restriction is applied before Run is called.
+  ///
+  /// Cores reserved by another thread with SetExclusiveCore are removed from the set, unless doing
+  /// so would leave the set empty.  Any exclusive core held by this thread is released.
+  /// </remarks>
+  void SetAffinity(const std::vector<int>& cores);
+
+  /// <summary>
+  /// Restricts this thread to the processor cores of the NUMA node holding the specified memory
+  /// </summary>
+  /// <returns>False if the node could not be determined, in which case the affinity is unchanged</returns>
+  /// <remarks>
+  /// Use this to keep a thread near the buffers it works on.  The node is determined at the time of
+  /// the call; the memory should already have been touched so that it has been assigned a node.
+  /// </remarks>
+  bool SetAffinityToMemory(const void* pMem);
+
+  /// <summary>
+  /// Pins this thread to the specified core and reserves that core for it
+  /// </summary>
+  /// <returns>False if the core is already reserved by another thread</returns>
+  /// <remarks>
+  /// A reserved core is excluded from the affinity of other Autowiring threads that are started or
+  /// have their affinity changed after the reservation is made, including those placed by the Spread
+  /// affinity policy.  Threads outside of Autowiring are not affected.  The reservation is released
+  /// when this thread's affinity is changed or cleared, or when the thread exits.
+  /// </remarks>
+  bool SetExclusiveCore(int core);
+
+  /// <summary>
+  /// Lifts any processor affinity restriction on this thread
+  /// </summary>
+  void ClearAffinity(void);
+
+  /// <returns>
+  /// The processor cores this thread is restricted to, or an empty set if it is unrestricted
+  /// </returns>
+  /// <remarks>
+  /// If the thread was placed by its context's affinity policy, the assigned core is returned.
+  /// </remarks>
+  std::vector<int> GetAffinity(void) const;
+
+  /// <returns>
+  /// The processor cores this process is permitted to run on
+  /// </returns>
+  static std::vector<int> GetAvailableCores(void);
+
+  /// <summary>
+  /// Finds the processor cores local to the NUMA node holding the specified memory
+  /// </summary>
+  /// <returns>False if the node could not be determined on this platform</returns>
+  static bool GetCoresForMemory(const void* pMem, std::vector<int>& cores);
+
   /// <summary>
   /// Adds a function object which will be called when this BasicThread stops running or is destroyed
   /// </summary>
@@ -306,6 +501,14 @@ public:
   /// </remarks>
   void GetThreadTimes(std::chrono::milliseconds& kernelTime, std::chrono::milliseconds& userTime);
 
+  /// <summary>
+  /// Reports CPU and wall-clock running times for this thread
+  /// </summary>
+  /// <remarks>
+  /// Once the thread has exited, the times it had accumulated when it exited are reported.
+  /// </remarks>
+  ThreadStats GetThreadStats(void);
+
   /// <returns>
   /// True if the calling thread is the main thread
   /// </returns>
@@ -1,5 +1,6 @@
 // Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
 #pragma once
+#include CHRONO_HEADER
 #include MEMORY_HEADER
 #include MUTEX_HEADER
 #include THREAD_HEADER
@@ -21,6 +22,15 @@ struct BasicThreadStateBlock:
 
   // Completion condition, true when this thread is no longer running and has run at least once
   bool m_completed = false;
+
+  // Times at which the thread most recently started and stopped running
+  std::chrono::steady_clock::time_point m_startTime;
+  std::chrono::steady_clock::time_point m_stopTime;
+
+  // Kernel and user mode times, captured by the thread as it exits.  The thread cannot be queried
+  // for them afterwards.
+  std::chrono::milliseconds m_kernelTime{0};
+  std::chrono::milliseconds m_userTime{0};
 };
 
 }
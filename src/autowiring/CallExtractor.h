@@ -6,10 +6,14 @@
 #include "AutoPacket.h"
 #include "CurrentContextPusher.h"
 #include "Decompose.h"
+#include "DispatchThunk.h"
+#include "filter_instruments.h"
+#include "has_autofilter.h"
 #include "index_tuple.h"
 #include "noop.h"
 
 class Deferred;
+class DeferredBatch;
 
 namespace autowiring {
 
@@ -150,17 +154,130 @@ struct CE<Deferred(T::*)(Args...), index_tuple<N...>> :
     // dispatch queue.
     auto pAutoPacket = autoPacket.shared_from_this();
 
+    // The call is timed, and its outputs counted, only once it is actually made
+    filter_instruments* pInstruments = filter_instruments::current();
+
     // Pend the call to this object's dispatch queue:
-    *(T*) pObj += [pObj, pAutoPacket] {
-
-      // Extract, call, commit
-      t_ceSetup extractor(*pAutoPacket);
-      (((T*) pObj)->*memFn)(
-        static_cast<typename auto_arg<Args>::arg_type>(autowiring::get<N>(extractor.args))...
-      );
-      autowiring::noop(extractor.template Commit<N>(false)...);
+    *(T*) pObj += [pObj, pAutoPacket, pInstruments] {
+      filter_instruments::scope instrumented(pInstruments);
+      filter_instruments::invocation invocation(pInstruments);
+      {
+        // Extract, call, commit
+        t_ceSetup extractor(*pAutoPacket);
+        (((T*) pObj)->*memFn)(
+          static_cast<typename auto_arg<Args>::arg_type>(autowiring::get<N>(extractor.args))...
+        );
+        autowiring::noop(extractor.template Commit<N>(false)...);
+      }
+      invocation.complete();
     };
   }
 };
 
+/// <summary>
+/// A packet waiting in the batch inbox of a DeferredBatch AutoFilter
+/// </summary>
+struct DeferredBatchPacket:
+  DispatchBatchItem
+{
+  DeferredBatchPacket(const void* key, t_batchFn fn, std::shared_ptr<AutoPacket>&& packet, filter_instruments* pInstruments) :
+    DispatchBatchItem(key, fn),
+    packet(std::move(packet)),
+    pInstruments(pInstruments)
+  {}
+
+  const std::shared_ptr<AutoPacket> packet;
+
+  // Instruments of the AutoFilter which pended this packet, if it was instrumented at the time
+  filter_instruments* const pInstruments;
+};
+
+/// <summary>
+/// Specialization for batched deferred member function AutoFilter routines
+/// </summary>
+template<class T, class... Args, int... N>
+struct CE<DeferredBatch(T::*)(Args...), index_tuple<N...>> :
+  Decompose<void (T::*)(Args...)>
+{
+  typedef CESetup<Args...> t_ceSetup;
+  static const bool deferred = true;
+
+  /// <summary>
+  /// Invokes the AutoFilter once for each packet in the batch
+  /// </summary>
+  template<DeferredBatch(T::*memFn)(Args...)>
+  static void CallEach(T* pObj, DispatchBatchItem* const* ppItems, size_t nItems, std::false_type) {
+    for (size_t i = 0; i < nItems; i++) {
+      auto& item = *static_cast<DeferredBatchPacket*>(ppItems[i]);
+      filter_instruments::scope instrumented(item.pInstruments);
+      filter_instruments::invocation invocation(item.pInstruments);
+      {
+        // Extract, call, commit
+        t_ceSetup extractor(*item.packet);
+        (pObj->*memFn)(
+          static_cast<typename auto_arg<Args>::arg_type>(autowiring::get<N>(extractor.args))...
+        );
+        autowiring::noop(extractor.template Commit<N>(false)...);
+      }
+      invocation.complete();
+    }
+  }
+
+  /// <summary>
+  /// Concludes the specified argument on a packet handed to the batch routine, if it is an output
+  /// </summary>
+  template<class Arg>
+  static bool ConcludeOutput(AutoPacket& packet) {
+    typedef auto_arg<Arg> t_arg;
+    if (t_arg::is_output && !t_arg::is_input)
+      packet.MarkUnsatisfiableIfAbsent(DecorationKey(typename t_arg::id_type{}, 0));
+    return false;
+  }
+
+  /// <summary>
+  /// Hands the whole batch to the AutoFilter type's batch routine
+  /// </summary>
+  /// <remarks>
+  /// Outputs that the batch routine did not attach to a packet are marked unsatisfiable as soon as the
+  /// routine returns, just as they would be when AutoFilter returns
+  /// </remarks>
+  template<DeferredBatch(T::*memFn)(Args...)>
+  static void CallEach(T* pObj, DispatchBatchItem* const* ppItems, size_t nItems, std::true_type) {
+    std::vector<std::shared_ptr<AutoPacket>> packets(nItems);
+    for (size_t i = 0; i < nItems; i++)
+      packets[i] = static_cast<DeferredBatchPacket*>(ppItems[i])->packet;
+
+    // The batch routine is timed as a single call, and credited with every output it attaches
+    filter_instruments* pInstruments = static_cast<DeferredBatchPacket*>(ppItems[0])->pInstruments;
+    filter_instruments::scope instrumented(pInstruments);
+    filter_instruments::invocation invocation(pInstruments);
+    {
+      CurrentContextPusher pshr(packets[0]->GetContext());
+      pObj->AutoFilterBatch(static_cast<const std::vector<std::shared_ptr<AutoPacket>>&>(packets));
+    }
+    invocation.complete();
+
+    for (auto& packet : packets)
+      autowiring::noop(ConcludeOutput<Args>(*packet)...);
+  }
+
+  template<DeferredBatch(T::*memFn)(Args...)>
+  static void CallBatch(const void* pObj, DispatchBatchItem* const* ppItems, size_t nItems) {
+    CallEach<memFn>(
+      (T*)pObj,
+      ppItems,
+      nItems,
+      std::integral_constant<bool, has_autofilter_batch<T>::value>{}
+    );
+  }
+
+  template<DeferredBatch(T::*memFn)(Args...)>
+  static void Call(const void* pObj, AutoPacket& autoPacket) {
+    // The packet is held by the inbox until the batch containing it is processed
+    ((T*)pObj)->PendBatch(
+      new DeferredBatchPacket(pObj, &CallBatch<memFn>, autoPacket.shared_from_this(), filter_instruments::current())
+    );
+  }
+};
+
 }
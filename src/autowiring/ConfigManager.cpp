@@ -3,7 +3,12 @@
 #include "ConfigManager.h"
 #include "ConfigRegistry.h"
 #include "at_exit.h"
+#include "autowiring_error.h"
+#include "mapped_file.h"
+#include <algorithm>
 #include <mutex>
+#include <thread>
+#include <tuple>
 #include <unordered_set>
 
 using namespace autowiring;
@@ -11,7 +16,8 @@ using namespace autowiring;
 struct entry {};
 
 ConfigManager::ConfigManager(std::shared_ptr<ConfigManager> pParent) :
-  m_pParent(pParent)
+  m_pParent(pParent),
+  m_tree(pParent ? pParent->m_tree : std::make_shared<Tree>())
 {
   if (pParent)
     // No defaulting work needed, we can end here
@@ -22,19 +28,27 @@ ConfigManager::ConfigManager(std::shared_ptr<ConfigManager> pParent) :
     for (const auto& field_entry : descriptor.fields) {
       const config_field& field = field_entry.second;
 
-      Entry& entry = m_config[field_entry.first];
+      size_t hash = Hash(field_entry.first);
+      bool created;
+      Entry& entry = FindOrCreateUnsafe(ShardFor(hash), hash, field_entry.first, created);
 
       // If there's a default value on this field, try to marshal it, otherwise the field stays blank
       if (field.default_value)
-        entry.value = field.marshaller->marshal(field.default_value.ptr());
+        entry.value = std::make_shared<const std::string>(field.marshaller->marshal(field.default_value.ptr()));
     }
 }
 
+ConfigManager::~ConfigManager(void) {
+  // Child managers hold a reference to us, so only our own links to the parent remain
+  Clear();
+}
+
 void ConfigManager::Clear(void) {
-  // Clear any recursive handlers created by binding to a default value
-  for (auto& q : m_config) {
-    Entry& entry = q.second;
-    entry.reg.clear();
+  // Take a snapshot of every inherited value and detach from the parent's entries
+  for (Shard& shard : m_shards) {
+    std::lock_guard<autowiring::spin_lock> lk(shard.lock);
+    for (auto& q : shard.entries)
+      Detach(q.second);
   }
 
   // Unlink from the parent
@@ -48,6 +62,20 @@ void ConfigManager::Register(std::shared_ptr<void> pObj, const config_descriptor
   // Byte object base, held for convenience
   uint8_t* pObjBase = static_cast<uint8_t*>(pObj.get());
 
+  // Changes are delivered to the object through a single registrant, which also holds a reference to
+  // the object's shared pointer; we want to prevent the enclosing object's destruction as long as the
+  // registrant is invoking.
+  Registrant* pRegistrant;
+  {
+    std::unique_ptr<Registrant> registrant(new Registrant(pObj));
+    registrant->fields.reserve(desc.fields.size());
+    pRegistrant = registrant.get();
+
+    std::lock_guard<autowiring::spin_lock> lk(m_lock);
+    m_registrants.push_back(std::move(registrant));
+  }
+  Registrant& registrant = *pRegistrant;
+
   {
     // This goes through all of the fields in the user-specified descriptor.  These fields describe offsets
     // in pObj, and each one could require us to either populate offsets in pObj with values that we are
@@ -59,29 +87,24 @@ void ConfigManager::Register(std::shared_ptr<void> pObj, const config_descriptor
 
       // We need to attach this field to the corresponding configuration entry, we perform the attachment by
       // name.  After we have our entry we can fill it or use it to fill other objects as needed.
-      Entry& entry = GetEntryUnsafe(field_desc.name);
+      // The attachment list is guarded by the lock of the entry's shard
+      size_t hash = Hash(field_desc.name);
+      Shard& shard = ShardFor(hash);
       metadata_pack_base* pBoundMetadata;
       {
-        entry.attached.emplace_back(field_desc, pField);
+        std::lock_guard<autowiring::spin_lock> lk(shard.lock);
+        Entry& entry = GetEntryUnsafe(shard, hash, field_desc.name);
+
+        // The field must be in place before the attachment can be seen by Publish
+        size_t index = registrant.fields.size();
+        registrant.fields.push_back({ &entry, field_desc.marshaller, pField, false });
+        entry.attached.emplace_back(field_desc, pField, &registrant, index);
         pBoundMetadata = entry.attached.back().bound_metadata.get();
       }
 
-      // Register a change handler with this object.  Also hold a reference to the object's shared
-      // pointer, we want to prevent the enclosing object's destruction as long as the entry is
-      // invoking.
-      const marshaller_base* marshaller = field_desc.marshaller;
-      entry.onChanged << [pObj, marshaller, pField, &entry] {
-        // register the handler
-        entry.onChanged += [pObj, marshaller, pField, &entry] {
-          marshaller->unmarshal(pField, entry.value.c_str());
-        };
-
-        // Take the default value
-        marshaller->unmarshal(pField, entry.value.c_str());
-      };
-
       // Deferred signalling on all watcher collections.  This part causes When handlers to be invoked.
       const std::vector<const metadata_base*>& all_metadata = pBoundMetadata->get_list();
+      std::lock_guard<autowiring::spin_lock> lk(m_lock);
       for (const auto& m : all_metadata) {
         auto q = metadata_collection.emplace(
           std::piecewise_construct,
@@ -97,6 +120,12 @@ void ConfigManager::Register(std::shared_ptr<void> pObj, const config_descriptor
     }
   }
 
+  // Register the change handler, and take the current values
+  registrant.onChanged << [this, &registrant] {
+    registrant.onChanged += [this, &registrant] { Update(registrant, false); };
+    Update(registrant, true);
+  };
+
   for (auto& e : deferred)
     e.first->OnMetadata(*e.second);
 }
@@ -121,95 +150,396 @@ void ConfigManager::WhenInternal(const std::shared_ptr<WhenWatcher>& watcher) {
     w.OnMetadata(*match);
 }
 
-ConfigManager::Entry& ConfigManager::GetEntryUnsafe(const std::string& name) {
-  auto q = m_config.find(name);
-  if (q != m_config.end())
-    return q->second;
+ConfigManager::Entry* ConfigManager::FindUnsafe(const Shard& shard, size_t hash, const std::string& name) {
+  auto r = shard.entries.equal_range(hash);
+  for (auto q = r.first; q != r.second; q++)
+    if (q->second.name == name)
+      return const_cast<Entry*>(&q->second);
+  return nullptr;
+}
+
+ConfigManager::Entry& ConfigManager::FindOrCreateUnsafe(Shard& shard, size_t hash, const std::string& name, bool& created) {
+  Entry* pEntry = FindUnsafe(shard, hash, name);
+  created = !pEntry;
+  if (created) {
+    pEntry = &shard.entries.emplace(hash, Entry{ name })->second;
+    pEntry->pShard = &shard;
+  }
+  return *pEntry;
+}
+
+ConfigManager::Entry& ConfigManager::GetEntryUnsafe(Shard& shard, size_t hash, const std::string& name) {
+  bool created;
+  auto& configEntry = FindOrCreateUnsafe(shard, hash, name, created);
+  if (!created)
+    return configEntry;
 
-  auto& configEntry = m_config[name];
   if (!m_pParent)
     // No parent, no recursive registration possible
     return configEntry;
 
-  // Need to ensure this value is correctly updated on parent value modifications
+  // Link to the corresponding entry on the parent.  No value is copied here, the entry reads
+  // through to its ancestors until a value is assigned to it directly.
   auto& parentEntry = m_pParent->GetEntry(name);
+  configEntry.owner = shared_from_this();
 
-  // Need to register ourselves and take a value in the sequence order of the parent:
-  auto self = shared_from_this();
-  parentEntry.onChanged << [self, &configEntry, &parentEntry] {
-    // Now we can perform a registration while nothing else is going on
-    configEntry.reg = parentEntry.onChanged += [self, &configEntry, &parentEntry] {
-      // Double-check that we are still registered.  Technically we can become
-      // unregistered while a signal is underway, which means that the entity
-      // performing the unregistration has kicked off a new call to setValue
-      if (!configEntry.reg)
-        return;
-
-      // Take a copy to our local total order, notify everyone:
-      configEntry.onChanged.invoke(
-        [&] (std::string&& valueCopy) {
-          configEntry.value = std::move(valueCopy);
-        },
-        std::string{ parentEntry.value }
-      );
-      configEntry.onChanged();
-    };
-
-    // And we want to take a snapshot of the value and store it in ourselves:
-    configEntry.onChanged.invoke(
-      [&] (std::string&& valueCopy) {
-        configEntry.value = std::move(valueCopy);
-      },
-      std::string{ parentEntry.value }
-    );
-  };
+  std::lock_guard<autowiring::spin_lock> lk(configEntry.lock);
+  std::lock_guard<autowiring::spin_lock> plk(parentEntry.lock);
+  configEntry.pParentEntry = &parentEntry;
+  parentEntry.inheritors.push_back(&configEntry);
   return configEntry;
 }
 
+std::shared_ptr<const std::string> ConfigManager::ResolveUnsafe(Entry& entry) {
+  if (entry.pParentEntry && !entry.overridden && entry.stale) {
+    // Cached value is stale, read through to the parent.  The parent cannot be detached from
+    // while we hold this entry's lock, and a change to any ancestor's value that we fail to
+    // observe will mark this entry stale again once we release it.
+    std::lock_guard<autowiring::spin_lock> lk(entry.pParentEntry->lock);
+    entry.value = ResolveUnsafe(*entry.pParentEntry);
+    entry.stale = false;
+  }
+  return entry.value;
+}
+
+std::shared_ptr<const std::string> ConfigManager::Resolve(Entry& entry) {
+  std::lock_guard<autowiring::spin_lock> lk(entry.lock);
+  return ResolveUnsafe(entry);
+}
+
+void ConfigManager::Detach(Entry& entry) {
+  std::lock_guard<autowiring::spin_lock> lk(entry.lock);
+  if (!entry.pParentEntry)
+    return;
+
+  // Materialize the inherited value so that our own inheritors observe no change
+  if (!entry.overridden) {
+    ResolveUnsafe(entry);
+    entry.overridden = true;
+  }
+
+  {
+    std::lock_guard<autowiring::spin_lock> plk(entry.pParentEntry->lock);
+    auto& inheritors = entry.pParentEntry->inheritors;
+    inheritors.erase(std::find(inheritors.begin(), inheritors.end(), &entry));
+  }
+  entry.pParentEntry = nullptr;
+}
+
 ConfigManager::Entry& ConfigManager::GetEntry(const std::string& name) {
-  std::lock_guard<autowiring::spin_lock> lk(m_lock);
-  return GetEntryUnsafe(name);
+  size_t hash = Hash(name);
+  Shard& shard = ShardFor(hash);
+  std::lock_guard<autowiring::spin_lock> lk(shard.lock);
+  return GetEntryUnsafe(shard, hash, name);
+}
+
+ConfigManager::Key ConfigManager::Intern(const std::string& name) {
+  return Key{ &GetEntry(name) };
+}
+
+std::string ConfigManager::GetEntryValue(Entry& entry) const {
+  auto value = Resolve(entry);
+  return value ? *value : std::string{};
 }
 
 std::string ConfigManager::Get(const std::string& name) const {
-  const Entry* pEntry;
+  Entry* pEntry;
   {
-    std::lock_guard<autowiring::spin_lock> lk(m_lock);
-    auto q = m_config.find(name);
-    pEntry = q == m_config.end() ? nullptr : &q->second;
+    size_t hash = Hash(name);
+    const Shard& shard = ShardFor(hash);
+    std::lock_guard<autowiring::spin_lock> lk(shard.lock);
+    pEntry = FindUnsafe(shard, hash, name);
   }
 
   if (!pEntry)
     return m_pParent ? m_pParent->Get(name) : "";
+  return GetEntryValue(*pEntry);
+}
 
-  // Lock the signal to prevent the value from being changed:
-  std::lock_guard<signal<void()>> lk(pEntry->onChanged);
-  return pEntry->value;
+std::string ConfigManager::Get(const Key& key) const {
+  return GetEntryValue(*key.pEntry);
 }
 
-void ConfigManager::Set(const std::string& name, std::string value) {
-  Entry* pEntry;
+std::vector<std::shared_ptr<const std::string>> ConfigManager::ResolveAll(const std::vector<Entry*>& entries) const {
+  std::vector<std::shared_ptr<const std::string>> values;
+  values.reserve(entries.size());
+  for (;;) {
+    // Wait out any Apply that is publishing
+    const uint64_t sequence = m_tree->applySequence;
+    if (sequence & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    for (Entry* pEntry : entries)
+      values.push_back(Resolve(*pEntry));
+    if (m_tree->applySequence == sequence)
+      return values;
+
+    // An Apply published while we were reading, we may have observed part of it
+    values.clear();
+  }
+}
+
+std::vector<std::string> ConfigManager::Get(const std::vector<Key>& keys) const {
+  std::vector<Entry*> entries;
+  entries.reserve(keys.size());
+  for (const Key& key : keys)
+    entries.push_back(key.pEntry);
+  auto values = ResolveAll(entries);
+
+  // Copies are made outside of the lock
+  std::vector<std::string> retVal;
+  retVal.reserve(values.size());
+  for (const auto& value : values)
+    retVal.push_back(value ? *value : std::string{});
+  return retVal;
+}
+
+void ConfigManager::CollectInheritorsUnsafe(const Entry& entry, std::vector<std::pair<Entry*, std::shared_ptr<ConfigManager>>>& pending) {
+  // Managers are locked while the parent entry's lock is held, because a linked inheritor cannot
+  // finish detaching until that lock is released
+  for (Entry* pInheritor : entry.inheritors) {
+    auto owner = pInheritor->owner.lock();
+    if (owner)
+      pending.emplace_back(pInheritor, std::move(owner));
+  }
+}
+
+void ConfigManager::Validate(const std::vector<std::pair<Entry*, std::shared_ptr<const std::string>>>& staged) {
+  std::vector<std::pair<Entry*, std::shared_ptr<ConfigManager>>> pending;
+  std::vector<const marshaller_base*> marshallers;
+  for (const auto& e : staged) {
+    pending.emplace_back(e.first, nullptr);
+    while (!pending.empty()) {
+      auto next = std::move(pending.back());
+      pending.pop_back();
+      Entry& entry = *next.first;
+
+      {
+        // Entries with overrides of their own will not receive the staged value
+        std::lock_guard<autowiring::spin_lock> lk(entry.lock);
+        if (entry.overridden && &entry != e.first)
+          continue;
+        CollectInheritorsUnsafe(entry, pending);
+      }
+
+      marshallers.clear();
+      {
+        std::lock_guard<autowiring::spin_lock> lk(entry.pShard->lock);
+        for (const auto& attachment : entry.attached)
+          marshallers.push_back(attachment.configField->marshaller);
+      }
+      for (const marshaller_base* marshaller : marshallers)
+        marshaller->validate(e.second->c_str());
+    }
+  }
+}
+
+void ConfigManager::Publish(const std::vector<std::pair<Entry*, std::shared_ptr<const std::string>>>& staged, bool transaction) {
+  // Entries whose listeners must be notified, and the managers of those entries that live on
+  // child managers, which must be kept alive until they have been notified
+  std::vector<Entry*> affected;
+  std::vector<std::shared_ptr<ConfigManager>> holds;
+
+  // Inheritors still to be visited
+  std::vector<std::pair<Entry*, std::shared_ptr<ConfigManager>>> pending;
 
   {
-    std::lock_guard<autowiring::spin_lock> lk(m_lock);
-    auto q = m_config.find(name);
-    if (q == m_config.end())
-      q = m_config.emplace(name, Entry{}).first;
+    // Transactions are published one at a time, and readers of several entries retry while the
+    // sequence is odd or if it changes as they read
+    std::unique_lock<std::mutex> lk(m_tree->applyLock, std::defer_lock);
+    if (transaction) {
+      lk.lock();
+      m_tree->applySequence++;
+    }
+    auto done = MakeAtExit([&] {
+      if (transaction)
+        m_tree->applySequence++;
+    });
+
+    for (const auto& e : staged) {
+      Entry& entry = *e.first;
+      std::lock_guard<autowiring::spin_lock> elk(entry.lock);
+      entry.value = e.second;
+      entry.overridden = true;
+      affected.push_back(&entry);
+      CollectInheritorsUnsafe(entry, pending);
+    }
+
+    // Invalidate the cached values of inheriting entries, one entry lock at a time.  Entries with
+    // overrides of their own are not affected, and neither are their descendants.
+    while (!pending.empty()) {
+      auto next = std::move(pending.back());
+      pending.pop_back();
+
+      Entry& inheritor = *next.first;
+      std::lock_guard<autowiring::spin_lock> elk(inheritor.lock);
+      if (inheritor.overridden)
+        continue;
+      inheritor.stale = true;
+      inheritor.value.reset();
+      affected.push_back(&inheritor);
+      holds.push_back(std::move(next.second));
+      CollectInheritorsUnsafe(inheritor, pending);
+    }
+  }
+
+  // Mark the fields attached to affected entries, and update each object they belong to once
+  std::vector<Registrant*> registrants;
+  std::unordered_set<Registrant*> marked;
+  for (Entry* pEntry : affected) {
+    std::lock_guard<autowiring::spin_lock> lk(pEntry->pShard->lock);
+    for (const auto& attachment : pEntry->attached) {
+      Registrant& registrant = *attachment.pRegistrant;
+      {
+        std::lock_guard<autowiring::spin_lock> rlk(registrant.lock);
+        registrant.fields[attachment.index].pending = true;
+      }
+      if (marked.insert(&registrant).second)
+        registrants.push_back(&registrant);
+    }
+  }
+
+  for (Registrant* pRegistrant : registrants)
+    pRegistrant->onChanged();
+}
+
+void ConfigManager::Update(Registrant& registrant, bool all) {
+  std::vector<Registrant::Field*> fields;
+  {
+    std::lock_guard<autowiring::spin_lock> lk(registrant.lock);
+    for (auto& field : registrant.fields)
+      if (all || field.pending) {
+        field.pending = false;
+        fields.push_back(&field);
+      }
+  }
+  if (fields.empty())
+    return;
+
+  std::vector<Entry*> entries;
+  entries.reserve(fields.size());
+  for (const Registrant::Field* pField : fields)
+    entries.push_back(pField->pEntry);
+  auto values = ResolveAll(entries);
+
+  // Every field is assigned before any of them announces its new value
+  for (size_t i = 0; i < fields.size(); i++)
+    fields[i]->marshaller->stage(fields[i]->pField, values[i] ? values[i]->c_str() : "");
+  for (const Registrant::Field* pField : fields)
+    pField->marshaller->notify(pField->pField);
+}
 
-    pEntry = &q->second;
+void ConfigManager::SetEntry(Entry& entry, std::string value) {
+  Publish({ { &entry, std::make_shared<const std::string>(std::move(value)) } }, false);
+}
 
-    // If we are registered on this level, we need to unregister with the parent,
-    // because this level is overriding the parent's value
-    if (pEntry->reg)
-      pEntry->reg.clear();
+void ConfigManager::Set(const std::string& name, std::string value) {
+  Entry* pEntry;
+  {
+    size_t hash = Hash(name);
+    Shard& shard = ShardFor(hash);
+    std::lock_guard<autowiring::spin_lock> lk(shard.lock);
+    bool created;
+    pEntry = &FindOrCreateUnsafe(shard, hash, name, created);
   }
+  SetEntry(*pEntry, std::move(value));
+}
+
+void ConfigManager::Set(const Key& key, std::string value) {
+  SetEntry(*key.pEntry, std::move(value));
+}
 
-  // Sequenced value assignment:
-  pEntry->onChanged.invoke(
-    [pEntry] (std::string&& rhs) {
-      pEntry->value = std::move(rhs);
-    },
-    std::move(value)
+void ConfigManager::Apply(const std::vector<std::pair<std::string, std::string>>& values) {
+  // Sort the values by shard so that each shard is locked only once while entries are located
+  struct staged_value {
+    size_t hash;
+    const std::pair<std::string, std::string>* pValue;
+  };
+  std::vector<staged_value> order;
+  order.reserve(values.size());
+  for (const auto& value : values)
+    order.push_back({ Hash(value.first), &value });
+  std::stable_sort(
+    order.begin(),
+    order.end(),
+    [] (const staged_value& lhs, const staged_value& rhs) {
+      return lhs.hash % c_nShards < rhs.hash % c_nShards;
+    }
   );
-  pEntry->onChanged();
+
+  // Stage every value.  Repeated keys collapse onto a single entry, the last value wins.
+  std::vector<std::pair<Entry*, std::shared_ptr<const std::string>>> staged;
+  std::unordered_map<Entry*, size_t> positions;
+  staged.reserve(values.size());
+  for (size_t i = 0; i < order.size();) {
+    Shard& shard = ShardFor(order[i].hash);
+    std::lock_guard<autowiring::spin_lock> lk(shard.lock);
+    for (; i < order.size() && &ShardFor(order[i].hash) == &shard; i++) {
+      bool created;
+      Entry* pEntry = &FindOrCreateUnsafe(shard, order[i].hash, order[i].pValue->first, created);
+      auto snapshot = std::make_shared<const std::string>(order[i].pValue->second);
+
+      auto q = positions.find(pEntry);
+      if (q == positions.end()) {
+        positions[pEntry] = staged.size();
+        staged.emplace_back(pEntry, std::move(snapshot));
+      }
+      else
+        staged[q->second].second = std::move(snapshot);
+    }
+  }
+
+  Validate(staged);
+  Publish(staged, true);
+}
+
+void ConfigManager::ApplyFile(const char* path) {
+  mapped_file file(path);
+  Apply(Parse(file.data(), file.size()));
+}
+
+static bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+std::vector<std::pair<std::string, std::string>> ConfigManager::Parse(const char* pData, size_t ncb) {
+  std::vector<std::pair<std::string, std::string>> retVal;
+  const char* pEnd = pData + ncb;
+  size_t lineNo = 0;
+  for (const char* pLine = pData; pLine < pEnd;) {
+    lineNo++;
+    const char* pEol = std::find(pLine, pEnd, '\n');
+    const char* pNext = pEol == pEnd ? pEnd : pEol + 1;
+
+    // Trim the line, skip blank lines and comments
+    while (pLine < pEol && IsSpace(*pLine))
+      pLine++;
+    while (pLine < pEol && IsSpace(pEol[-1]))
+      pEol--;
+    if (pLine == pEol || *pLine == '#') {
+      pLine = pNext;
+      continue;
+    }
+
+    const char* pEq = std::find(pLine, pEol, '=');
+    const char* pKeyEnd = pEq;
+    while (pKeyEnd > pLine && IsSpace(pKeyEnd[-1]))
+      pKeyEnd--;
+    if (pEq == pEol || pKeyEnd == pLine)
+      throw autowiring_error("Malformed configuration entry on line " + std::to_string(lineNo));
+
+    const char* pValue = pEq + 1;
+    while (pValue < pEol && IsSpace(*pValue))
+      pValue++;
+
+    retVal.emplace_back(
+      std::piecewise_construct,
+      std::forward_as_tuple(pLine, pKeyEnd),
+      std::forward_as_tuple(pValue, pEol)
+    );
+    pLine = pNext;
+  }
+  return retVal;
 }
@@ -7,10 +7,13 @@
 #include "optional.h"
 #include "signal.h"
 #include "spin_lock.h"
+#include <atomic>
 #include <functional>
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include MEMORY_HEADER
+#include MUTEX_HEADER
 
 namespace autowiring {
   struct WhenWatcher {
@@ -53,43 +56,92 @@ namespace autowiring {
     {}
 
     ConfigManager(std::shared_ptr<ConfigManager> pParent);
+    ~ConfigManager(void);
 
   private:
+    // Lock on the metadata and watcher collections
     mutable spin_lock m_lock;
 
     // Parent configuration, if one exists
     std::shared_ptr<ConfigManager> m_pParent;
 
+    // State shared by every manager in a single configuration hierarchy
+    struct Tree {
+      // Serializes calls to Apply
+      std::mutex applyLock;
+
+      // Odd while an Apply is publishing its values, incremented by two with each Apply.  Readers of
+      // several entries retry if this changes while they read.
+      std::atomic<uint64_t> applySequence{0};
+    };
+
+    // The hierarchy this manager belongs to, shared with the parent
+    const std::shared_ptr<Tree> m_tree;
+
+    struct Shard;
+    struct Registrant;
+
     // A single entry, which has a string representation part paired
     // with a pointer to the value part
     struct Entry {
       struct Attachment;
 
-      Entry(void) = default;
+      Entry(std::string name) :
+        name(std::move(name))
+      {}
       Entry(const Entry&) = delete;
       Entry(Entry&& rhs) :
+        name(std::move(rhs.name)),
+        pShard(rhs.pShard),
+        attached(std::move(rhs.attached)),
         value(std::move(rhs.value)),
-        attached(std::move(rhs.attached))
+        stale(rhs.stale),
+        pParentEntry(rhs.pParentEntry),
+        overridden(rhs.overridden),
+        inheritors(std::move(rhs.inheritors)),
+        owner(std::move(rhs.owner))
       {}
 
-      // Signal asserted when the value changes:
-      mutable signal<void()> onChanged;
+      // The name of this entry
+      const std::string name;
+
+      // The shard holding this entry
+      Shard* pShard = nullptr;
 
-      // Fields attached on this entry:
+      // Fields attached on this entry, guarded by the lock of the shard holding the entry:
       std::vector<Attachment> attached;
 
-      // The value held here
-      std::string value;
+      // Lock on the value, linkage, and override state of this entry.  Where a thread holds the locks
+      // of several entries, it acquires the lock of a child entry before that of its parent.
+      mutable spin_lock lock;
+
+      // The value held here.  Snapshots are immutable and are shared by all entries that inherit
+      // them.  If this entry inherits its value, this is a cached copy of the nearest ancestor's
+      // value, and is only valid if the entry is not stale.
+      std::shared_ptr<const std::string> value;
+
+      // Set when an ancestor's value changes, cleared when the value is next resolved
+      bool stale = true;
 
-      // If we are taking on our value from the ancestor, this holds the parent
-      // registration object.
-      registration_t reg;
+      // The entry on the parent manager from which this entry inherits, if any
+      Entry* pParentEntry = nullptr;
+
+      // Set once a value has been assigned to this entry directly
+      bool overridden = false;
+
+      // Entries on child managers which are linked to this entry
+      std::vector<Entry*> inheritors;
+
+      // The manager holding this entry, set only for entries linked to a parent
+      std::weak_ptr<ConfigManager> owner;
 
       struct Attachment {
         Attachment(void) = default;
-        Attachment(const config_field& configField, void* pField) :
+        Attachment(const config_field& configField, void* pField, Registrant* pRegistrant, size_t index) :
           configField(&configField),
-          pField(pField)
+          pField(pField),
+          pRegistrant(pRegistrant),
+          index(index)
         {
           bound_metadata = configField.metadata->clone();
           bound_metadata->bind(configField, pField);
@@ -98,7 +150,9 @@ namespace autowiring {
         Attachment(Attachment&& rhs) :
           configField(rhs.configField),
           bound_metadata(std::move(rhs.bound_metadata)),
-          pField(rhs.pField)
+          pField(rhs.pField),
+          pRegistrant(rhs.pRegistrant),
+          index(rhs.index)
         {}
 
         // Field proper
@@ -107,6 +161,10 @@ namespace autowiring {
         // Object proper
         void* pField = nullptr;
 
+        // The registered object this field belongs to, and the position of the field in it
+        Registrant* pRegistrant = nullptr;
+        size_t index = 0;
+
         // Metadata copy, taken from the field, required because we bind all of this metadata
         std::unique_ptr<metadata_pack_base> bound_metadata;
 
@@ -115,13 +173,69 @@ namespace autowiring {
           configField = rhs.configField;
           bound_metadata = std::move(rhs.bound_metadata);
           pField = rhs.pField;
+          pRegistrant = rhs.pRegistrant;
+          index = rhs.index;
           return *this;
         }
       };
     };
 
+    // An object registered with this manager.  Fields of the object are updated as a group:  all of
+    // the fields affected by a single Set or Apply are assigned before any of them raises a change
+    // notification.
+    struct Registrant {
+      Registrant(std::shared_ptr<void> pObj) :
+        pObj(std::move(pObj))
+      {}
+
+      struct Field {
+        Entry* pEntry;
+        const marshaller_base* marshaller;
+        void* pField;
+
+        // Set when the entry has changed and the field has not yet been updated, guarded by lock
+        bool pending;
+      };
+
+      // The object proper, held for as long as it can be updated
+      const std::shared_ptr<void> pObj;
+
+      // Every field of the object.  Populated during registration before the field is attached,
+      // and never changed after that.
+      std::vector<Field> fields;
+
+      // Lock on the pending flags
+      spin_lock lock;
+
+      // Asserted when fields have pending changes.  Assertions made while the object is being
+      // updated are handed to the updating thread, so updates of one object never overlap.
+      signal<void()> onChanged;
+    };
+
+    // Objects registered with this manager, guarded by m_lock
+    std::vector<std::unique_ptr<Registrant>> m_registrants;
+
+    // A partition of the configuration values.  Entries are keyed by the hash of their name,
+    // which is computed once per string-based operation and is used to select the shard as well.
+    struct Shard {
+      mutable spin_lock lock;
+      std::unordered_multimap<size_t, Entry> entries;
+    };
+
+    static const size_t c_nShards = 16;
+
     // All configuration values
-    std::unordered_map<std::string, Entry> m_config;
+    Shard m_shards[c_nShards];
+
+    static size_t Hash(const std::string& name) { return std::hash<std::string>{}(name); }
+    Shard& ShardFor(size_t hash) { return m_shards[hash % c_nShards]; }
+    const Shard& ShardFor(size_t hash) const { return m_shards[hash % c_nShards]; }
+
+    // Finds an entry in the specified shard, returns nullptr if not found.  The shard lock must be held.
+    static Entry* FindUnsafe(const Shard& shard, size_t hash, const std::string& name);
+
+    // Finds an entry, creating it without any parent linkage if it does not exist.  The shard lock must be held.
+    static Entry& FindOrCreateUnsafe(Shard& shard, size_t hash, const std::string& name, bool& created);
 
     // Cache of metadata values to event types that would be asserted for those values:
     std::unordered_multimap<auto_id, config_event> metadata_collection;
@@ -132,13 +246,77 @@ namespace autowiring {
     // Adds a watcher on a specified type
     void WhenInternal(const std::shared_ptr<WhenWatcher>& watcher);
 
-    // Unsynchronized version of GetEntry
-    Entry& GetEntryUnsafe(const std::string& name);
+    // Unsynchronized version of GetEntry, the lock on the entry's shard must be held
+    Entry& GetEntryUnsafe(Shard& shard, size_t hash, const std::string& name);
 
     // Gets an entry out of the configuration map
     Entry& GetEntry(const std::string& name);
 
+    // Obtains the value of an entry, reading through to the nearest ancestor if the entry does
+    // not have a value of its own.  The entry's lock must be held.
+    static std::shared_ptr<const std::string> ResolveUnsafe(Entry& entry);
+
+    // Locked version of ResolveUnsafe
+    static std::shared_ptr<const std::string> Resolve(Entry& entry);
+
+    // Resolves the values of several entries such that none of them reflects only part of an Apply
+    std::vector<std::shared_ptr<const std::string>> ResolveAll(const std::vector<Entry*>& entries) const;
+
+    // Assigns the pending fields of a registered object, or all of its fields, from a consistent
+    // set of values, and then raises the change notifications of those fields
+    void Update(Registrant& registrant, bool all);
+
+    // Appends the inheritors of an entry, together with their managers, to the passed list.  The
+    // entry's lock must be held.
+    static void CollectInheritorsUnsafe(const Entry& entry, std::vector<std::pair<Entry*, std::shared_ptr<ConfigManager>>>& pending);
+
+    // Throws if any field that would receive one of the staged values cannot unmarshal it, which
+    // includes the fields attached to entries that inherit a staged value
+    static void Validate(const std::vector<std::pair<Entry*, std::shared_ptr<const std::string>>>& staged);
+
+    // Breaks the link between an entry and its parent entry, if any, retaining the current value
+    static void Detach(Entry& entry);
+
+    // Assigns the staged values, invalidates the cached values of every entry that inherits from
+    // them, and then updates each object with fields attached to any of these entries once.  A
+    // transaction is never observed in part by a Get of several keys.
+    void Publish(const std::vector<std::pair<Entry*, std::shared_ptr<const std::string>>>& staged, bool transaction);
+
+    // Assigns a value to the specified entry and notifies listeners
+    void SetEntry(Entry& entry, std::string value);
+
+    // Returns the value of the specified entry
+    std::string GetEntryValue(Entry& entry) const;
+
   public:
+    /// <summary>
+    /// An interned handle to a single entry on a particular ConfigManager
+    /// </summary>
+    /// <remarks>
+    /// Handles are obtained from ConfigManager::Intern, and may only be used with the manager that
+    /// issued them.  Operations on a handle neither hash the key nor take any shard lock.  A handle
+    /// remains valid for as long as the issuing manager exists.
+    /// </remarks>
+    class Key {
+    public:
+      Key(void) = default;
+
+    private:
+      explicit Key(Entry* pEntry) :
+        pEntry(pEntry)
+      {}
+
+      Entry* pEntry = nullptr;
+
+      friend class ConfigManager;
+
+    public:
+      explicit operator bool(void) const { return !!pEntry; }
+
+      /// <returns>The name of the entry referred to by this key</returns>
+      const std::string& name(void) const { return pEntry->name; }
+    };
+
     /// <summary>
     /// Breaks any link this manager may have with its parent
     /// </summary>
@@ -179,14 +357,81 @@ namespace autowiring {
       WhenInternal(watcher);
     }
 
+    /// <summary>
+    /// Obtains a handle to the named entry, creating the entry if necessary
+    /// </summary>
+    /// <remarks>
+    /// If the entry does not exist on this manager, it is created and inherits its value from the
+    /// parent manager in the same way as entries created when an object is registered.
+    /// </remarks>
+    Key Intern(const std::string& name);
+
     /// <summary>
     /// Gets the current configuration value from the map
     /// </summary>
     std::string Get(const std::string& name) const;
 
+    /// <summary>
+    /// Gets the current configuration value of an interned entry
+    /// </summary>
+    std::string Get(const Key& key) const;
+
+    /// <summary>
+    /// Gets the current configuration values of several interned entries as a consistent set
+    /// </summary>
+    /// <remarks>
+    /// If an Apply publishes while the values are being read, they are read again, so the result never
+    /// reflects only part of a set applied with Apply.
+    /// </remarks>
+    std::vector<std::string> Get(const std::vector<Key>& keys) const;
+
     /// <summary>
     /// Sets the named config value in the map
     /// </summary>
     void Set(const std::string &name, std::string value);
+
+    /// <summary>
+    /// Sets the config value of an interned entry
+    /// </summary>
+    void Set(const Key& key, std::string value);
+
+    /// <summary>
+    /// Sets many config values as a single transaction
+    /// </summary>
+    /// <remarks>
+    /// All values are staged before any of them is published, and calls to Apply on the same hierarchy
+    /// are published one at a time.  Each Get observes either the new or the old value, and a Get
+    /// of several keys observes either the complete set or none of it.  If a key appears more than
+    /// once, the last value is used.
+    ///
+    /// Registered objects are updated after all values have been published, once per object.  Every
+    /// affected field of an object is assigned before any of them raises a change notification, so
+    /// a listener on one field observes the new values of the object's other fields.
+    ///
+    /// Before anything is published, every value is checked by the marshaller of each field that
+    /// would receive it.  If any field rejects its value, the marshaller's exception is thrown and no
+    /// values are changed.
+    /// </remarks>
+    void Apply(const std::vector<std::pair<std::string, std::string>>& values);
+
+    /// <summary>
+    /// Reads a flat key/value file and applies its contents as a single transaction
+    /// </summary>
+    /// <remarks>
+    /// The file is memory mapped and parsed in full before anything is applied, see Parse for the
+    /// format.  Throws autowiring_error if the file cannot be read or is malformed, and rejects
+    /// values in the same way as Apply.  In either case no values are changed.
+    /// </remarks>
+    void ApplyFile(const char* path);
+
+    /// <summary>
+    /// Parses a flat key/value buffer
+    /// </summary>
+    /// <remarks>
+    /// Each line has the form key=value.  Leading and trailing whitespace is removed from both the
+    /// key and the value, blank lines are ignored, and lines starting with # are comments.  Throws
+    /// autowiring_error if a non-blank line has no key or no '=' separator.
+    /// </remarks>
+    static std::vector<std::pair<std::string, std::string>> Parse(const char* pData, size_t ncb);
   };
 }
@@ -0,0 +1,34 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "ContextTelemetry.h"
+#include "ContextEnumerator.h"
+#include "CoreContext.h"
+#include "demangle.h"
+
+using namespace autowiring;
+
+std::vector<RunnableTelemetry> autowiring::GetContextTelemetry(const std::shared_ptr<CoreContext>& root) {
+  std::vector<RunnableTelemetry> retVal;
+
+  // Runnables remain valid for as long as the enumerator holds their context
+  for (const auto& ctxt : ContextEnumerator(root))
+    for (CoreRunnable* pRunnable : ctxt->GetRunnables()) {
+      retVal.emplace_back();
+      RunnableTelemetry& entry = retVal.back();
+      entry.context = ctxt;
+
+      if (auto pThread = dynamic_cast<BasicThread*>(pRunnable)) {
+        entry.isThread = true;
+        entry.thread = pThread->GetThreadStats();
+        if (pThread->GetName())
+          entry.name = pThread->GetName();
+      }
+      if (auto pQueue = dynamic_cast<DispatchQueue*>(pRunnable)) {
+        entry.isDispatchQueue = true;
+        entry.queue = pQueue->GetDispatchQueueStats();
+      }
+      if (entry.name.empty())
+        entry.name = demangle(typeid(*pRunnable));
+    }
+  return retVal;
+}
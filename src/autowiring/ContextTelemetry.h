@@ -0,0 +1,43 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include "BasicThread.h"
+#include "DispatchQueue.h"
+#include MEMORY_HEADER
+#include <string>
+#include <vector>
+
+class CoreContext;
+
+namespace autowiring {
+
+/// <summary>
+/// Telemetry for a single CoreRunnable
+/// </summary>
+struct RunnableTelemetry {
+  // The context that owns the runnable
+  std::shared_ptr<CoreContext> context;
+
+  // The runnable's thread name, if it is a named BasicThread, otherwise its type name
+  std::string name;
+
+  // CPU accounting, valid if the runnable is a BasicThread
+  bool isThread = false;
+  ThreadStats thread;
+
+  // Queue counters, valid if the runnable is a DispatchQueue
+  bool isDispatchQueue = false;
+  DispatchQueueStats queue;
+};
+
+/// <summary>
+/// Takes a snapshot of the telemetry of every CoreRunnable in the specified context and its descendants
+/// </summary>
+/// <remarks>
+/// Contexts are visited in the order of a ContextEnumerator, and runnables in the order they were added
+/// to their context.  Nothing is reset by this call; rates are obtained by differencing two snapshots.
+/// A CoreThread that is saturated typically shows a utilization near 1, and a queue depth near its cap
+/// or a rising rejection count.
+/// </remarks>
+std::vector<RunnableTelemetry> GetContextTelemetry(const std::shared_ptr<CoreContext>& root);
+
+}
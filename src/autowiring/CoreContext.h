@@ -23,6 +23,7 @@
 #include "TypeRegistry.h"
 #include "TypeUnifier.h"
 
+#include <atomic>
 #include <list>
 #include MEMORY_HEADER
 #include TYPE_INDEX_HEADER
@@ -56,6 +57,15 @@ enum class ShutdownMode {
   Immediate   ///< Shut down immediately, do not attempt to run down thread dispatch queues.
 };
 
+/// <summary>
+/// Policies for assigning processor affinity to threads that do not request an affinity of their own.
+/// </summary>
+enum class ThreadAffinityPolicy {
+  Inherit,    ///< Use the policy of the parent context.  The global context leaves threads unrestricted.
+  None,       ///< Leave threads unrestricted.
+  Spread      ///< Pin each thread to a single core, assigning cores in round-robin order.
+};
+
 /// <summary>
 /// A top-level container class representing an autowiring domain, a minimum
 /// broadcast domain, and a thread execution domain.
@@ -241,6 +251,10 @@ protected:
   // Unlink flag
   bool m_unlinkOnTeardown = true;
 
+  // Affinity policy for threads in this context, and the number of cores assigned under it
+  ThreadAffinityPolicy m_threadAffinityPolicy = ThreadAffinityPolicy::Inherit;
+  std::atomic<size_t> m_nSpreadAssigned{0};
+
   // Creation rules are allowed to refer to private methods in this type
   template<autowiring::construction_strategy, class T, class... Args>
   friend struct autowiring::crh;
@@ -552,6 +566,28 @@ public:
     m_unlinkOnTeardown = unlinkOnTeardown;
   }
 
+  /// <summary>
+  /// Sets the processor affinity policy for threads in this context and in its descendants
+  /// </summary>
+  /// <remarks>
+  /// The policy applies to threads that have not requested an affinity of their own, and is consulted
+  /// when each thread starts.  Descendant contexts may override it with a policy of their own.  Setting
+  /// the Spread policy on a context marked with a sigil distributes the threads of that sigil's context
+  /// tree across the available cores.
+  /// </remarks>
+  void SetThreadAffinityPolicy(ThreadAffinityPolicy policy) {
+    m_threadAffinityPolicy = policy;
+  }
+
+  /// <returns>The processor affinity policy set on this context</returns>
+  ThreadAffinityPolicy GetThreadAffinityPolicy(void) const { return m_threadAffinityPolicy; }
+
+  /// \internal
+  /// <summary>
+  /// Returns the index of the next core to be assigned under the Spread policy
+  /// </summary>
+  size_t NextSpreadIndex(void) { return m_nSpreadAssigned++; }
+
   /// \internal
   /// <summary>
   /// Scans the memo collection for the specified entry, or adds a deferred resolution marker if resolution was not possible
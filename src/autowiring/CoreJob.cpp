@@ -2,22 +2,10 @@
 #include "stdafx.h"
 #include "CoreJob.h"
 #include "CoreContext.h"
-#include FUTURE_HEADER
+#include "SystemThreadPool.h"
 
 using namespace autowiring;
 
-// Arm doesn't have std::future, but does have std::chrono. We need to convert from std::chrono
-// to autoboost::chrono when passing arguments to "std::future"(alias to autoboost::future) on arm.
-#if __ANDROID__ && !GCC_CHECK(4, 9)
-autoboost::chrono::nanoseconds NanosecondsForFutureWait(const std::chrono::nanoseconds& time) {
-  return autoboost::chrono::nanoseconds(time.count());
-}
-#else
-std::chrono::nanoseconds NanosecondsForFutureWait(const std::chrono::nanoseconds& time) {
-  return time;
-}
-#endif
-
 CoreJob::CoreJob(const char* name) :
   ContextMember(name)
 {}
@@ -48,45 +36,89 @@ void CoreJob::OnPended(std::unique_lock<std::mutex>&& lk){
       delete cur;
       cur = next;
     }
-  } else {
-    // Need to ask the thread pool to handle our events again:
-    m_curEventInTeardown = false;
-
-    if (m_curEvent)
-      delete static_cast<std::future<void>*>(m_curEvent);
-
-    m_curEvent = new std::future<void>(
-      std::async(
-        std::launch::async,
-        [this, outstanding] () mutable {
-          this->DispatchAllAndClearCurrent();
-          outstanding.reset();
-        }
-      ));
+    return;
   }
+
+  // Concurrent pends may all have seen the job idle, only the one that claims it submits a run
+  if(!m_curEventInTeardown.exchange(false))
+    return;
+
+  // Need to ask the thread pool to handle our events again:
+  if(SubmitRun(outstanding))
+    return;
+
+  // The pool refused the run.  Go back to idle and release waiters; remaining events will be run
+  // the next time something is pended.
+  if(!lk.owns_lock())
+    lk = std::unique_lock<std::mutex>(m_dispatchLock);
+  m_curEventInTeardown = true;
+  m_queueUpdated.notify_all();
 }
 
-void CoreJob::DispatchAllAndClearCurrent(void) {
+bool CoreJob::SubmitRun(std::shared_ptr<CoreObject> outstanding) {
+  return GetJobPool() += [this, outstanding] () mutable {
+    this->DispatchAllAndClearCurrent(outstanding);
+    outstanding.reset();
+  };
+}
+
+ThreadPool& CoreJob::GetJobPool(void) {
+  // Started on first use and kept running for the life of the process, so that pool threads are
+  // reused across bursts instead of being created per burst
+  static const struct JobPool {
+    JobPool(void) :
+      pool(SystemThreadPool::New()),
+      token(pool->Start())
+    {}
+
+    const std::shared_ptr<SystemThreadPool> pool;
+    const std::shared_ptr<void> token;
+  } s_jobPool;
+  return *s_jobPool.pool;
+}
+
+void CoreJob::DispatchAllAndClearCurrent(const std::shared_ptr<CoreObject>& outstanding) {
   CurrentContextPusher pshr(GetContext());
   for(;;) {
-    // Trivially run down the queue as long as we're in the pool:
-    this->DispatchAllEvents();
+    // The budget may be changed concurrently, so each pass reads it once
+    const size_t budgetEvents = m_budgetEvents;
+    const std::chrono::nanoseconds budgetTime = m_budgetTime;
+
+    // Run down the queue, within our budget, as long as we're in the pool:
+    try {
+      this->DispatchAllEvents(budgetEvents, budgetTime);
+    }
+    catch (...) {
+      // Nowhere to report this, but waiters must still be released.  Remaining events
+      // will be run the next time something is pended.
+      std::lock_guard<std::mutex> lk(m_dispatchLock);
+      m_curEventInTeardown = true;
+      m_queueUpdated.notify_all();
+      return;
+    }
 
     // Check the size of the queue.  Could be that someone added something
     // between when we finished looping, and when we obtained the lock, and
     // we don't want to exit our pool if that has happened.
-    std::lock_guard<std::mutex> lk(m_dispatchLock);
-    if(AreAnyDispatchersReady())
-      continue;
-
-    // Indicate that we're tearing down and will be done very soon.  This is
-    // a signal to consumers that a call to m_curEvent.wait() will be nearly
-    // non-blocking.
-    m_curEventInTeardown = true;
-    break;
-  }
+    {
+      std::lock_guard<std::mutex> lk(m_dispatchLock);
+      if(!AreAnyDispatchersReady()) {
+        // Indicate that we're done.  The notification is made under lock, because a
+        // waiter that observes this flag may destroy this object as soon as the lock
+        // is released.
+        m_curEventInTeardown = true;
+        m_queueUpdated.notify_all();
+        return;
+      }
+    }
 
-  m_queueUpdated.notify_all();
+    // Events remain, because our budget ran out or because they were pended after the drain
+    // finished.  Let other jobs in the pool have a turn before we handle them.  This object must
+    // not be touched once the new run has been submitted.  If the pool refuses, keep going here.
+    if(budgetEvents != ~size_t(0) || budgetTime != std::chrono::nanoseconds::max())
+      if(SubmitRun(outstanding))
+        return;
+  }
 }
 
 bool CoreJob::OnStart(void) {
@@ -122,21 +154,11 @@ void CoreJob::OnStop(bool graceful) {
 }
 
 void CoreJob::DoAdditionalWait(void) {
-  if (m_curEvent) {
-    std::future<void>* ptr = static_cast<std::future<void>*>(m_curEvent);
-    ptr->wait();
-    delete ptr;
-    m_curEvent = nullptr;
-  }
+  std::unique_lock<std::mutex> lk(m_dispatchLock);
+  m_queueUpdated.wait(lk, [this] { return m_curEventInTeardown.load(); });
 }
 
 bool CoreJob::DoAdditionalWait(std::chrono::nanoseconds timeout) {
-  if (!m_curEvent)
-    return true;
-
-  std::future<void>* ptr = static_cast<std::future<void>*>(m_curEvent);
-  auto status = ptr->wait_for(NanosecondsForFutureWait(timeout));
-  delete ptr;
-  m_curEvent = nullptr;
-  return status == std::future_status::ready;
+  std::unique_lock<std::mutex> lk(m_dispatchLock);
+  return m_queueUpdated.wait_for(lk, timeout, [this] { return m_curEventInTeardown.load(); });
 }
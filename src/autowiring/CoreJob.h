@@ -3,7 +3,19 @@
 #include "ContextMember.h"
 #include "CoreRunnable.h"
 #include "DispatchQueue.h"
+#include <atomic>
 
+namespace autowiring {
+  class ThreadPool;
+}
+
+/// <summary>
+/// A dispatch queue whose events are run on a process-wide persistent thread pool
+/// </summary>
+/// <remarks>
+/// Events pended to a single CoreJob are run serially and in order, but not necessarily on the same
+/// thread.  A job holds a pool thread only while it has events ready; an idle job holds none.
+/// </remarks>
 class CoreJob:
   public ContextMember,
   public DispatchQueue,
@@ -17,17 +29,34 @@ private:
   // Flag, set to true when it's time to start dispatching
   bool m_running = false;
 
-  // The current outstanding async in the thread pool, if one exists:
-  void* m_curEvent = nullptr;
+  // Flag, false while a dispatch run for this job is outstanding in the shared pool.  OnPended may be
+  // called without m_dispatchLock, so a run is claimed by exchanging this flag; exactly one run is ever
+  // outstanding.  It is set under m_dispatchLock, and the run sets it and signals m_queueUpdated as its
+  // last access of this object.
+  std::atomic<bool> m_curEventInTeardown{true};
+
+  // Limits on the work done by a single run in the shared pool, see SetDispatchBudget.  These may be
+  // assigned while a run is in progress on a pool thread, so they are atomic.
+  std::atomic<size_t> m_budgetEvents{~size_t(0)};
+  std::atomic<std::chrono::nanoseconds> m_budgetTime{std::chrono::nanoseconds::max()};
 
-  // Flag, indicating whether curEvent is in a teardown pathway.  This
-  // flag is highly stateful.
-  bool m_curEventInTeardown = true;
+  /// <summary>
+  /// Submits a dispatch run for this job to the shared pool
+  /// </summary>
+  /// <returns>False if the pool refused the run</returns>
+  bool SubmitRun(std::shared_ptr<CoreObject> outstanding);
 
   /// <summary>
   /// Invokes DispatchAllEvents and safely nullifies the current event
   /// </summary>
-  void DispatchAllAndClearCurrent(void);
+  /// <remarks>
+  /// If events remain when the budget is exhausted, a new run is submitted to the back of the pool's
+  /// queue and this run ends, so that other jobs sharing the pool are not starved.
+  /// </remarks>
+  void DispatchAllAndClearCurrent(const std::shared_ptr<CoreObject>& outstanding);
+
+  /// <returns>The started thread pool shared by all CoreJob instances</returns>
+  static autowiring::ThreadPool& GetJobPool(void);
 
 protected:
   // DispatchQueue overrides
@@ -37,6 +66,20 @@ protected:
   void Abort(void);
 
 public:
+  /// <summary>
+  /// Limits the number of events, and the time, that one run of this job may take in the shared pool
+  /// </summary>
+  /// <remarks>
+  /// By default a run continues until the queue is empty.  With a budget, a run that exhausts its budget
+  /// gives up its pool thread and resumes behind any other work already waiting in the pool.  Events are
+  /// still run serially and in order.  This may be called at any time; a run already in progress picks
+  /// up the new budget when it next checks the queue.
+  /// </remarks>
+  void SetDispatchBudget(size_t maxEvents, std::chrono::nanoseconds budget = std::chrono::nanoseconds::max()) {
+    m_budgetEvents = maxEvents;
+    m_budgetTime = budget;
+  }
+
   // "CoreRunnable" overrides
   bool OnStart(void) override;
   void OnStop(bool graceful) override;
@@ -3,6 +3,7 @@
 #include "CoreThread.h"
 #include "BasicThreadStateBlock.h"
 #include "CurrentContextPusher.h"
+#include <algorithm>
 
 CoreThread::CoreThread(const char* pName):
   BasicThread(pName)
@@ -21,9 +22,39 @@ void CoreThread::DoRunLoopCleanup(std::shared_ptr<CoreContext>&& ctxt, std::shar
   BasicThread::DoRunLoopCleanup(std::move(ctxt), std::move(refTracker));
 }
 
+void CoreThread::SetWaitPolicy(ThreadWaitPolicy policy, std::chrono::nanoseconds maxSpin) {
+  m_maxSpinNs = maxSpin.count();
+  m_waitPolicy = policy;
+}
+
 void CoreThread::Run() {
   while(!ShouldStop())
-    WaitForEvent();
+    if (m_waitPolicy == ThreadWaitPolicy::SpinThenPark)
+      WaitForEventAdaptive();
+    else
+      WaitForEvent();
+}
+
+void CoreThread::WaitForEventAdaptive(void) {
+  // Anything already ready can be run without waiting at all
+  if (DispatchEvent())
+    return;
+
+  const std::chrono::nanoseconds maxSpin{m_maxSpinNs};
+  const std::chrono::nanoseconds minSpin = maxSpin / 32;
+  m_spinInterval = std::max(minSpin, std::min(maxSpin, m_spinInterval));
+
+  if (SpinForEvent(m_spinInterval)) {
+    // Spinning paid off, be willing to spin for longer next time
+    m_spinInterval = std::min(maxSpin, m_spinInterval * 2);
+    if (DispatchEvent())
+      return;
+  }
+  else
+    // Nothing arrived in time, back off
+    m_spinInterval = std::max(minSpin, m_spinInterval / 2);
+
+  WaitForEvent();
 }
 
 void CoreThread::OnStop(bool graceful) {
@@ -2,11 +2,25 @@
 #pragma once
 #include "BasicThread.h"
 #include "DispatchQueue.h"
+#include <atomic>
 #include MEMORY_HEADER
 
 class CoreContext;
 class CoreThread;
 
+/// <summary>
+/// Determines how a CoreThread waits for work when its dispatch queue is empty
+/// </summary>
+enum class ThreadWaitPolicy {
+  /// Block on the dispatch queue immediately.  This is the default.
+  Park,
+
+  /// Busy-wait for a bounded interval before blocking.  The interval is tuned automatically
+  /// between the configured maximum and a small fraction of it, growing when events tend to
+  /// arrive while spinning and shrinking when they do not.
+  SpinThenPark
+};
+
 /// <summary>
 /// Provides a dispatch queue that creates a thread to run jobs (in the form of
 /// lambda functions) in the order added.
@@ -36,6 +50,19 @@ public:
   CoreThread(const char* pName = nullptr);
   virtual ~CoreThread(void);
 
+private:
+  // Wait policy, and the longest interval that the SpinThenPark policy will spin
+  std::atomic<ThreadWaitPolicy> m_waitPolicy{ThreadWaitPolicy::Park};
+  std::atomic<int64_t> m_maxSpinNs{0};
+
+  // Current spin interval, only accessed from this thread
+  std::chrono::nanoseconds m_spinInterval{0};
+
+  /// <summary>
+  /// Spins for the current spin interval before falling back to WaitForEvent, and retunes the interval
+  /// </summary>
+  void WaitForEventAdaptive(void);
+
 protected:
   /// <summary>
   /// Overridden here so we can rundown the dispatch queue
@@ -43,6 +70,21 @@ protected:
   virtual void DoRunLoopCleanup(std::shared_ptr<CoreContext>&& ctxt, std::shared_ptr<CoreObject>&& refTracker) override;
 
 public:
+  /// <summary>
+  /// Sets the policy this thread uses to wait for events
+  /// </summary>
+  /// <param name="policy">The policy to use</param>
+  /// <param name="maxSpin">For SpinThenPark, the longest interval to spin before blocking</param>
+  /// <remarks>
+  /// SpinThenPark saves the cost of a context switch when events arrive in quick succession, at the
+  /// expense of CPU time that could be used by other threads.  It is intended for latency-sensitive
+  /// threads, and is best combined with a dedicated core.  This method may be called at any time.
+  /// </remarks>
+  void SetWaitPolicy(ThreadWaitPolicy policy, std::chrono::nanoseconds maxSpin = std::chrono::microseconds(50));
+
+  /// <returns>The policy this thread uses to wait for events</returns>
+  ThreadWaitPolicy GetWaitPolicy(void) const { return m_waitPolicy; }
+
   /// \internal
   /// <summary>
   /// Called automatically to begin core thread execution.
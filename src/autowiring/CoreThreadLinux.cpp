@@ -6,10 +6,103 @@
 #include <sys/resource.h>
 #include <pthread.h>
 #include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <alloca.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include THREAD_HEADER
+
+// Flags for get_mempolicy, from numaif.h, which is not available everywhere
+#if !defined(MPOL_F_NODE)
+#define MPOL_F_NODE (1<<0)
+#endif
+#if !defined(MPOL_F_ADDR)
+#define MPOL_F_ADDR (1<<1)
+#endif
+
+#if !defined(SCHED_DEADLINE)
+#define SCHED_DEADLINE 6
+#endif
+
+namespace {
+  // Layout of the kernel's sched_attr structure, which glibc does not always declare
+  struct linux_sched_attr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+  };
+
+  // Moves the calling thread to a realtime policy, settling for a lower priority if that is all
+  // that the process's RLIMIT_RTPRIO allows
+  bool SetRealtimePolicy(int policy, int priority) {
+    const int lo = sched_get_priority_min(policy);
+    const int hi = sched_get_priority_max(policy);
+    sched_param param = {};
+    param.sched_priority = std::max(lo, std::min(hi, priority));
+    if (!pthread_setschedparam(pthread_self(), policy, &param))
+      return true;
+
+    rlimit limit;
+    if (getrlimit(RLIMIT_RTPRIO, &limit) || !limit.rlim_cur || (rlim_t)param.sched_priority <= limit.rlim_cur)
+      return false;
+    param.sched_priority = std::max(lo, (int)limit.rlim_cur);
+    return !pthread_setschedparam(pthread_self(), policy, &param);
+  }
+
+  // Moves the calling thread to SCHED_DEADLINE
+  bool SetDeadlinePolicy(const ThreadScheduling& scheduling) {
+#if defined(SYS_sched_setattr)
+    const int64_t runtime = scheduling.runtime.count();
+    const int64_t period = scheduling.period.count() ? scheduling.period.count() : scheduling.deadline.count();
+    const int64_t deadline = scheduling.deadline.count() ? scheduling.deadline.count() : period;
+    if (runtime <= 0 || deadline < runtime || period < deadline)
+      return false;
+
+    linux_sched_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.sched_policy = SCHED_DEADLINE;
+    attr.sched_runtime = runtime;
+    attr.sched_deadline = deadline;
+    attr.sched_period = period;
+    return !syscall(SYS_sched_setattr, 0, &attr, 0);
+#else
+    return false;
+#endif
+  }
+
+  // Touches the specified number of bytes below the current stack frame, so the pages are resident
+  __attribute__((noinline)) void PrefaultStack(size_t bytes) {
+    // Leave some headroom, overrunning the stack here would be fatal
+    pthread_attr_t attr;
+    if (!pthread_getattr_np(pthread_self(), &attr)) {
+      size_t stackSize = 0;
+      pthread_attr_getstacksize(&attr, &stackSize);
+      pthread_attr_destroy(&attr);
+      const size_t headroom = 64 * 1024;
+      bytes = std::min(bytes, stackSize > 2 * headroom ? stackSize - 2 * headroom : 0);
+    }
+    if (!bytes)
+      return;
+
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    volatile char* pStack = static_cast<volatile char*>(alloca(bytes));
+    for (size_t i = 0; i < bytes; i += pageSize)
+      pStack[i] = 0;
+  }
+}
 
 using std::chrono::seconds;
 using std::chrono::milliseconds;
 using std::chrono::microseconds;
+using std::chrono::nanoseconds;
 
 void BasicThread::SetCurrentThreadName(void) const {
   pthread_setname_np(pthread_self(), m_name);
@@ -20,13 +113,41 @@ std::chrono::steady_clock::time_point BasicThread::GetCreationTime(void) {
 }
 
 void BasicThread::GetThreadTimes(std::chrono::milliseconds& kernelTime, std::chrono::milliseconds& userTime) {
-  rusage usage;
-  getrusage(RUSAGE_SELF, &usage);
-  kernelTime = std::chrono::duration_cast<milliseconds>(seconds(usage.ru_stime.tv_sec) + microseconds(usage.ru_stime.tv_usec));
-  userTime = std::chrono::duration_cast<milliseconds>(seconds(usage.ru_utime.tv_sec) + microseconds(usage.ru_utime.tv_usec));
+  std::lock_guard<std::mutex> lk(m_state->m_lock);
+  if (!m_state->m_thisThread.joinable()) {
+    // Not running, report the times captured when the thread last exited
+    kernelTime = m_state->m_kernelTime;
+    userTime = m_state->m_userTime;
+    return;
+  }
+
+  if (m_state->m_thisThread.get_id() == std::this_thread::get_id()) {
+    // A thread may obtain its own split between kernel and user time
+    rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    kernelTime = std::chrono::duration_cast<milliseconds>(seconds(usage.ru_stime.tv_sec) + microseconds(usage.ru_stime.tv_usec));
+    userTime = std::chrono::duration_cast<milliseconds>(seconds(usage.ru_utime.tv_sec) + microseconds(usage.ru_utime.tv_usec));
+    return;
+  }
+
+  // Another thread's split is not available through pthreads, only its total CPU time, which is
+  // reported as user time
+  clockid_t clock;
+  timespec ts;
+  kernelTime = milliseconds::zero();
+  if (pthread_getcpuclockid(m_state->m_thisThread.native_handle(), &clock) || clock_gettime(clock, &ts))
+    userTime = milliseconds::zero();
+  else
+    userTime = std::chrono::duration_cast<milliseconds>(seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec));
 }
 
 void BasicThread::SetThreadPriority(ThreadPriority threadPriority) {
+  if (m_effectivePolicy != SchedulingPolicy::Default) {
+    // A realtime policy is in effect, which the mapping below would replace
+    m_priority = threadPriority;
+    return;
+  }
+
   struct sched_param param = { 0 };
   int policy = SCHED_OTHER;
   int percent = 0;
@@ -69,3 +190,112 @@ void BasicThread::SetThreadPriority(ThreadPriority threadPriority) {
   pthread_setschedparam(m_state->m_thisThread.native_handle(), policy, &param);
   m_priority = threadPriority;
 }
+
+bool BasicThread::SetThreadAffinity(const std::vector<int>& cores, bool fromThisThread) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int core : cores.empty() ? GetAvailableCores() : cores)
+    if (0 <= core && core < CPU_SETSIZE)
+      CPU_SET(core, &set);
+  if (!CPU_COUNT(&set))
+    return false;
+
+  pthread_t thread = fromThisThread ? pthread_self() : m_state->m_thisThread.native_handle();
+  return !pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+std::vector<int> BasicThread::GetAvailableCores(void) {
+  std::vector<int> cores;
+
+  // The process ID names the main thread, whose mask is the one the process was started with
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (!sched_getaffinity(getpid(), sizeof(set), &set)) {
+    for (int i = 0; i < CPU_SETSIZE; i++)
+      if (CPU_ISSET(i, &set))
+        cores.push_back(i);
+  }
+  else
+    for (int i = 0; i < (int)std::thread::hardware_concurrency(); i++)
+      cores.push_back(i);
+  return cores;
+}
+
+bool BasicThread::GetCoresForMemory(const void* pMem, std::vector<int>& cores) {
+#if defined(SYS_get_mempolicy)
+  int node = -1;
+  if (syscall(SYS_get_mempolicy, &node, nullptr, 0, pMem, MPOL_F_NODE | MPOL_F_ADDR) || node < 0)
+    return false;
+
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+  std::ifstream cpulist(path);
+  if (!cpulist)
+    return false;
+
+  // The list takes the form "0-3,8,10-11"
+  cores.clear();
+  for (int first; cpulist >> first;) {
+    int last = first;
+    if (cpulist.peek() == '-') {
+      cpulist.get();
+      cpulist >> last;
+    }
+    for (int i = first; i <= last; i++)
+      cores.push_back(i);
+    if (cpulist.peek() == ',')
+      cpulist.get();
+  }
+  return !cores.empty();
+#else
+  return false;
+#endif
+}
+
+SchedulingPolicy BasicThread::ApplyScheduling(const ThreadScheduling& scheduling) {
+  // The stack is touched first, so that it is covered even if only current mappings can be locked
+  if (scheduling.stackPrefault)
+    PrefaultStack(scheduling.stackPrefault);
+
+  if (scheduling.lockMemory && !m_memoryLocked) {
+    // Locking future mappings under a finite limit would make allocations fail once the limit is
+    // reached, so only do that when the limit cannot be hit
+    int flags = MCL_CURRENT;
+    rlimit limit;
+    if (!geteuid() || (!getrlimit(RLIMIT_MEMLOCK, &limit) && limit.rlim_cur == RLIM_INFINITY))
+      flags |= MCL_FUTURE;
+    m_memoryLocked = !mlockall(flags);
+  }
+
+  switch (scheduling.policy) {
+  case SchedulingPolicy::Deadline:
+    // If deadline scheduling is refused, FIFO at the requested priority is the closest we can get
+    if (SetDeadlinePolicy(scheduling))
+      return SchedulingPolicy::Deadline;
+    // fall through
+  case SchedulingPolicy::Fifo:
+    if (SetRealtimePolicy(SCHED_FIFO, scheduling.realtimePriority))
+      return SchedulingPolicy::Fifo;
+    break;
+  case SchedulingPolicy::RoundRobin:
+    if (SetRealtimePolicy(SCHED_RR, scheduling.realtimePriority))
+      return SchedulingPolicy::RoundRobin;
+    break;
+  case SchedulingPolicy::Default:
+    break;
+  }
+
+  // Either the default policy was requested or nothing better could be granted.  Drop any realtime
+  // policy that was previously in effect, and restore the mapping of the thread's ThreadPriority,
+  // which SetThreadPriority declined to apply while the realtime policy was in effect.
+  int policy;
+  sched_param param;
+  if (!pthread_getschedparam(pthread_self(), &policy, &param) && (policy == SCHED_FIFO || policy == SCHED_RR || policy == SCHED_DEADLINE)) {
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+
+    m_effectivePolicy = SchedulingPolicy::Default;
+    SetThreadPriority(m_priority);
+  }
+  return SchedulingPolicy::Default;
+}
@@ -34,6 +34,14 @@ std::chrono::steady_clock::time_point BasicThread::GetCreationTime(void) {
 }
 
 void BasicThread::GetThreadTimes(std::chrono::milliseconds& kernelTime, std::chrono::milliseconds& userTime) {
+  std::lock_guard<std::mutex> lk(m_state->m_lock);
+  if (!m_state->m_thisThread.joinable()) {
+    // Not running, report the times captured when the thread last exited
+    kernelTime = m_state->m_kernelTime;
+    userTime = m_state->m_userTime;
+    return;
+  }
+
   // Obtain the thread port from the Unix pthread wrapper
   pthread_t pthread = m_state->m_thisThread.native_handle();
   thread_t threadport = pthread_mach_thread_np(pthread);
@@ -89,3 +97,26 @@ void BasicThread::SetThreadPriority(ThreadPriority threadPriority) {
   pthread_setschedparam(m_state->m_thisThread.native_handle(), policy, &param);
   m_priority = threadPriority;
 }
+
+bool BasicThread::SetThreadAffinity(const std::vector<int>& cores, bool fromThisThread) {
+  // Mac only supports affinity tags, which are hints about cache sharing rather than a restriction
+  // to particular cores.  There is nothing here that we can map a core set to.
+  return false;
+}
+
+std::vector<int> BasicThread::GetAvailableCores(void) {
+  std::vector<int> cores;
+  for (int i = 0; i < (int)std::thread::hardware_concurrency(); i++)
+    cores.push_back(i);
+  return cores;
+}
+
+bool BasicThread::GetCoresForMemory(const void* pMem, std::vector<int>& cores) {
+  // No NUMA support on this platform
+  return false;
+}
+
+SchedulingPolicy BasicThread::ApplyScheduling(const ThreadScheduling& scheduling) {
+  // Realtime policies are not implemented on this platform, ThreadPriority is the closest control
+  return SchedulingPolicy::Default;
+}
@@ -6,6 +6,7 @@
 #include <stdexcept>
 #include <Windows.h>
 #include <Avrt.h>
+#include <Psapi.h>
 
 // Because Windows.h screws up min
 #undef min
@@ -122,6 +123,14 @@ std::chrono::steady_clock::time_point BasicThread::GetCreationTime(void) {
 }
 
 void BasicThread::GetThreadTimes(std::chrono::milliseconds& kernelTime, std::chrono::milliseconds& userTime) {
+  std::lock_guard<std::mutex> lk(m_state->m_lock);
+  if (!m_state->m_thisThread.joinable()) {
+    // Not running, report the times captured when the thread last exited
+    kernelTime = m_state->m_kernelTime;
+    userTime = m_state->m_userTime;
+    return;
+  }
+
   HANDLE hThread = m_state->m_thisThread.native_handle();
 
   FILETIME ftCreate, ftExit, ftKernel, ftUser;
@@ -129,3 +138,50 @@ void BasicThread::GetThreadTimes(std::chrono::milliseconds& kernelTime, std::chr
   kernelTime = std::chrono::duration_cast<milliseconds>(nanoseconds(100 * (int64_t&) ftKernel));
   userTime = std::chrono::duration_cast<milliseconds>(nanoseconds(100 * (int64_t&) ftUser));
 }
+
+bool BasicThread::SetThreadAffinity(const std::vector<int>& cores, bool fromThisThread) {
+  DWORD_PTR mask = 0;
+  for (int core : cores.empty() ? GetAvailableCores() : cores)
+    if (0 <= core && core < (int)(8 * sizeof(DWORD_PTR)))
+      mask |= (DWORD_PTR)1 << core;
+  if (!mask)
+    return false;
+
+  HANDLE hThread = fromThisThread ? GetCurrentThread() : m_state->m_thisThread.native_handle();
+  return SetThreadAffinityMask(hThread, mask) != 0;
+}
+
+std::vector<int> BasicThread::GetAvailableCores(void) {
+  std::vector<int> cores;
+  DWORD_PTR processMask, systemMask;
+  if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+    return cores;
+
+  for (int i = 0; i < (int)(8 * sizeof(DWORD_PTR)); i++)
+    if (processMask & ((DWORD_PTR)1 << i))
+      cores.push_back(i);
+  return cores;
+}
+
+bool BasicThread::GetCoresForMemory(const void* pMem, std::vector<int>& cores) {
+  // The working set query reports the node of a resident page
+  PSAPI_WORKING_SET_EX_INFORMATION info = {};
+  info.VirtualAddress = const_cast<void*>(pMem);
+  if (!QueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info)) || !info.VirtualAttributes.Valid)
+    return false;
+
+  ULONGLONG mask;
+  if (!GetNumaNodeProcessorMask((UCHAR)info.VirtualAttributes.Node, &mask))
+    return false;
+
+  cores.clear();
+  for (int i = 0; i < (int)(8 * sizeof(mask)); i++)
+    if (mask & (1ULL << i))
+      cores.push_back(i);
+  return !cores.empty();
+}
+
+SchedulingPolicy BasicThread::ApplyScheduling(const ThreadScheduling& scheduling) {
+  // Realtime policies are not implemented on this platform, ThreadPriority is the closest control
+  return SchedulingPolicy::Default;
+}
@@ -72,10 +72,11 @@ struct DecorationDisposition
   struct Modifier {
     Modifier(void) = default;
 
-    Modifier(bool is_shared, autowiring::altitude altitude, SatCounter* satCounter) :
+    Modifier(bool is_shared, autowiring::altitude altitude, SatCounter* satCounter, size_t argIndex) :
       is_shared{is_shared},
       altitude{altitude},
-      satCounter{satCounter}
+      satCounter{satCounter},
+      argIndex{argIndex}
     {
       if (satCounter == nullptr)
         throw std::runtime_error("Cannot initialize Modifier with nullptr to SatCounter.");
@@ -93,6 +94,9 @@ struct DecorationDisposition
 
     // The pointer to the satisfaction counter, it should never be nullptr
     SatCounter* satCounter;
+
+    // The index of the modified argument among the AutoFilter's arguments
+    size_t argIndex;
   };
 
   // Modifiers of this decoration, ordered by altitude.  These modifiers do not all become ready to
@@ -116,11 +120,12 @@ struct DecorationDisposition
 
     Subscriber(void) = default;
 
-    Subscriber(bool is_shared, Type type, autowiring::altitude altitude, SatCounter* satCounter) :
+    Subscriber(bool is_shared, Type type, autowiring::altitude altitude, SatCounter* satCounter, size_t argIndex) :
       is_shared{is_shared},
       type{type},
       altitude{altitude},
-      satCounter{satCounter}
+      satCounter{satCounter},
+      argIndex{argIndex}
     {
       if (satCounter == nullptr)
         throw std::runtime_error("Cannot initialize Subscriber with nullptr to SatCounter.");
@@ -138,6 +143,9 @@ struct DecorationDisposition
     // The pointer to the satisfaction counter, it should never be nullptr
     SatCounter* const satCounter;
 
+    // The index of the subscribed argument among the AutoFilter's arguments
+    const size_t argIndex;
+
     bool operator<(const Subscriber& rhs) const {
       return std::tie(altitude, satCounter) < std::tie(rhs.altitude, rhs.satCounter);
     }
@@ -14,3 +14,26 @@ class Deferred {
 public:
   Deferred(DispatchQueue* pQueue) {}
 };
+
+/// <summary>
+/// Marker return type for batched deferred calls
+/// </summary>
+/// <remarks>
+/// Behaves like Deferred, except that packets which become ready for the AutoFilter accumulate in a
+/// lock-free inbox on the DispatchQueue, and all packets accumulated by the time the queue gets to
+/// them are processed in a single dispatch.
+///
+/// If the AutoFilter type also has a member AutoFilterBatch(const std::vector<std::shared_ptr<AutoPacket>>&),
+/// then that member is invoked once per dispatch with every ready packet in place of invoking AutoFilter
+/// once per packet.  The batch routine is handed the packets rather than typed vectors of the AutoFilter's
+/// arguments, so it is responsible for obtaining inputs from, and attaching outputs to, each packet.  The
+/// AutoFilter's outputs which it did not attach to a packet are marked unsatisfiable when it returns.
+/// </remarks>
+class DeferredBatch:
+  public Deferred
+{
+public:
+  DeferredBatch(DispatchQueue* pQueue) :
+    Deferred(pQueue)
+  {}
+};
@@ -2,10 +2,31 @@
 #include "stdafx.h"
 #include "DispatchQueue.h"
 #include "at_exit.h"
+#include <algorithm>
 #include <assert.h>
+#include <vector>
+#include STL_UNORDERED_MAP
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 using namespace autowiring;
 
+// Hints to the processor that we are in a spin-wait loop
+static inline void cpu_relax(void) {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+const size_t DispatchQueue::c_nLanes;
+const size_t DispatchQueue::c_maxBypass;
+
 DispatchQueue::DispatchQueue(void) {}
 
 DispatchQueue::DispatchQueue(size_t dispatchCap):
@@ -16,6 +37,8 @@ DispatchQueue::DispatchQueue(DispatchQueue&& q):
   onAborted(std::move(q.onAborted)),
   m_dispatchCap(q.m_dispatchCap)
 {
+  for (size_t i = 0; i < c_nLanes; i++)
+    m_lanes[i].cap = q.m_lanes[i].cap;
   if (!onAborted)
     *this += std::move(q);
 }
@@ -27,6 +50,7 @@ DispatchQueue::~DispatchQueue(void) {
     delete cur;
     cur = next;
   }
+  DeleteBatchChain(m_pBatchInbox.load(std::memory_order_relaxed));
 }
 
 void DispatchQueue::ClearQueueInternal(bool executeDispatchers) {
@@ -40,6 +64,10 @@ void DispatchQueue::ClearQueueInternal(bool executeDispatchers) {
     pHead = m_pHead;
     m_pHead = nullptr;
     m_pTail = nullptr;
+    for (Lane& lane : m_lanes) {
+      lane = Lane{};
+      lane.cap = 0;
+    }
     delayedQueue = std::move(m_delayedQueue);
   }
 
@@ -48,6 +76,7 @@ void DispatchQueue::ClearQueueInternal(bool executeDispatchers) {
     while(pHead)
       try {
         auto next = pHead->m_pFlink;
+        RecordDispatch(*pHead);
         (*pHead)();
         delete pHead;
         pHead = next;
@@ -75,6 +104,9 @@ void DispatchQueue::ClearQueueInternal(bool executeDispatchers) {
   // be called from a lambda function, so assigning this value directly to zero would be an error.
   m_count -= nTraversed;
 
+  // Batched items whose dispatcher was discarded are discarded as well
+  DeleteBatchChain(m_pBatchInbox.exchange(nullptr, std::memory_order_acquire));
+
   // Wake up anyone who is still waiting:
   m_queueUpdated.notify_all();
 }
@@ -91,25 +123,93 @@ bool DispatchQueue::PromoteReadyDispatchersUnsafe(void) {
   ) {
     // Update tail if head is already set, otherwise update head:
     auto thunk = m_delayedQueue.top().GetThunk().release();
-    if (m_pHead)
-      m_pTail->m_pFlink = thunk;
-    else
-      m_pHead = thunk;
-    m_pTail = thunk;
+    InsertReadyUnsafe(thunk);
     m_count++;
+    RecordPendUnsafe(*thunk);
   }
 
   // Something was promoted if the dispatch queue size is different
   return nInitial != m_delayedQueue.size();
 }
 
+DispatchThunkBase* DispatchQueue::LanePredecessorUnsafe(size_t lane) const {
+  // Lanes are laid out in priority order, so this is the tail of the nearest nonempty higher lane
+  while (lane--)
+    if (m_lanes[lane].pLast)
+      return m_lanes[lane].pLast;
+  return nullptr;
+}
+
+void DispatchQueue::InsertReadyUnsafe(DispatchThunkBase* thunk) {
+  Lane& lane = m_lanes[(size_t)thunk->m_priority];
+  DispatchThunkBase* pPrev = lane.pLast ? lane.pLast : LanePredecessorUnsafe((size_t)thunk->m_priority);
+  DispatchThunkBase*& link = pPrev ? pPrev->m_pFlink : m_pHead;
+
+  thunk->m_pFlink = link;
+  link = thunk;
+  if (!lane.pFirst)
+    lane.pFirst = thunk;
+  lane.pLast = thunk;
+  if (!thunk->m_pFlink)
+    m_pTail = thunk;
+  lane.count++;
+}
+
+void DispatchQueue::InsertReadyFrontUnsafe(DispatchThunkBase* thunk) {
+  Lane& lane = m_lanes[(size_t)thunk->m_priority];
+  DispatchThunkBase* pPrev = LanePredecessorUnsafe((size_t)thunk->m_priority);
+  DispatchThunkBase*& link = pPrev ? pPrev->m_pFlink : m_pHead;
+
+  thunk->m_pFlink = link;
+  link = thunk;
+  lane.pFirst = thunk;
+  if (!lane.pLast)
+    lane.pLast = thunk;
+  if (!thunk->m_pFlink)
+    m_pTail = thunk;
+  lane.count++;
+}
+
+DispatchThunkBase* DispatchQueue::PopLaneUnsafe(size_t index) {
+  Lane& lane = m_lanes[index];
+  DispatchThunkBase* retVal = lane.pFirst;
+  DispatchThunkBase* pPrev = LanePredecessorUnsafe(index);
+  (pPrev ? pPrev->m_pFlink : m_pHead) = retVal->m_pFlink;
+
+  if (lane.pLast == retVal) {
+    lane.pFirst = nullptr;
+    lane.pLast = nullptr;
+    if (m_pTail == retVal)
+      m_pTail = pPrev;
+  }
+  else
+    lane.pFirst = retVal->m_pFlink;
+  lane.count--;
+  lane.nBypassed = 0;
+  return retVal;
+}
+
+DispatchThunkBase* DispatchQueue::PopReadyUnsafe(void) {
+  size_t index = 0;
+  while (!m_lanes[index].count)
+    index++;
+
+  // Every waiting lower lane is being passed over again, serve the first one that has waited too long
+  for (size_t i = index + 1; i < c_nLanes; i++)
+    if (m_lanes[i].count && ++m_lanes[i].nBypassed > c_maxBypass) {
+      index = i;
+      break;
+    }
+  return PopLaneUnsafe(index);
+}
+
 void DispatchQueue::DispatchEventUnsafe(std::unique_lock<std::mutex>& lk) {
   // Pull the ready thunk off of the front of the queue and pop it while we hold the lock.
   // Then, we will excecute the call while the lock has been released so we do not create
   // deadlocks.
-  std::unique_ptr<DispatchThunkBase> thunk(m_pHead);
-  m_pHead = thunk->m_pFlink;
+  std::unique_ptr<DispatchThunkBase> thunk(PopReadyUnsafe());
   lk.unlock();
+  RecordDispatch(*thunk);
 
   MakeAtExit([&] {
     if (!--m_count) {
@@ -125,16 +225,15 @@ void DispatchQueue::TryDispatchEventUnsafe(std::unique_lock<std::mutex>& lk) {
   // Pull the ready thunk off of the front of the queue and pop it while we hold the lock.
   // Then, we will excecute the call while the lock has been released so we do not create
   // deadlocks.
-  DispatchThunkBase* pThunk = m_pHead;
-  m_pHead = pThunk->m_pFlink;
+  DispatchThunkBase* pThunk = PopReadyUnsafe();
   lk.unlock();
+  RecordDispatch(*pThunk);
 
   try { (*pThunk)(); }
   catch (...) {
     // Failed to execute thunk, put it back
     lk.lock();
-    pThunk->m_pFlink = m_pHead;
-    m_pHead = pThunk;
+    InsertReadyFrontUnsafe(pThunk);
     throw;
   }
 
@@ -146,6 +245,37 @@ void DispatchQueue::TryDispatchEventUnsafe(std::unique_lock<std::mutex>& lk) {
   delete pThunk;
 }
 
+void DispatchQueue::RecordDispatch(const DispatchThunkBase& thunk) {
+  m_nDispatched.fetch_add(1, std::memory_order_relaxed);
+  if (thunk.m_pendTime == std::chrono::steady_clock::time_point{})
+    // Not a sample
+    return;
+
+  int64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - thunk.m_pendTime
+  ).count();
+  m_nLatencySamples.fetch_add(1, std::memory_order_relaxed);
+  m_totalLatencyNs.fetch_add(latency, std::memory_order_relaxed);
+
+  int64_t prior = m_maxLatencyNs.load(std::memory_order_relaxed);
+  while (prior < latency && !m_maxLatencyNs.compare_exchange_weak(prior, latency, std::memory_order_relaxed));
+}
+
+DispatchQueueStats DispatchQueue::GetDispatchQueueStats(void) const {
+  DispatchQueueStats retVal;
+  retVal.nPended = m_nPended.load(std::memory_order_relaxed);
+  retVal.nRejected = m_nRejected.load(std::memory_order_relaxed);
+  retVal.nDispatched = m_nDispatched.load(std::memory_order_relaxed);
+  retVal.nBudgetExhausted = m_nBudgetExhausted.load(std::memory_order_relaxed);
+  retVal.depth = m_count.load(std::memory_order_relaxed);
+  retVal.maxDepth = m_maxDepth.load(std::memory_order_relaxed);
+  retVal.dispatchCap = m_dispatchCap;
+  retVal.nLatencySamples = m_nLatencySamples.load(std::memory_order_relaxed);
+  retVal.totalLatency = std::chrono::nanoseconds(m_totalLatencyNs.load(std::memory_order_relaxed));
+  retVal.maxLatency = std::chrono::nanoseconds(m_maxLatencyNs.load(std::memory_order_relaxed));
+  return retVal;
+}
+
 void DispatchQueue::Abort(void) {
   ClearQueueInternal(false);
 }
@@ -161,8 +291,7 @@ bool DispatchQueue::Cancel(void) {
   std::lock_guard<std::mutex> lk(m_dispatchLock);
   if(m_pHead) {
     // Found a ready thunk, run from here:
-    thunk.reset(m_pHead);
-    m_pHead = thunk->m_pFlink;
+    thunk.reset(PopLaneUnsafe((size_t)m_pHead->m_priority));
   }
   else if (!m_delayedQueue.empty()) {
     auto& f = m_delayedQueue.top();
@@ -218,6 +347,22 @@ void DispatchQueue::WaitForEvent(void) {
     WaitForEventUnsafe(lk, m_delayedQueue.top().GetReadyTime());
 }
 
+bool DispatchQueue::SpinForEvent(std::chrono::nanoseconds interval) {
+  // Producers that observe our increment will not notify.  Any producer that misses our decrement
+  // below pended its event before we take the lock in WaitForEvent, so it cannot be missed there.
+  m_nSpinning++;
+  auto clear = MakeAtExit([this] { m_nSpinning--; });
+
+  const uint64_t version = m_version;
+  const auto deadline = std::chrono::steady_clock::now() + interval;
+  do {
+    if (m_count.load(std::memory_order_relaxed) || m_version.load(std::memory_order_relaxed) != version)
+      return true;
+    cpu_relax();
+  } while (std::chrono::steady_clock::now() < deadline);
+  return false;
+}
+
 bool DispatchQueue::WaitForEvent(std::chrono::milliseconds milliseconds) {
   return WaitForEvent(std::chrono::steady_clock::now() + milliseconds);
 }
@@ -289,23 +434,153 @@ int DispatchQueue::DispatchAllEvents(void) {
   return retVal;
 }
 
+int DispatchQueue::DispatchAllEvents(size_t maxEvents, std::chrono::nanoseconds budget) {
+  // Only consult the clock if there is a time limit
+  const bool timed = budget != std::chrono::nanoseconds::max();
+  const auto deadline = timed ? std::chrono::steady_clock::now() + budget : std::chrono::steady_clock::time_point{};
+
+  int retVal = 0;
+  for (;;) {
+    if ((size_t)retVal >= maxEvents || (timed && std::chrono::steady_clock::now() >= deadline)) {
+      // Out of budget, only worth noting if there was anything left to do
+      std::lock_guard<std::mutex> lk(m_dispatchLock);
+      if (m_pHead || PromoteReadyDispatchersUnsafe())
+        m_nBudgetExhausted.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+    if (!DispatchEvent())
+      break;
+    retVal++;
+  }
+  return retVal;
+}
+
 void DispatchQueue::PendExisting(std::unique_lock<std::mutex>&& lk, DispatchThunkBase* thunk) {
   // Count must be separately maintained:
   m_count++;
+  RecordPendUnsafe(*thunk);
 
   // Linked list setup:
-  if (m_pHead)
-    m_pTail->m_pFlink = thunk;
-  else {
-    m_pHead = thunk;
+  bool wasEmpty = !m_pHead;
+  InsertReadyUnsafe(thunk);
+  if (wasEmpty && !m_nSpinning)
     m_queueUpdated.notify_all();
-  }
-  m_pTail = thunk;
 
   // Notification as needed:
   OnPended(std::move(lk));
 }
 
+bool DispatchQueue::PendChecked(DispatchThunkBase* thunk) {
+  const Lane& lane = m_lanes[(size_t)thunk->m_priority];
+
+  m_dispatchLock.lock();
+  if (
+    thunk->m_priority == DispatchPriority::Normal ?
+    m_count >= m_dispatchCap :
+    lane.count >= lane.cap
+  ) {
+    m_nRejected.fetch_add(1, std::memory_order_relaxed);
+    m_dispatchLock.unlock();
+    delete thunk;
+    return false;
+  }
+
+  // Count must be separately maintained:
+  m_count++;
+  RecordPendUnsafe(*thunk);
+
+  // Linked list setup:
+  bool wasEmpty = !m_pHead;
+  InsertReadyUnsafe(thunk);
+  m_dispatchLock.unlock();
+  if (wasEmpty && !m_nSpinning)
+    m_queueUpdated.notify_all();
+
+  // Notification as needed:
+  OnPended(std::unique_lock<std::mutex>{});
+  return true;
+}
+
+void DispatchQueue::SetDispatcherCap(DispatchPriority priority, size_t dispatchCap) {
+  if (priority == DispatchPriority::Normal)
+    m_dispatchCap = dispatchCap;
+  else
+    m_lanes[(size_t)priority].cap = dispatchCap;
+}
+
+bool DispatchQueue::PendBatch(DispatchBatchItem* pItem) {
+  DispatchBatchItem* pHead = m_pBatchInbox.load(std::memory_order_relaxed);
+  do pItem->m_pFlink = pHead;
+  while (!m_pBatchInbox.compare_exchange_weak(pHead, pItem, std::memory_order_release, std::memory_order_relaxed));
+
+  if (pHead)
+    // A dispatcher is already pending, it will pick up this item
+    return true;
+
+  if (*this += [this] { DispatchBatchInbox(); })
+    return true;
+
+  // Could not pend a dispatcher.  If our item is still alone in the inbox it can simply be taken
+  // back out; if the inbox was emptied instead, the queue was aborted and our item went with it.
+  DispatchBatchItem* pExpected = pItem;
+  if (m_pBatchInbox.compare_exchange_strong(pExpected, nullptr, std::memory_order_acquire, std::memory_order_relaxed)) {
+    delete pItem;
+    return false;
+  }
+  if (!pExpected)
+    return false;
+
+  // Others have pended items on top of ours and were told that those items would be dispatched.
+  // They cannot be taken back, so the dispatcher is pended past the cap unless we were aborted.
+  std::unique_lock<std::mutex> lk(m_dispatchLock);
+  if (onAborted) {
+    lk.unlock();
+    DeleteBatchChain(m_pBatchInbox.exchange(nullptr, std::memory_order_acquire));
+    return false;
+  }
+  PendExisting(std::move(lk), MakeDispatchThunk([this] { DispatchBatchInbox(); }).release());
+  return true;
+}
+
+void DispatchQueue::DispatchBatchInbox(void) {
+  // Take the whole inbox, restoring the order in which items were pended
+  std::vector<std::unique_ptr<DispatchBatchItem>> items;
+  for (
+    DispatchBatchItem* pCur = m_pBatchInbox.exchange(nullptr, std::memory_order_acquire);
+    pCur;
+    pCur = pCur->m_pFlink
+  )
+    items.emplace_back(pCur);
+  std::reverse(items.begin(), items.end());
+
+  // Group items by key and routine, groups are processed in order of their first item
+  std::vector<std::vector<DispatchBatchItem*>> groups;
+  std::unordered_multimap<const void*, size_t> groupsByKey;
+  for (auto& item : items) {
+    auto range = groupsByKey.equal_range(item->m_key);
+    auto q = range.first;
+    while (q != range.second && groups[q->second][0]->m_fn != item->m_fn)
+      ++q;
+
+    if (q == range.second) {
+      groupsByKey.emplace(item->m_key, groups.size());
+      groups.emplace_back(1, item.get());
+    }
+    else
+      groups[q->second].push_back(item.get());
+  }
+
+  for (const auto& group : groups)
+    group[0]->m_fn(group[0]->m_key, group.data(), group.size());
+}
+
+void DispatchQueue::DeleteBatchChain(DispatchBatchItem* pHead) {
+  for (DispatchBatchItem* pNext; pHead; pHead = pNext) {
+    pNext = pHead->m_pFlink;
+    delete pHead;
+  }
+}
+
 bool DispatchQueue::Barrier(std::chrono::nanoseconds timeout) {
   // Do not block or lock in the event of a no-wait check
   if (timeout.count() == 0)
@@ -370,19 +645,21 @@ DispatchQueue::SuggestSoonestWakeupTimeUnsafe(std::chrono::steady_clock::time_po
 void DispatchQueue::operator+=(DispatchQueue&& rhs) {
   std::unique_lock<std::mutex> lk(m_dispatchLock);
 
-  // Append thunks to our queue
-  if (m_pHead)
-    m_pTail->m_pFlink = rhs.m_pHead;
-  else
-    m_pHead = rhs.m_pHead;
-
-  m_pTail = rhs.m_pTail;
+  // Append thunks to the ends of their lanes in our queue
+  for (DispatchThunkBase* pNext; rhs.m_pHead; rhs.m_pHead = pNext) {
+    pNext = rhs.m_pHead->m_pFlink;
+    InsertReadyUnsafe(rhs.m_pHead);
+  }
   m_count += rhs.m_count;
 
   // Clear queue from rhs
-  rhs.m_pHead = nullptr;
   rhs.m_pTail = nullptr;
   rhs.m_count = 0;
+  for (Lane& lane : rhs.m_lanes) {
+    size_t cap = lane.cap;
+    lane = Lane{};
+    lane.cap = cap;
+  }
 
   // Append delayed thunks
   while (!rhs.m_delayedQueue.empty()) {
@@ -11,6 +11,47 @@
 
 class DispatchQueue;
 
+namespace autowiring {
+  /// <summary>
+  /// Awaitable returned by DispatchQueue::schedule
+  /// </summary>
+  /// <remarks>
+  /// Include autowiring/coroutine.h in order to co_await this type
+  /// </remarks>
+  struct dispatch_schedule {
+    DispatchQueue& queue;
+  };
+}
+
+/// <summary>
+/// Counters describing the load on a DispatchQueue, see DispatchQueue::GetDispatchQueueStats
+/// </summary>
+struct DispatchQueueStats {
+  // Dispatchers accepted, refused because the queue was at its cap, and run
+  uint64_t nPended = 0;
+  uint64_t nRejected = 0;
+  uint64_t nDispatched = 0;
+
+  // Budgeted drains that stopped with dispatchers still ready
+  uint64_t nBudgetExhausted = 0;
+
+  // Current and greatest observed number of ready dispatchers, and the cap on that number
+  size_t depth = 0;
+  size_t maxDepth = 0;
+  size_t dispatchCap = 0;
+
+  // Time from pend to the start of execution, measured for one in every
+  // DispatchQueue::c_latencySampleInterval dispatchers
+  uint64_t nLatencySamples = 0;
+  std::chrono::nanoseconds totalLatency{0};
+  std::chrono::nanoseconds maxLatency{0};
+
+  /// <returns>The mean sampled pend-to-run latency</returns>
+  std::chrono::nanoseconds MeanLatency(void) const {
+    return nLatencySamples ? totalLatency / (int64_t) nLatencySamples : std::chrono::nanoseconds{0};
+  }
+};
+
 /// <summary>
 /// This is an asynchronous queue of zero-argument functions
 /// </summary>
@@ -37,6 +78,12 @@ public:
   // to be dumped and prevent the introduction of new entries to the queue.
   autowiring::once_signal<DispatchQueue> onAborted;
 
+  // The number of priority lanes, one for each value of DispatchPriority
+  static const size_t c_nLanes = 3;
+
+  // A nonempty lane is served after it has been passed over this many times in a row
+  static const size_t c_maxBypass = 16;
+
 protected:
   // The maximum allowed number of pended dispatches before pended calls start getting dropped
   size_t m_dispatchCap = 1024;
@@ -51,21 +98,112 @@ protected:
   autowiring::DispatchThunkBase* m_pHead = nullptr;
   autowiring::DispatchThunkBase* m_pTail = nullptr;
 
+  struct Lane {
+    // First and last ready thunks in this lane.  Each lane is a contiguous run of the list above,
+    // and runs appear in priority order.
+    autowiring::DispatchThunkBase* pFirst = nullptr;
+    autowiring::DispatchThunkBase* pLast = nullptr;
+    size_t count = 0;
+
+    // The maximum number of ready thunks in this lane.  Not used by the normal lane, which is bounded
+    // by m_dispatchCap instead.
+    size_t cap = 1024;
+
+    // Number of consecutive dispatches taken from a higher lane while this lane was nonempty
+    size_t nBypassed = 0;
+  };
+  Lane m_lanes[c_nLanes];
+
   // Priority queue of non-ready events:
   std::priority_queue<autowiring::DispatchThunkDelayed> m_delayedQueue;
 
+  // Lock-free inbox of batched items, most recently pended first
+  std::atomic<autowiring::DispatchBatchItem*> m_pBatchInbox{nullptr};
+
   // A lock held when the dispatch queue must be updated:
   std::mutex m_dispatchLock;
 
   // Notice when the dispatch queue has been updated:
   std::condition_variable m_queueUpdated;
 
+  // Telemetry.  All are updated with relaxed ordering; the pend-side counters are only written
+  // under m_dispatchLock, but may be read without it.
+  std::atomic<uint64_t> m_nPended{0};
+  std::atomic<uint64_t> m_nRejected{0};
+  std::atomic<uint64_t> m_nDispatched{0};
+  std::atomic<uint64_t> m_nBudgetExhausted{0};
+  std::atomic<size_t> m_maxDepth{0};
+  std::atomic<uint64_t> m_nLatencySamples{0};
+  std::atomic<int64_t> m_totalLatencyNs{0};
+  std::atomic<int64_t> m_maxLatencyNs{0};
+
+  // Number of consumers presently in SpinForEvent.  Producers do not notify m_queueUpdated of a new
+  // event while this is nonzero, spinning consumers will observe the event without being woken.
+  std::atomic<int> m_nSpinning{0};
+
   /// <summary>
   /// Moves all ready events from the delayed queue into the dispatch queue
   /// </summary>
   /// <returns>True if at least one dispatcher was promoted</returns>
   bool PromoteReadyDispatchersUnsafe(void);
 
+  /// <summary>
+  /// Updates telemetry for a thunk that has just been added to the ready list
+  /// </summary>
+  /// <remarks>
+  /// The dispatch lock must be held, and m_count must already include the passed thunk
+  /// </remarks>
+  void RecordPendUnsafe(autowiring::DispatchThunkBase& thunk) {
+    uint64_t n = m_nPended.load(std::memory_order_relaxed);
+    m_nPended.store(n + 1, std::memory_order_relaxed);
+    if (!(n % c_latencySampleInterval))
+      thunk.m_pendTime = std::chrono::steady_clock::now();
+
+    size_t depth = m_count.load(std::memory_order_relaxed);
+    if (m_maxDepth.load(std::memory_order_relaxed) < depth)
+      m_maxDepth.store(depth, std::memory_order_relaxed);
+  }
+
+  /// <summary>
+  /// Updates telemetry for a thunk that is about to be run
+  /// </summary>
+  void RecordDispatch(const autowiring::DispatchThunkBase& thunk);
+
+  /// <returns>
+  /// The last thunk ahead of the specified lane in the ready list, or nullptr if there is none
+  /// </returns>
+  autowiring::DispatchThunkBase* LanePredecessorUnsafe(size_t lane) const;
+
+  /// <summary>
+  /// Attaches a thunk to the end of the lane given by its priority
+  /// </summary>
+  void InsertReadyUnsafe(autowiring::DispatchThunkBase* thunk);
+
+  /// <summary>
+  /// Attaches a thunk to the front of the lane given by its priority
+  /// </summary>
+  void InsertReadyFrontUnsafe(autowiring::DispatchThunkBase* thunk);
+
+  /// <summary>
+  /// Detaches the first thunk of the specified lane, which must be nonempty
+  /// </summary>
+  autowiring::DispatchThunkBase* PopLaneUnsafe(size_t lane);
+
+  /// <summary>
+  /// Detaches the next thunk to be run, the ready list must be nonempty
+  /// </summary>
+  /// <remarks>
+  /// Thunks are taken from the highest-priority nonempty lane, except that a lane which has been
+  /// passed over c_maxBypass times in a row is served next.
+  /// </remarks>
+  autowiring::DispatchThunkBase* PopReadyUnsafe(void);
+
+  /// <summary>
+  /// Attaches a thunk to its lane if that lane is below its cap, deleting the thunk otherwise
+  /// </summary>
+  /// <returns>True if the thunk was pended</returns>
+  bool PendChecked(autowiring::DispatchThunkBase* thunk);
+
   /// <summary>
   /// Similar to DispatchEvent, except assumes that the dispatch lock is currently held
   /// </summary>
@@ -114,15 +252,51 @@ protected:
   /// </summary>
   void SetDispatcherCap(size_t dispatchCap) { m_dispatchCap = dispatchCap; }
 
+  /// <summary>
+  /// Updates the upper bound on the number of ready dispatchers in the specified lane
+  /// </summary>
+  /// <remarks>
+  /// The normal lane is bounded by the overall dispatch cap, as set by the single-argument overload.
+  /// The high and low lanes each count only their own ready dispatchers against their cap, so a queue
+  /// that is full of normal work still accepts high-priority work.
+  /// </remarks>
+  void SetDispatcherCap(autowiring::DispatchPriority priority, size_t dispatchCap);
+
   // Internal implementation for abort/rundown
   void ClearQueueInternal(bool executeDispatchers);
 
+  /// <summary>
+  /// Processes every item currently in the batch inbox
+  /// </summary>
+  /// <remarks>
+  /// If a batch routine throws, the remaining items taken from the inbox are discarded and the
+  /// exception is propagated to the caller.
+  /// </remarks>
+  void DispatchBatchInbox(void);
+
+  /// <summary>
+  /// Deletes every item currently in the specified inbox chain
+  /// </summary>
+  static void DeleteBatchChain(autowiring::DispatchBatchItem* pHead);
+
 public:
   /// <returns>
   /// True if there are curerntly any dispatchers ready for execution--IE, DispatchEvent would return true
   /// </returns>
   bool AreAnyDispatchersReady(void) const { return !!m_pHead; }
 
+  // One in this many pended dispatchers has its pend-to-run latency measured
+  static const uint64_t c_latencySampleInterval = 64;
+
+  /// <returns>
+  /// A snapshot of this queue's telemetry counters
+  /// </returns>
+  /// <remarks>
+  /// Counters are read individually without synchronization, so the snapshot is only approximately
+  /// consistent while the queue is in use.
+  /// </remarks>
+  DispatchQueueStats GetDispatchQueueStats(void) const;
+
   /// <returns>
   /// The total number of all ready and delayed events
   /// </returns>
@@ -224,6 +398,20 @@ public:
   /// <returns>The total number of events dispatched</returns>
   int DispatchAllEvents(void);
 
+  /// <summary>
+  /// Similar to DispatchAllEvents, but stops early once a budget is exhausted
+  /// </summary>
+  /// <param name="maxEvents">The maximum number of events to dispatch</param>
+  /// <param name="budget">The time after which no further event will be started</param>
+  /// <returns>The total number of events dispatched</returns>
+  /// <remarks>
+  /// The time budget is checked between events, so a single long-running event may overrun it.  A budget of
+  /// std::chrono::nanoseconds::max() does not limit the time taken.  If the drain stops with events still
+  /// ready, DispatchQueueStats::nBudgetExhausted is incremented; callers sharing a thread between several
+  /// queues should then move on to another queue and return to this one later.
+  /// </remarks>
+  int DispatchAllEvents(size_t maxEvents, std::chrono::nanoseconds budget);
+
   /// <summary>
   /// Waits until a lambda function is ready to run in this thread's dispatch queue,
   /// dispatches the function, and then returns.
@@ -233,6 +421,20 @@ public:
   /// </remarks>
   void WaitForEvent(void);
 
+  /// <summary>
+  /// Busy-waits until an event may be ready or the specified interval elapses, without blocking
+  /// </summary>
+  /// <returns>True if an event may be ready, false if the interval elapsed</returns>
+  /// <remarks>
+  /// This method does not dispatch anything.  It is intended to be called ahead of DispatchEvent or
+  /// WaitForEvent by latency-sensitive consumers, who trade CPU time for avoiding a context switch when
+  /// an event arrives shortly after the queue is emptied.  While a consumer spins, producers do not
+  /// signal the queue's condition variable.
+  ///
+  /// Delayed events are not observed while spinning; the interval should be kept short.
+  /// </remarks>
+  bool SpinForEvent(std::chrono::nanoseconds interval);
+
   /// <summary>
   /// Waits until a lambda function in the dispatch queue is ready to run or the specified
   /// time period elapses, whichever comes first.
@@ -260,12 +462,27 @@ public:
   /// <summary>
   /// Explicit overload for already-constructed dispatch thunk types
   /// </summary>
-  void AddExisting(std::unique_ptr<autowiring::DispatchThunkBase>&& pBase) {
-    std::unique_lock<std::mutex> lk(m_dispatchLock);
-    if (m_count < m_dispatchCap)
-      PendExisting(std::move(lk), pBase.release());
+  /// <returns>False if the thunk was discarded because the queue is full</returns>
+  bool AddExisting(std::unique_ptr<autowiring::DispatchThunkBase>&& pBase) {
+    return PendChecked(pBase.release());
   }
 
+  /// <summary>
+  /// Adds an item to this queue's batch inbox
+  /// </summary>
+  /// <returns>
+  /// True if the item will be dispatched, false if it was discarded because the queue is full or has
+  /// been aborted.  Aborting the queue discards items that have not been dispatched yet.
+  /// </returns>
+  /// <remarks>
+  /// Items are accumulated in a lock-free inbox without taking the dispatch lock.  A single
+  /// dispatcher is pended when the inbox goes from empty to nonempty; that dispatcher processes every
+  /// item accumulated by the time it runs, so a queue under load processes many items per dispatch.
+  ///
+  /// The queue takes ownership of the item in all cases.
+  /// </remarks>
+  bool PendBatch(autowiring::DispatchBatchItem* pItem);
+
   /// <summary>
   /// Blocks until all dispatchers on the DispatchQueue at the time of the call have been dispatched
   /// </summary>
@@ -358,6 +575,26 @@ public:
     }
   };
 
+  class DispatchThunkPriorityExpression {
+  public:
+    DispatchThunkPriorityExpression(DispatchQueue* pParent, autowiring::DispatchPriority priority) :
+      m_pParent(pParent),
+      m_priority(priority)
+    {}
+
+  private:
+    DispatchQueue* const m_pParent;
+    const autowiring::DispatchPriority m_priority;
+
+  public:
+    template<class _Fx>
+    bool operator,(_Fx&& fx) {
+      auto thunk = new autowiring::DispatchThunk<_Fx>(std::forward<_Fx>(fx));
+      thunk->m_priority = m_priority;
+      return m_pParent->PendChecked(thunk);
+    }
+  };
+
   /// <summary>
   /// Extracts the contents of the dispatch queue on the right-hand side for handling by this queue
   /// </summary>
@@ -387,6 +624,16 @@ public:
   /// </summary>
   DispatchThunkDelayedExpressionAbs operator+=(std::chrono::steady_clock::time_point rhs);
 
+  /// <summary>
+  /// Overload for pending a lambda to a specific priority lane
+  /// </summary>
+  /// <remarks>
+  /// Usage is "queue += DispatchPriority::High, [] {...}".  The expression evaluates to false if the
+  /// lane was at its cap and the lambda was discarded.  Ready lambdas are run in priority order, and in
+  /// the order they were pended within a lane.
+  /// </remarks>
+  DispatchThunkPriorityExpression operator+=(autowiring::DispatchPriority rhs) { return{this, rhs}; }
+
   /// <summary>
   /// Directly pends a delayed dispatch thunk
   /// </summary>
@@ -395,6 +642,16 @@ public:
   /// </remarks>
   void operator+=(autowiring::DispatchThunkDelayed&& rhs);
 
+  /// <summary>
+  /// Produces an awaitable which resumes the awaiting coroutine on this dispatch queue
+  /// </summary>
+  /// <remarks>
+  /// "co_await queue.schedule()" pends the remainder of the coroutine as a single lambda.  If the
+  /// queue refuses that lambda, or is aborted before the lambda is run, the coroutine is destroyed
+  /// without being resumed.  See autowiring/coroutine.h.
+  /// </remarks>
+  autowiring::dispatch_schedule schedule(void) { return{ *this }; }
+
   /// <summary>
   /// Generic overload which will pend an arbitrary dispatch type
   /// </summary>
@@ -404,32 +661,6 @@ public:
     static_assert(!std::is_pointer<_Fx>::value, "Cannot pend a pointer to a function, we must have direct ownership");
 
     // Create the thunk first to reduce the amount of time we spend in lock:
-    auto thunk = new autowiring::DispatchThunk<_Fx>(std::forward<_Fx>(fx));
-
-    m_dispatchLock.lock();
-    if (m_count >= m_dispatchCap) {
-      m_dispatchLock.unlock();
-      delete thunk;
-      return false;
-    }
-
-    // Count must be separately maintained:
-    m_count++;
-
-    // Linked list setup:
-    if (m_pHead) {
-      m_pTail->m_pFlink = thunk;
-      m_pTail = thunk;
-      m_dispatchLock.unlock();
-    }
-    else {
-      m_pHead = m_pTail = thunk;
-      m_dispatchLock.unlock();
-      m_queueUpdated.notify_all();
-    }
-
-    // Notification as needed:
-    OnPended(std::unique_lock<std::mutex>{});
-    return true;
+    return PendChecked(new autowiring::DispatchThunk<_Fx>(std::forward<_Fx>(fx)));
   }
 };
@@ -5,6 +5,20 @@
 
 namespace autowiring {
 
+/// <summary>
+/// Selects the lane of a DispatchQueue in which a dispatcher waits to be run
+/// </summary>
+enum class DispatchPriority : unsigned char {
+  // Control traffic, such as shutdown requests, configuration updates, and heartbeats
+  High,
+
+  // The lane used by operator+= when no priority is given
+  Normal,
+
+  // Bulk work that may wait behind everything else
+  Low
+};
+
 /// <summary>
 /// A simple virtual class used to hold a trivial thunk
 /// </summary>
@@ -14,6 +28,12 @@ public:
   virtual void operator()() = 0;
 
   DispatchThunkBase* m_pFlink = nullptr;
+
+  // Lane in which this thunk waits when it is ready
+  DispatchPriority m_priority = DispatchPriority::Normal;
+
+  // Time at which this thunk was pended, if it was chosen as a latency sample
+  std::chrono::steady_clock::time_point m_pendTime;
 };
 
 template<class _Fx>
@@ -32,6 +52,31 @@ public:
   }
 };
 
+/// <summary>
+/// An item that may be pended to the batch inbox of a dispatch queue
+/// </summary>
+/// <remarks>
+/// When the inbox is drained, all items that share the same key and batch routine are passed to
+/// that routine in a single call, in the order they were pended.
+/// </remarks>
+class DispatchBatchItem {
+public:
+  typedef void(*t_batchFn)(const void* key, DispatchBatchItem* const* ppItems, size_t nItems);
+
+  DispatchBatchItem(const void* key, t_batchFn fn) :
+    m_key(key),
+    m_fn(fn)
+  {}
+  virtual ~DispatchBatchItem(void) {}
+
+  // Forward link, used while this item is in the inbox
+  DispatchBatchItem* m_pFlink = nullptr;
+
+  // The grouping key and the routine that processes groups of items
+  const void* const m_key;
+  const t_batchFn m_fn;
+};
+
 template<typename Fx>
 std::unique_ptr<DispatchThunkBase> MakeDispatchThunk(Fx&& fx) {
   return std::unique_ptr<DispatchThunkBase>(new DispatchThunk<Fx>(std::forward<Fx&&>(fx)));
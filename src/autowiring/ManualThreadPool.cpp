@@ -47,6 +47,5 @@ void ManualThreadPool::Join(std::shared_ptr<ThreadPoolToken> token) {
 
 bool ManualThreadPool::Submit(std::unique_ptr<DispatchThunkBase>&& thunk) {
   // Add some more work
-  AddExisting(std::move(thunk));
-  return true;
+  return AddExisting(std::move(thunk));
 }
@@ -2,6 +2,7 @@
 #include "stdafx.h"
 #include "Parallel.h"
 #include "autowiring.h"
+#include <limits>
 #include <thread>
 
 using namespace autowiring;
@@ -25,6 +26,7 @@ parallel::parallel(CoreContext& ctxt, size_t concurrency):
     concurrency = std::thread::hardware_concurrency();
 
   auto block = m_block;
+  block->m_nThreads = concurrency;
 
   // Fire off a bunch of threads to do work:
   while (concurrency--)
@@ -70,3 +72,26 @@ void parallel::stop_unsafe(void) {
   m_ctxt.reset();
   m_block.reset();
 }
+
+bool parallel::prepare_chunks(size_t first, size_t last, size_t& grain, size_t& nChunks) {
+  if (last <= first)
+    return false;
+
+  size_t n = last - first;
+  if (!grain)
+    grain = 1;
+
+  // Chunk indices must fit in 32 bits, coarsen the grain for enormous ranges
+  const size_t maxChunks = std::numeric_limits<uint32_t>::max();
+  if (n / grain >= maxChunks)
+    grain = n / maxChunks + 1;
+
+  nChunks = (n + grain - 1) / grain;
+  return true;
+}
+
+size_t parallel::job_size(size_t nChunks) const {
+  auto block = m_block;
+  size_t nThreads = block ? block->m_nThreads : 0;
+  return std::min(nThreads + 1, nChunks);
+}
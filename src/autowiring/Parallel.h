@@ -3,6 +3,9 @@
 #include "AnySharedPointer.h"
 #include "auto_id.h"
 #include "DispatchQueue.h"
+#include "result_ring.h"
+#include "work_stealing.h"
+#include <algorithm>
 #include <iterator>
 #include <unordered_map>
 #include <deque>
@@ -103,6 +106,116 @@ public:
   unused operator*(void) const { return{}; };
 };
 
+/// <summary>
+/// Common base for streams of jobs whose results are held by value in a bounded ring
+/// </summary>
+/// <remarks>
+/// At most capacity jobs may be in flight or awaiting consumption at once; submitting another job
+/// blocks until the consumer pops a result.  Results are stored by value in a preallocated ring,
+/// so there is no per-job result allocation and memory use stays bounded no matter how far
+/// producers run ahead.
+///
+/// Any number of threads may submit jobs, but only one thread may consume results.  Because
+/// submission blocks when the stream is full, a single thread that both submits and consumes must
+/// not submit more than capacity jobs between calls to pop.
+/// </remarks>
+template<typename T>
+class parallel_stream {
+protected:
+  parallel_stream(parallel& parent, size_t capacity) :
+    m_parent(parent),
+    m_ring(std::make_shared<result_ring<T>>(capacity))
+  {}
+
+  parallel_stream(parallel_stream&&) = default;
+  parallel_stream(const parallel_stream&) = delete;
+
+  parallel& m_parent;
+
+  // In-flight jobs hold their own reference to the ring, and may complete after we're gone
+  std::shared_ptr<result_ring<T>> m_ring;
+
+public:
+  /// <returns>The maximum number of jobs that may be outstanding at once</returns>
+  size_t capacity(void) const { return m_ring->capacity(); }
+
+  /// <returns>The number of jobs submitted whose results have not yet been popped</returns>
+  size_t size(void) const { return m_ring->size(); }
+
+  /// <returns>True if there are no outstanding jobs</returns>
+  bool empty(void) const { return m_ring->empty(); }
+
+  /// <summary>
+  /// Removes the next result, blocking until it is available
+  /// </summary>
+  /// <remarks>
+  /// If the job threw an exception, the exception is rethrown here.  Throws std::out_of_range
+  /// if there are no outstanding jobs.
+  /// </remarks>
+  T pop(void) { return m_ring->pop(); }
+
+  /// <summary>
+  /// Removes the next result if it is available
+  /// </summary>
+  /// <returns>False if there is no outstanding job or if the next result is not yet ready</returns>
+  bool try_pop(T& value) { return m_ring->try_pop(value); }
+};
+
+/// <summary>
+/// A stream of jobs whose results are delivered in submission order
+/// </summary>
+/// <remarks>
+/// Obtained from parallel::ordered.  Jobs run concurrently in the parent's pool, but their results
+/// are handed to the consumer in the order the jobs were submitted, which makes the stream suitable
+/// for feeding a sequential stage from a parallel one without a reordering buffer.
+/// </remarks>
+template<typename T>
+class ordered_stream:
+  public parallel_stream<T>
+{
+public:
+  ordered_stream(parallel& parent, size_t depth) :
+    parallel_stream<T>(parent, depth)
+  {}
+
+  ordered_stream(ordered_stream&&) = default;
+
+  /// <returns>The maximum number of jobs that may be in flight at once</returns>
+  size_t depth(void) const { return this->capacity(); }
+
+  /// <summary>
+  /// Submits a job, blocking if depth jobs are already outstanding
+  /// </summary>
+  template<typename Fx>
+  void operator+=(Fx&& fx);
+};
+
+/// <summary>
+/// A statically typed stream of jobs whose results are delivered in completion order
+/// </summary>
+/// <remarks>
+/// Obtained from parallel::channel.  This is the typed counterpart of parallel::operator+=.  Each
+/// result is written into the next free slot of the ring as soon as its job completes, so there is
+/// no per-job shared_ptr and no type lookup when results are consumed.
+/// </remarks>
+template<typename T>
+class result_channel:
+  public parallel_stream<T>
+{
+public:
+  result_channel(parallel& parent, size_t capacity) :
+    parallel_stream<T>(parent, capacity)
+  {}
+
+  result_channel(result_channel&&) = default;
+
+  /// <summary>
+  /// Submits a job, blocking if capacity jobs are already outstanding
+  /// </summary>
+  template<typename Fx>
+  void operator+=(Fx&& fx);
+};
+
 // Provides fan-out and gather functionality. Lambda "jobs" can be started using operator+=
 // and gathered using the standard container iteration interface using begin and end. Jobs
 // are run in the thread pool of the current context
@@ -205,11 +318,10 @@ public:
   T Top(void) {
     std::unique_lock<std::mutex> lk(m_block->m_lock);
 
-    if (m_block->m_queue[auto_id_t<T>{}].empty())
-      m_block->m_queueUpdated.wait(lk, [this]{
-        return !m_block->m_queue[auto_id_t<T>{}].empty();
-      });
-    return *static_cast<T*>(m_block->m_queue[auto_id_t<T>{}].front().ptr());
+    // References into the map remain valid across rehashing, so one lookup is sufficient
+    auto& qu = m_block->m_queue[auto_id_t<T>{}];
+    m_block->m_queueUpdated.wait(lk, [&qu] { return !qu.empty(); });
+    return *static_cast<T*>(qu.front().ptr());
   }
 
   // Get a collection containing all entries of the specified type
@@ -218,6 +330,102 @@ public:
     return parallel_collection<T> { begin<T>(), end<T>() };
   }
 
+  /// <summary>
+  /// Creates a stream whose results are delivered in submission order
+  /// </summary>
+  /// <param name="depth">The maximum number of jobs that may be outstanding on the stream</param>
+  /// <remarks>
+  /// The returned stream refers to this pool and must not outlive it
+  /// </remarks>
+  template<typename T>
+  ordered_stream<T> ordered(size_t depth) {
+    return ordered_stream<T>{ *this, depth };
+  }
+
+  /// <summary>
+  /// Creates a typed stream whose results are delivered in completion order
+  /// </summary>
+  /// <param name="capacity">The maximum number of jobs that may be outstanding on the channel</param>
+  /// <remarks>
+  /// Prefer this to operator+= for large numbers of small jobs that produce a single type.  The
+  /// returned channel refers to this pool and must not outlive it.
+  /// </remarks>
+  template<typename T>
+  result_channel<T> channel(size_t capacity) {
+    return result_channel<T>{ *this, capacity };
+  }
+
+  /// <summary>
+  /// Invokes fn(i) for every i in [first, last), distributing the work across the pool
+  /// </summary>
+  /// <param name="grain">The number of consecutive indices handled by a single unit of work</param>
+  /// <remarks>
+  /// The range is divided into chunks of grain indices, and the chunks are split evenly between
+  /// the threads of this pool and the caller.  Threads that run out of chunks steal from the back
+  /// of the ranges of other threads.  No allocation or locking takes place on a per-index or
+  /// per-chunk basis.
+  ///
+  /// This method blocks until every index has been visited.  The calling thread participates in
+  /// the work, so this method will complete even if the pool is stopped or saturated.  If fn
+  /// throws, the remaining chunks are skipped and the first exception is rethrown here.
+  /// </remarks>
+  template<typename Fn>
+  void parallel_for(size_t first, size_t last, size_t grain, Fn&& fn) {
+    size_t nChunks;
+    if (!prepare_chunks(first, last, grain, nChunks))
+      return;
+
+    auto body = [&] (size_t, uint32_t chunk) {
+      size_t begin = first + chunk * grain;
+      size_t end = std::min(last, begin + grain);
+      for (size_t i = begin; i < end; i++)
+        fn(i);
+    };
+    run_chunks(job_size(nChunks), nChunks, body);
+  }
+
+  /// <summary>
+  /// Reduces the range [first, last) in parallel
+  /// </summary>
+  /// <param name="identity">The identity value of the reduction, used to seed each partial result</param>
+  /// <param name="fn">Accumulator, invoked as fn(T& partial, size_t i) for each index</param>
+  /// <param name="combine">Invoked as combine(const T&, const T&) to merge two partial results</param>
+  /// <remarks>
+  /// Each thread accumulates into its own partial result, so no synchronization takes place while
+  /// the range is being visited.  Because chunks may be stolen, a partial result may incorporate
+  /// indices from anywhere in the range; combine must therefore be associative and commutative.
+  /// The partial results are merged on the calling thread after every index has been visited.
+  /// </remarks>
+  template<typename T, typename Fn, typename Combine>
+  T parallel_reduce(size_t first, size_t last, size_t grain, T identity, Fn&& fn, Combine&& combine) {
+    size_t nChunks;
+    if (!prepare_chunks(first, last, grain, nChunks))
+      return identity;
+
+    // One partial per worker, padded so that adjacent partials do not share a cache line
+    struct partial {
+      partial(const T& value) : value(value) {}
+      T value;
+      char pad[64 - sizeof(T) % 64];
+    };
+    size_t nWorkers = job_size(nChunks);
+    std::vector<partial> partials(nWorkers, partial{ identity });
+
+    auto body = [&] (size_t worker, uint32_t chunk) {
+      T& acc = partials[worker].value;
+      size_t begin = first + chunk * grain;
+      size_t end = std::min(last, begin + grain);
+      for (size_t i = begin; i < end; i++)
+        fn(acc, i);
+    };
+    run_chunks(nWorkers, nChunks, body);
+
+    T retVal = std::move(identity);
+    for (auto& cur : partials)
+      retVal = combine(retVal, cur.value);
+    return retVal;
+  }
+
   /// <summary>
   /// Blocks until all outstanding work is done
   /// </summary>
@@ -273,6 +481,9 @@ protected:
 
     // Total number of entries currently outstanding:
     size_t m_outstandingCount = 0;
+
+    // Number of threads servicing the dispatch queue:
+    size_t m_nThreads = 0;
   };
 
   // Status block is held outside in order to avoid race conditions
@@ -286,6 +497,53 @@ protected:
 
   // Unsynchronized version of stop
   void stop_unsafe(void);
+
+  template<typename T>
+  friend class ordered_stream;
+
+  template<typename T>
+  friend class result_channel;
+
+  /// <summary>
+  /// Pends fx to the pool without registering it as an outstanding job
+  /// </summary>
+  /// <returns>False if the pool has been stopped or is saturated</returns>
+  template<typename Fx>
+  bool pend(Fx&& fx) {
+    auto block = m_block;
+    return block && (block->dq += std::forward<Fx>(fx));
+  }
+
+  /// <summary>
+  /// Computes the number of chunks needed to cover [first, last), adjusting grain if needed
+  /// </summary>
+  /// <returns>False if the range is empty</returns>
+  static bool prepare_chunks(size_t first, size_t last, size_t& grain, size_t& nChunks);
+
+  /// <returns>The number of workers, including the caller, that will be assigned to a chunked job</returns>
+  size_t job_size(size_t nChunks) const;
+
+  /// <summary>
+  /// Distributes nChunks chunks between nWorkers workers, blocks until all are complete
+  /// </summary>
+  /// <remarks>
+  /// The caller is always worker zero.  The remaining workers are pended to the pool.
+  /// </remarks>
+  template<typename Body>
+  void run_chunks(size_t nWorkers, size_t nChunks, Body& body) {
+    auto job = std::make_shared<work_stealing_job>(nWorkers, (uint32_t)nChunks);
+
+    // Helpers only dereference the body once they have claimed a chunk, and we cannot return
+    // until every claimed chunk has completed, so a pointer to our stack is safe here.
+    Body* pBody = &body;
+    auto block = m_block;
+    if (block)
+      for (size_t i = 1; i < job->size(); i++)
+        block->dq += [job, i, pBody] { job->run(i, pBody); };
+
+    job->run(0, pBody);
+    job->wait();
+  }
 };
 
 template<typename T>
@@ -306,4 +564,27 @@ T parallel_iterator<T>::operator*(void) {
   return m_parent.Top<T>();
 }
 
+template<typename T>
+template<typename Fx>
+void ordered_stream<T>::operator+=(Fx&& fx) {
+  // Reserve our slot first, this is where backpressure is applied
+  uint64_t ticket = this->m_ring->reserve();
+
+  auto ring = this->m_ring;
+  if (!this->m_parent.pend([ring, ticket, fx] { ring->fulfill(ticket, fx); }))
+    // Pool is unavailable, run the job here so the slot is still filled
+    ring->fulfill(ticket, fx);
+}
+
+template<typename T>
+template<typename Fx>
+void result_channel<T>::operator+=(Fx&& fx) {
+  // Reservation bounds the number of outstanding jobs, the slot itself is claimed on completion
+  this->m_ring->reserve();
+
+  auto ring = this->m_ring;
+  if (!this->m_parent.pend([ring, fx] { ring->fulfill_any(fx); }))
+    ring->fulfill_any(fx);
+}
+
 }//namespace autowiring
@@ -1,6 +1,8 @@
 // Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
 #pragma once
 #include "AutoFilterDescriptor.h"
+#include <atomic>
+#include MEMORY_HEADER
 
 namespace autowiring {
 
@@ -29,6 +31,50 @@ struct SatCounter:
   // The number of inputs remaining to this counter:
   size_t remaining = 0;
 
+  /// <summary>
+  /// Invokes the AutoFilter on the specified packet
+  /// </summary>
+  /// <remarks>
+  /// While the filter runs, its instruments are current on the calling thread so that the packet can
+  /// count the outputs it produces.  If latency histograms are enabled, the wall time of every call
+  /// that returns normally is recorded.  Deferred filters time themselves when the deferred call is
+  /// made.  Nothing is invoked if the packet has been abandoned.
+  /// </remarks>
+  void Call(AutoPacket& packet) {
+    if (packet.IsAbandoned())
+      return;
+
+    if (!m_pInstruments || !m_pInstruments->is_active()) {
+      if (!filter_instruments::current()) {
+        GetCall()(GetAutoFilter().ptr(), packet);
+        return;
+      }
+
+      // Called from inside an instrumented filter, which must not be credited with our outputs
+      filter_instruments::scope uninstrumented(nullptr);
+      GetCall()(GetAutoFilter().ptr(), packet);
+      return;
+    }
+
+    filter_instruments::scope instrumented(m_pInstruments);
+    if (IsDeferred()) {
+      GetCall()(GetAutoFilter().ptr(), packet);
+      return;
+    }
+
+    filter_instruments::invocation invocation(m_pInstruments);
+    GetCall()(GetAutoFilter().ptr(), packet);
+    invocation.complete();
+  }
+
+  /// <summary>
+  /// Counts a delivery of a decoration to the specified input argument, if deliveries are being counted
+  /// </summary>
+  void RecordDelivery(size_t argIndex) const {
+    if (m_pInstruments && m_pInstruments->is_counting())
+      m_pInstruments->record(argIndex);
+  }
+
   /// <summary>
   /// Conditionally decrements AutoFilter argument satisfaction.
   /// </summary>
@@ -0,0 +1,210 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "StealingThreadPool.h"
+#include "at_exit.h"
+
+using namespace autowiring;
+
+void StealingThreadPoolToken::Leave(void) {
+  cancelled = true;
+  pool->WakeAllWaitingThreads();
+}
+
+StealingThreadPool::StealingThreadPool(size_t maxWorkers, size_t ringCapacity) :
+  m_nWorkers(maxWorkers ? maxWorkers : 1),
+  m_workers(new Worker[m_nWorkers])
+{
+  for (size_t i = 0; i < m_nWorkers; i++)
+    m_workers[i].ring.resize(ringCapacity ? ringCapacity : 1);
+}
+
+StealingThreadPool::~StealingThreadPool(void)
+{
+  // Nothing can be running at this point, delete whatever was never run
+  for (size_t i = 0; i < m_nWorkers; i++)
+    while (m_workers[i].count)
+      delete PopRing(m_workers[i]);
+  for (auto thunk : m_overflow)
+    delete thunk;
+}
+
+void StealingThreadPool::Push(size_t hint, DispatchThunkBase* thunk) {
+  // Count first, so that a participant that pops this thunk never observes a count of zero
+  m_pending++;
+
+  bool placed = false;
+  for (size_t i = 0; i < m_nWorkers && !placed; i++) {
+    Worker& worker = m_workers[(hint + i) % m_nWorkers];
+
+    std::lock_guard<std::mutex> lk(worker.lock);
+    if (!worker.active || worker.count == worker.ring.size())
+      continue;
+    worker.ring[(worker.head + worker.count++) % worker.ring.size()] = thunk;
+    placed = true;
+  }
+
+  if (!placed) {
+    std::lock_guard<std::mutex> lk(m_overflowLock);
+    m_overflow.push_back(thunk);
+    m_nOverflow++;
+  }
+
+  // Only participants that have gone to sleep need to be notified
+  if (m_nSleeping)
+    std::lock_guard<std::mutex>{m_sleepLock}, m_wake.notify_one();
+}
+
+DispatchThunkBase* StealingThreadPool::PopRing(Worker& worker) {
+  DispatchThunkBase* retVal = worker.ring[worker.head];
+  worker.head = (worker.head + 1) % worker.ring.size();
+  worker.count--;
+  return retVal;
+}
+
+DispatchThunkBase* StealingThreadPool::Pop(Worker* pWorker) {
+  DispatchThunkBase* retVal = nullptr;
+
+  // Local ring first:
+  if (pWorker) {
+    std::lock_guard<std::mutex> lk(pWorker->lock);
+    if (pWorker->count)
+      retVal = PopRing(*pWorker);
+  }
+
+  // Then anything that didn't fit anywhere:
+  if (!retVal && m_nOverflow) {
+    std::lock_guard<std::mutex> lk(m_overflowLock);
+    if (!m_overflow.empty()) {
+      retVal = m_overflow.front();
+      m_overflow.pop_front();
+      m_nOverflow--;
+    }
+  }
+
+  // Then steal from a neighbor, starting with the next ring over so thieves spread out:
+  size_t start = pWorker ? pWorker - m_workers.get() + 1 : 0;
+  for (size_t i = 0; !retVal && i < m_nWorkers; i++) {
+    Worker& victim = m_workers[(start + i) % m_nWorkers];
+    if (&victim == pWorker)
+      continue;
+
+    std::lock_guard<std::mutex> lk(victim.lock);
+    if (victim.count)
+      retVal = PopRing(victim);
+  }
+
+  if (retVal)
+    m_pending--;
+  return retVal;
+}
+
+void StealingThreadPool::DrainKey(size_t key) {
+  // Only run the items that were present when this drain started, and then go to the back of the
+  // line, so that one busy key cannot monopolize a participant
+  size_t nItems;
+  {
+    std::lock_guard<std::mutex> lk(m_keyLock);
+    nItems = m_keyed[key].size();
+  }
+
+  // Retire or reschedule this key on the way out, even if an item throws, so that later items with
+  // the same key are not stranded
+  auto next = MakeAtExit([this, key] {
+    {
+      std::lock_guard<std::mutex> lk(m_keyLock);
+      auto q = m_keyed.find(key);
+      if (q->second.empty()) {
+        m_keyed.erase(q);
+        return;
+      }
+    }
+    Push(key, MakeDispatchThunk([this, key] { DrainKey(key); }).release());
+  });
+
+  while (nItems--) {
+    std::unique_ptr<DispatchThunkBase> thunk;
+    {
+      std::lock_guard<std::mutex> lk(m_keyLock);
+      auto& items = m_keyed[key];
+      thunk = std::move(items.front());
+      items.pop_front();
+    }
+    (*thunk)();
+  }
+}
+
+void StealingThreadPool::WakeAllWaitingThreads(void) {
+  std::lock_guard<std::mutex>{m_sleepLock}, m_wake.notify_all();
+}
+
+std::shared_ptr<StealingThreadPoolToken> StealingThreadPool::PrepareJoin(void) {
+  return std::make_shared<StealingThreadPoolToken>(
+    std::static_pointer_cast<StealingThreadPool>(shared_from_this())
+  );
+}
+
+void StealingThreadPool::Join(std::shared_ptr<StealingThreadPoolToken> token) {
+  // Claim a ring, if there is one left
+  Worker* pWorker = nullptr;
+  for (size_t i = 0; i < m_nWorkers && !pWorker; i++) {
+    std::lock_guard<std::mutex> lk(m_workers[i].lock);
+    if (!m_workers[i].active) {
+      m_workers[i].active = true;
+      pWorker = &m_workers[i];
+    }
+  }
+
+  auto release = MakeAtExit([this, pWorker] {
+    if (!pWorker)
+      return;
+
+    // Anything left behind moves to the overflow queue, where the remaining participants will find it
+    std::lock_guard<std::mutex> lk(pWorker->lock);
+    pWorker->active = false;
+    std::lock_guard<std::mutex> olk(m_overflowLock);
+    while (pWorker->count) {
+      m_overflow.push_back(PopRing(*pWorker));
+      m_nOverflow++;
+    }
+  });
+
+  try {
+    while (!token->cancelled) {
+      std::unique_ptr<DispatchThunkBase> thunk(Pop(pWorker));
+      if (thunk) {
+        (*thunk)();
+        continue;
+      }
+
+      // Nothing to do, sleep until something is pended.  Work may be pended between our attempt to
+      // pop and the sleep counter increment, so the pending count must be checked after it.
+      std::unique_lock<std::mutex> lk(m_sleepLock);
+      m_nSleeping++;
+      m_wake.wait(lk, [&] { return m_pending || token->cancelled; });
+      m_nSleeping--;
+    }
+  }
+  catch (...) {
+    // Unknown, consume exception and end here
+  }
+}
+
+bool StealingThreadPool::Submit(std::unique_ptr<DispatchThunkBase>&& thunk) {
+  Push(m_next++, thunk.release());
+  return true;
+}
+
+bool StealingThreadPool::Submit(size_t key, std::unique_ptr<DispatchThunkBase>&& thunk) {
+  {
+    std::lock_guard<std::mutex> lk(m_keyLock);
+    auto q = m_keyed.find(key);
+    if (q != m_keyed.end()) {
+      // A drain for this key is already underway and will find this item
+      q->second.push_back(std::move(thunk));
+      return true;
+    }
+    m_keyed[key].push_back(std::move(thunk));
+  }
+  Push(key, MakeDispatchThunk([this, key] { DrainKey(key); }).release());
+  return true;
+}
@@ -0,0 +1,155 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include "ThreadPool.h"
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace autowiring {
+
+class StealingThreadPool;
+
+struct StealingThreadPoolToken {
+  StealingThreadPoolToken(const std::shared_ptr<StealingThreadPool>& pool) :
+    pool(pool)
+  {}
+
+  const std::shared_ptr<StealingThreadPool> pool;
+
+  // True if the thread owning this token should back out
+  std::atomic<bool> cancelled{false};
+
+  /// <summary>
+  /// Causes the thread that has joined the thread pool to leave that pool
+  /// </summary>
+  /// <remarks>
+  /// This method is idempotent.  This method may be called on a token either before or after the
+  /// corresponding thread has begun participating in the pool.
+  /// </remarks>
+  void Leave(void);
+};
+
+/// <summary>
+/// A variant of ManualThreadPool in which each participant has its own bounded work queue
+/// </summary>
+/// <remarks>
+/// As with ManualThreadPool, no threads are created by this pool; work is run by threads that call
+/// Join.  Each joined thread is given a bounded local ring.  Unkeyed submissions are distributed
+/// across these rings in round-robin order, and a participant whose ring is empty steals from the
+/// rings of other participants.  Work that does not fit in any ring, or that is submitted while no
+/// thread has joined, is held in a shared overflow queue.
+///
+/// Work submitted with a key is run in submission order with respect to other work bearing the same
+/// key, and never concurrently with it, while work for distinct keys runs in parallel.  Keyed work
+/// is preferentially placed on the ring selected by the key so that it tends to stay on one thread.
+/// </remarks>
+class StealingThreadPool:
+  public ThreadPool
+{
+public:
+  /// <param name="maxWorkers">The number of participants that are given a local ring</param>
+  /// <param name="ringCapacity">The number of work items each local ring can hold</param>
+  StealingThreadPool(size_t maxWorkers = 8, size_t ringCapacity = 256);
+  ~StealingThreadPool(void);
+
+private:
+  struct Worker {
+    std::mutex lock;
+
+    // True while a joined thread owns this ring
+    bool active = false;
+
+    // Ring storage, first ready entry, and number of entries
+    std::vector<DispatchThunkBase*> ring;
+    size_t head = 0;
+    size_t count = 0;
+  };
+
+  const size_t m_nWorkers;
+  const std::unique_ptr<Worker[]> m_workers;
+
+  // Round-robin index for unkeyed submissions
+  std::atomic<size_t> m_next{0};
+
+  // Work that could not be placed in a ring
+  std::mutex m_overflowLock;
+  std::deque<DispatchThunkBase*> m_overflow;
+  std::atomic<size_t> m_nOverflow{0};
+
+  // Total number of items in all rings and the overflow queue, and the number of participants
+  // that are blocked waiting for one
+  std::atomic<size_t> m_pending{0};
+  std::atomic<size_t> m_nSleeping{0};
+  std::mutex m_sleepLock;
+  std::condition_variable m_wake;
+
+  // Work waiting on an earlier item with the same key.  A key is present in this map exactly when
+  // a drain for that key has been submitted and has not yet finished.
+  std::mutex m_keyLock;
+  std::unordered_map<size_t, std::deque<std::unique_ptr<DispatchThunkBase>>> m_keyed;
+
+  /// <summary>
+  /// Places a thunk on the first active ring at or after the hinted index with room for it
+  /// </summary>
+  void Push(size_t hint, DispatchThunkBase* thunk);
+
+  /// <summary>
+  /// Obtains the next thunk for the participant owning the specified ring, stealing if necessary
+  /// </summary>
+  /// <returns>The thunk, or nullptr if no work was found</returns>
+  DispatchThunkBase* Pop(Worker* pWorker);
+
+  /// <summary>
+  /// Takes the oldest entry from the passed ring
+  /// </summary>
+  static DispatchThunkBase* PopRing(Worker& worker);
+
+  /// <summary>
+  /// Runs items queued under the specified key, rescheduling itself if more remain
+  /// </summary>
+  void DrainKey(size_t key);
+
+public:
+  /// <summary>
+  /// Wakes every participant so that they can observe cancellation
+  /// </summary>
+  void WakeAllWaitingThreads(void);
+
+  /// <summary>
+  /// Provides a shared pointer that a participating thread may use to release itself from the pool
+  /// </summary>
+  /// <remarks>
+  /// The returned token may be used in exactly one call to Join.  Tokens may safely outlive the
+  /// thread pool that issued them.
+  /// </remarks>
+  std::shared_ptr<StealingThreadPoolToken> PrepareJoin(void);
+
+  /// <summary>
+  /// Causes the caller to perform work on this thread pool until its token is cancelled
+  /// </summary>
+  /// <param name="token">The token returned by a prior call to PrepareJoin</param>
+  /// <remarks>
+  /// If every local ring is already owned by some other participant, the caller only steals.  When
+  /// this method returns, any work left in the caller's ring is moved to the overflow queue.
+  /// </remarks>
+  void Join(std::shared_ptr<StealingThreadPoolToken> token);
+
+  /// <summary>
+  /// Submits work that must run after, and not concurrently with, all prior work with the same key
+  /// </summary>
+  bool Submit(size_t key, std::unique_ptr<DispatchThunkBase>&& thunk);
+
+  /// <summary>
+  /// Keyed counterpart of operator+=
+  /// </summary>
+  template<class Fx>
+  bool Submit(size_t key, Fx&& fx) {
+    return Submit(key, std::unique_ptr<DispatchThunkBase>(new DispatchThunk<Fx>(std::forward<Fx&&>(fx))));
+  }
+
+  // ThreadPool overrides:
+  bool Submit(std::unique_ptr<DispatchThunkBase>&& thunk) override;
+};
+
+}
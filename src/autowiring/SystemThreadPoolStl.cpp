@@ -23,10 +23,37 @@ std::shared_ptr<SystemThreadPool> SystemThreadPool::New(void) {
 void SystemThreadPoolStl::AddWorkerThreadUnsafe(void) {
   auto pThis = shared_from_this();
   std::thread t([this, pThis] {
-    auto clear = MakeAtExit([&] { m_outstanding--; });
+    bool retired = false;
+    auto clear = MakeAtExit([&] {
+      if (!retired)
+        m_outstanding--;
+    });
     try {
-      for (;;)
-        m_toBeDone.WaitForEvent();
+      // False only after this worker timed out but a queued thunk had already claimed it
+      bool enterIdle = true;
+      for (;;) {
+        if (enterIdle)
+          m_idle++;
+
+        enterIdle = true;
+        if (m_toBeDone.WaitForEvent(m_keepAlive))
+          continue;
+
+        if (!TryRetireIdle()) {
+          // A thunk is on its way, keep waiting for it without counting ourselves twice
+          enterIdle = false;
+          continue;
+        }
+
+        std::lock_guard<std::mutex> lk(m_lock);
+        if (m_outstanding > m_minWorkers) {
+          // Surplus worker, exit.  The count is released under lock so that concurrently retiring
+          // workers cannot shrink the pool below its minimum.
+          m_outstanding--;
+          retired = true;
+          return;
+        }
+      }
     }
     catch (dispatch_aborted_exception&) {
       // Dispatch aborted exception, back out
@@ -39,6 +66,14 @@ void SystemThreadPoolStl::AddWorkerThreadUnsafe(void) {
   m_outstanding++;
 }
 
+bool SystemThreadPoolStl::TryRetireIdle(void) {
+  ptrdiff_t idle = m_idle;
+  while (idle > 0)
+    if (m_idle.compare_exchange_weak(idle, idle - 1))
+      return true;
+  return false;
+}
+
 void SystemThreadPoolStl::OnStartUnsafe(void) {
   if (m_outstanding)
     // Do nothing if the pool size was already set by someone else
@@ -48,7 +83,10 @@ void SystemThreadPoolStl::OnStartUnsafe(void) {
   // get_nprocs() on gcc, to retain libstdc++ backwards-compatibility).  This can't
   // be done right now due to the fact that DispatchQueue has terrible concurrency
   // performance.
-  while (m_outstanding < 2)
+  //
+  // Thunks submitted before the pool was started each need a worker, too
+  ptrdiff_t backlog = -m_idle;
+  while (m_outstanding < m_minWorkers || (backlog-- > 0 && m_outstanding < m_maxWorkers))
     AddWorkerThreadUnsafe();
 }
 
@@ -58,18 +96,23 @@ void SystemThreadPoolStl::OnStop(void) {
 
 void SystemThreadPoolStl::SuggestThreadPoolSize(size_t nThreads) {
   std::lock_guard<std::mutex> lk(m_lock);
+  m_minWorkers = nThreads;
   while (m_outstanding < nThreads)
     AddWorkerThreadUnsafe();
 }
 
 bool SystemThreadPoolStl::Submit(std::unique_ptr<DispatchThunkBase>&& thunk) {
   // Add some more work
-  m_toBeDone.AddExisting(std::move(thunk));
+  if (!m_toBeDone.AddExisting(std::move(thunk)))
+    return false;
+
+  // Claim a waiting worker.  If there isn't one, every worker is busy and we need another, unless
+  // the pool is already at its maximum size.  In that case the thunk waits for a busy worker.
+  if (m_idle-- > 0)
+    return true;
 
-  // If we don't have anyone to do work, we need to wake someone up:
   std::lock_guard<std::mutex> lk(m_lock);
-  if (!m_outstanding && !m_startToken.expired())
+  if (!m_startToken.expired() && m_outstanding < m_maxWorkers)
     AddWorkerThreadUnsafe();
-
-  return false;
+  return true;
 }
@@ -14,6 +14,11 @@ namespace autowiring {
 /// This implementation avoids using std::async to achieve thread pooling because some systems
 /// do not attempt to reuse threads to run operations enqueued by std::async, resulting in very
 /// poor performance.
+///
+/// The pool is elastic.  Work that is submitted while every worker is busy causes a new worker to
+/// be created, so that work items which block on one another cannot starve the pool.  Workers in
+/// excess of the suggested pool size exit once they have been idle for the keepalive period.  The
+/// pool never grows past its maximum size; work submitted at that size waits for a busy worker.
 /// </remarks>
 class SystemThreadPoolStl:
   public SystemThreadPool
@@ -29,16 +34,47 @@ private:
   // The current number of outstanding workers
   std::atomic<size_t> m_outstanding{0};
 
+  // The number of waiting workers less the number of queued thunks.  Negative if there are thunks
+  // that no waiting worker is available to run.
+  std::atomic<ptrdiff_t> m_idle{0};
+
+  // Number of workers retained while idle, the most workers the pool will create, and the time after
+  // which idle extra workers exit
+  size_t m_minWorkers = 2;
+  size_t m_maxWorkers = 256;
+  std::chrono::milliseconds m_keepAlive{10000};
+
   /// <summary>
   /// Creates a new worker thread to process the dispatch queue
   /// </summary>
   void AddWorkerThreadUnsafe(void);
 
+  /// <summary>
+  /// Withdraws a waiting worker from the idle count, if no queued thunk has claimed it
+  /// </summary>
+  bool TryRetireIdle(void);
+
   // ThreadPool overrides
   void OnStartUnsafe(void) override;
   void OnStop(void) override;
 
 public:
+  /// <summary>
+  /// Sets the time after which idle workers in excess of the suggested pool size exit
+  /// </summary>
+  void SetKeepAlive(std::chrono::milliseconds keepAlive) { m_keepAlive = keepAlive; }
+
+  /// <summary>
+  /// Sets the most workers this pool will create when work is submitted while every worker is busy
+  /// </summary>
+  /// <remarks>
+  /// The suggested pool size takes precedence if it is larger
+  /// </remarks>
+  void SetMaxWorkers(size_t maxWorkers) {
+    std::lock_guard<std::mutex> lk(m_lock);
+    m_maxWorkers = maxWorkers;
+  }
+
   void SuggestThreadPoolSize(size_t nThreads) override;
   bool Submit(std::unique_ptr<DispatchThunkBase>&& thunk) override;
 };
@@ -66,7 +66,8 @@ void SystemThreadPoolWinLH::Consume(const std::shared_ptr<DispatchQueue>& dq)
 bool SystemThreadPoolWinLH::Submit(std::unique_ptr<DispatchThunkBase>&& thunk)
 {
   std::lock_guard<std::mutex> lk(m_lock);
-  m_toBeDone.AddExisting(std::move(thunk));
+  if (!m_toBeDone.AddExisting(std::move(thunk)))
+    return false;
   if (m_pwkSingle)
     g_SubmitThreadpoolWork(m_pwkSingle);
   return true;
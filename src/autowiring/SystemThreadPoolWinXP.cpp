@@ -36,7 +36,8 @@ void SystemThreadPoolWinXP::Consume(const std::shared_ptr<DispatchQueue>& dq)
 bool SystemThreadPoolWinXP::Submit(std::unique_ptr<DispatchThunkBase>&& thunk)
 {
   std::lock_guard<std::mutex> lk(m_lock);
-  m_toBeDone.AddExisting(std::move(thunk));
+  if (!m_toBeDone.AddExisting(std::move(thunk)))
+    return false;
   QueueUserWorkItem(
     [](void* Context) {
       // Spin down our dispatch queue until it is empty:
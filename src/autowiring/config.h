@@ -1,71 +1,209 @@
 // Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
 #pragma once
+#include "config_epoch.h"
 #include "marshaller.h"
-#include "spin_lock.h"
-#include <array>
+#include <atomic>
 
 namespace autowiring {
   /// <summary>
   /// A configuration value tracker class used with the configuration systems
   /// </summary>
   /// <remarks>
-  /// This class uses a double-buffered value approach to avoid synchronization requirements
-  /// under asynchronous update.  It assumes a single point of use and multiple points of
-  /// update.  The clear_dirty call can be used to simaltaneously switch the active value
-  /// buffer and also clear the dirty flag.
+  /// Values are published through an atomic pointer to an immutable, heap-allocated node.
+  /// Assignment constructs a new pending node and swaps it in without blocking.  The
+  /// clear_dirty call makes the most recently assigned node active.
+  ///
+  /// The plain accessors, get and the operator overloads, read the active node without any
+  /// synchronization beyond a single atomic load.  The node they refer to is kept for one further
+  /// publication:  a reference obtained from them remains valid until clear_dirty has made two
+  /// newer values active, just as the double-buffered value it replaces was only overwritten by the
+  /// assignment after next.  A read guard refers to its value until the guard is destroyed, no
+  /// matter how many values are published in the meantime; see read.
   /// </remarks>
   template<typename T>
   struct config {
-    config(void) = default;
+  private:
+    struct node {
+      template<typename... Args>
+      explicit node(Args&&... args) :
+        value(std::forward<Args>(args)...)
+      {}
+
+      const T value;
+
+      // Epoch at which this node was retired, and the link in the retired list
+      uint64_t epoch = 0;
+      node* pFlink = nullptr;
+    };
+
+  public:
+    config(void) :
+      m_active(new node)
+    {}
     config(const config&) = delete;
-    config(config&& rhs):
-      dirty(rhs.dirty),
-      valueIndex(rhs.valueIndex)
-    {
-      values[0] = std::move(rhs.values[0]);
-      values[1] = std::move(rhs.values[1]);
-    }
 
-    explicit config(const T& value) { values[0] = value; }
-    explicit config(T&& value) { values[0] = std::move(value); }
+    /// <remarks>
+    /// The moved-from config holds a default-constructed value.  Neither config may be read
+    /// while the move is under way.
+    /// </remarks>
+    config(config&& rhs) :
+      m_active(rhs.m_active.exchange(new node)),
+      m_pending(rhs.m_pending.exchange(nullptr)),
+      m_prior(rhs.m_prior.exchange(nullptr)),
+      m_retired(rhs.m_retired.exchange(nullptr)),
+      m_dirty(rhs.m_dirty.load())
+    {}
+
+    explicit config(const T& value) : m_active(new node(value)) {}
+    explicit config(T&& value) : m_active(new node(std::move(value))) {}
 
     template<typename U>
-    explicit config(U&& value) {
-      values[0] = std::forward<U&&>(value);
+    explicit config(U&& value) :
+      m_active(new node(T(std::forward<U&&>(value))))
+    {}
+
+    ~config(void) {
+      delete m_active.load();
+      delete m_pending.load();
+      delete m_prior.load();
+      for (node* pNext, *pNode = m_retired.exchange(nullptr); pNode; pNode = pNext) {
+        pNext = pNode->pFlink;
+        delete pNode;
+      }
     }
 
   private:
-    // Lock, used to move the asyncrhonous value to the value field
-    autowiring::spin_lock lock;
+    // The active value, advertised by accessors
+    std::atomic<node*> m_active{ nullptr };
+
+    // The most recent assignment, not yet made active
+    std::atomic<node*> m_pending{ nullptr };
+
+    // The value that was active before m_active, still referred to by the plain accessors' contract
+    std::atomic<node*> m_prior{ nullptr };
+
+    // Nodes that may still be referenced by a read guard
+    std::atomic<node*> m_retired{ nullptr };
 
     // Tracks whether the backing value has been updated
-    bool dirty = true;
+    std::atomic<bool> m_dirty{ true };
+
+    /// <summary>
+    /// Prepends a chain of nodes to the retired list
+    /// </summary>
+    void retire(node* pFirst, node* pLast) {
+      node* pHead = m_retired.load(std::memory_order_relaxed);
+      do pLast->pFlink = pHead;
+      while (!m_retired.compare_exchange_weak(pHead, pFirst, std::memory_order_release, std::memory_order_relaxed));
+    }
 
-    // The index of the currently active value
-    size_t valueIndex = 0;
+    /// <summary>
+    /// Frees every retired node that no read guard can refer to, the rest are left for later
+    /// </summary>
+    void try_reclaim(void) {
+      node* pNode = m_retired.exchange(nullptr, std::memory_order_acquire);
+      if (!pNode)
+        return;
 
-    // The active value, advertised by accessors, and the dirty value, accessed
-    // by assigners.
-    std::array<T, 2> values;
+      const uint64_t oldest = config_epoch::oldest();
+      node* pFirst = nullptr;
+      node* pLast = nullptr;
+      for (node* pNext; pNode; pNode = pNext) {
+        pNext = pNode->pFlink;
+        if (pNode->epoch <= oldest) {
+          delete pNode;
+          continue;
+        }
+
+        pNode->pFlink = pFirst;
+        pFirst = pNode;
+        if (!pLast)
+          pLast = pNode;
+      }
+      if (pFirst)
+        retire(pFirst, pLast);
+    }
 
   public:
-    bool is_dirty(void) const { return dirty; }
-    const T& get(void) const { return values[valueIndex]; }
+    /// <summary>
+    /// A guard which holds a consistent view of the active value
+    /// </summary>
+    /// <remarks>
+    /// Constructing a guard pins the current epoch on the calling thread; it does not allocate,
+    /// loop, or contend with other readers.  The value referred to by the guard is not reclaimed
+    /// until the guard is destroyed, even if the config is updated and clear_dirty is called in the
+    /// meantime.  A guard must be destroyed on the thread that created it.  While any guard is held,
+    /// no config value retired after it was created is reclaimed, so guards should be short-lived.
+    /// </remarks>
+    class reader {
+    public:
+      explicit reader(const config& cfg) :
+        m_pRecord(config_epoch::pin()),
+        m_pNode(cfg.m_active.load(std::memory_order_seq_cst))
+      {}
+
+      reader(reader&& rhs) :
+        m_pRecord(rhs.m_pRecord),
+        m_pNode(rhs.m_pNode)
+      {
+        rhs.m_pRecord = nullptr;
+      }
+
+      reader(const reader&) = delete;
+
+      ~reader(void) {
+        if (m_pRecord)
+          config_epoch::unpin(m_pRecord);
+      }
+
+    private:
+      config_epoch::record* m_pRecord;
+      const node* m_pNode;
+
+    public:
+      const T& get(void) const { return m_pNode->value; }
+      operator const T&(void) const { return get(); }
+      const T* operator->(void) const { return &get(); }
+      const T& operator*(void) const { return get(); }
+    };
+
+    bool is_dirty(void) const { return m_dirty.load(std::memory_order_acquire); }
+
+    /// <returns>The active value</returns>
+    const T& get(void) const { return m_active.load(std::memory_order_acquire)->value; }
+
+    /// <summary>
+    /// Obtains a read guard on the active value
+    /// </summary>
+    /// <remarks>
+    /// Use this method instead of get when the value must be used across calls to clear_dirty that
+    /// may be made on other threads
+    /// </remarks>
+    reader read(void) const { return reader(*this); }
 
     /// <summary>
     /// Clears the dirty bit and returns its value prior to the clear
     /// </summary>
     /// <returns>True if the field was dirty, false otherwise</returns>
     /// <remarks>
-    /// This method must be synchronized with all accessors.
+    /// If a value has been assigned since the last call, it becomes the active value.  Read guards
+    /// obtained prior to this call continue to refer to the value they were constructed with.
     /// </remarks>
     bool clear_dirty(void) {
-      if (!dirty)
+      if (!m_dirty.exchange(false, std::memory_order_acq_rel))
         return false;
 
-      std::lock_guard<autowiring::spin_lock> lk(lock);
-      valueIndex = !valueIndex;
-      dirty = false;
+      node* pNode = m_pending.exchange(nullptr, std::memory_order_acquire);
+      if (pNode) {
+        // The value displaced two publications ago is no longer covered by the plain accessors, it
+        // only has to outlive read guards that may have been created before it was unpublished
+        node* pExpired = m_prior.exchange(m_active.exchange(pNode, std::memory_order_seq_cst), std::memory_order_acq_rel);
+        if (pExpired) {
+          pExpired->epoch = config_epoch::advance();
+          retire(pExpired, pExpired);
+        }
+      }
+      try_reclaim();
       return true;
     }
 
@@ -79,14 +217,13 @@ namespace autowiring {
     /// Forces an update to the value stored in this field
     /// </summary>
     /// <remarks>
-    ///
+    /// The value becomes visible once clear_dirty is called
     /// </remarks>
     void force_assign(T rhs) { *this = std::move(rhs); }
 
   private:
     config& operator=(const config& value) {
-      // Local copy to hold the spin lock a minimum amount of time
-      return *this = value.get();
+      return *this = value.read().get();
     }
 
     template<typename U>
@@ -96,9 +233,10 @@ namespace autowiring {
 
     template<typename U>
     config& operator=(U&& rhs) {
-      std::lock_guard<autowiring::spin_lock> lk(lock);
-      this->values[!valueIndex] = std::forward<U&&>(rhs);
-      dirty = true;
+      // Construct outside of any synchronization, then swap in.  A pending value that was never
+      // made active cannot have been observed by anyone, so it can be freed immediately.
+      delete m_pending.exchange(new node(std::forward<U&&>(rhs)), std::memory_order_acq_rel);
+      m_dirty.store(true, std::memory_order_release);
       return *this;
     }
 
@@ -119,7 +257,8 @@ namespace autowiring {
     marshaller<T> interior;
 
     std::string marshal(const void* ptr) const override {
-      return interior.marshal(&static_cast<const type*>(ptr)->get());
+      auto guard = static_cast<const type*>(ptr)->read();
+      return interior.marshal(&guard.get());
     }
 
     void unmarshal(void* ptr, const char* szValue) const override {
@@ -128,6 +267,10 @@ namespace autowiring {
       *static_cast<type*>(ptr) = std::move(value);
     }
 
+    void validate(const char* szValue) const override {
+      interior.validate(szValue);
+    }
+
     void copy(void* lhs, const void* rhs) const override {
       *static_cast<config<T>*>(lhs) = *static_cast<const config<T>*>(rhs);
     }
@@ -0,0 +1,60 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "config_epoch.h"
+#include "thread_specific_ptr.h"
+
+using namespace autowiring;
+
+// Epoch zero is reserved to mark records that hold no pin
+static std::atomic<uint64_t> s_epoch{1};
+
+// Records of all threads, past and present.  Records are reused by later threads and never freed.
+static std::atomic<config_epoch::record*> s_records{nullptr};
+
+// The calling thread's record, handed back for reuse when the thread exits
+static thread_specific_ptr<config_epoch::record> s_localRecord([] (void* ptr) {
+  if (ptr)
+    static_cast<config_epoch::record*>(ptr)->inUse.store(false, std::memory_order_release);
+});
+
+static config_epoch::record* claim_record(void) {
+  for (auto pRecord = s_records.load(std::memory_order_acquire); pRecord; pRecord = pRecord->pFlink) {
+    bool inUse = false;
+    if (!pRecord->inUse.load(std::memory_order_relaxed) && pRecord->inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire))
+      return pRecord;
+  }
+
+  auto pRecord = new config_epoch::record;
+  pRecord->inUse.store(true, std::memory_order_relaxed);
+  auto pHead = s_records.load(std::memory_order_relaxed);
+  do pRecord->pFlink = pHead;
+  while (!s_records.compare_exchange_weak(pHead, pRecord, std::memory_order_release, std::memory_order_relaxed));
+  return pRecord;
+}
+
+config_epoch::record* config_epoch::pin(void) {
+  record* pRecord = s_localRecord.get();
+  if (!pRecord) {
+    pRecord = claim_record();
+    s_localRecord.reset(pRecord);
+  }
+
+  // The announcement must be ordered before the reader's load of the value it protects
+  if (!pRecord->depth++)
+    pRecord->epoch.store(s_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+  return pRecord;
+}
+
+uint64_t config_epoch::advance(void) {
+  return s_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+}
+
+uint64_t config_epoch::oldest(void) {
+  uint64_t retVal = ~uint64_t(0);
+  for (auto pRecord = s_records.load(std::memory_order_acquire); pRecord; pRecord = pRecord->pFlink) {
+    uint64_t epoch = pRecord->epoch.load(std::memory_order_seq_cst);
+    if (epoch && epoch < retVal)
+      retVal = epoch;
+  }
+  return retVal;
+}
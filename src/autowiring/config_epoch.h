@@ -0,0 +1,64 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace autowiring {
+
+/// <summary>
+/// Epoch-based reclamation shared by all config fields
+/// </summary>
+/// <remarks>
+/// Each thread that reads a config value through a read guard announces the global epoch it observed
+/// in a record of its own.  The record is claimed the first time the thread pins an epoch and is kept
+/// until the thread exits, so pinning is a handful of thread-local operations and a single store; it
+/// neither allocates nor loops.  A value retired at some epoch may be freed once every pinned record
+/// has announced that epoch or a later one.
+/// </remarks>
+class config_epoch {
+public:
+  struct record {
+    // The epoch pinned by the owning thread, or zero if the thread holds no read guard
+    std::atomic<uint64_t> epoch{0};
+
+    // Number of read guards held by the owning thread, only accessed by that thread
+    size_t depth = 0;
+
+    // Set while a thread owns this record
+    std::atomic<bool> inUse{false};
+
+    // Link in the record list, immutable once the record has been published
+    record* pFlink = nullptr;
+  };
+
+  /// <summary>
+  /// Pins the current epoch on the calling thread
+  /// </summary>
+  /// <returns>The calling thread's record, to be passed to unpin on the same thread</returns>
+  /// <remarks>
+  /// Pins nest, only the outermost pin announces an epoch
+  /// </remarks>
+  static record* pin(void);
+
+  /// <summary>
+  /// Releases a pin obtained from pin
+  /// </summary>
+  static void unpin(record* pRecord) {
+    if (!--pRecord->depth)
+      pRecord->epoch.store(0, std::memory_order_release);
+  }
+
+  /// <summary>
+  /// Starts a new epoch
+  /// </summary>
+  /// <returns>The epoch at which a value unpublished before this call is retired</returns>
+  static uint64_t advance(void);
+
+  /// <returns>
+  /// The oldest epoch pinned by any thread, or the largest epoch if no thread holds a pin.  Values
+  /// retired at or before this epoch are no longer referenced by any read guard.
+  /// </returns>
+  static uint64_t oldest(void);
+};
+
+}
@@ -0,0 +1,170 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include "AutoFilterDescriptor.h"
+#include "AutoPacket.h"
+#include "autowiring_error.h"
+#include "CoreObject.h"
+#include "DispatchQueue.h"
+
+// Coroutine support requires a C++20 compiler; under earlier standards this header is empty
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && defined(__has_include)
+#if __has_include(<coroutine>)
+#define AUTOWIRING_HAS_COROUTINES 1
+#endif
+#endif
+
+#if AUTOWIRING_HAS_COROUTINES
+#include <atomic>
+#include <coroutine>
+#include <exception>
+
+namespace autowiring {
+
+/// <summary>
+/// A coroutine return type for fire-and-forget coroutines
+/// </summary>
+/// <remarks>
+/// The coroutine starts running as soon as it is called and frees itself when it completes.  Nothing
+/// may await a detached_task.  An exception that escapes the coroutine body terminates the program,
+/// just as it would if it escaped a thread procedure.
+///
+/// Example:
+///
+///   autowiring::detached_task Process(std::shared_ptr<AutoPacket> packet, CoreThread& worker) {
+///     const Frame& frame = co_await packet->Await<Frame>();
+///     co_await worker.schedule();
+///     ...
+///   }
+/// </remarks>
+struct detached_task {
+  struct promise_type {
+    detached_task get_return_object(void) noexcept { return{}; }
+    std::suspend_never initial_suspend(void) noexcept { return{}; }
+    std::suspend_never final_suspend(void) noexcept { return{}; }
+    void return_void(void) noexcept {}
+    void unhandled_exception(void) noexcept { std::terminate(); }
+  };
+};
+
+/// <summary>
+/// Dispatch queue lambda which resumes a suspended coroutine
+/// </summary>
+/// <remarks>
+/// If this lambda is destroyed without being run, because the queue refused it or was aborted, the
+/// coroutine is destroyed in the same way that any other lambda pended to the queue would be.
+/// </remarks>
+class coroutine_resumer {
+public:
+  explicit coroutine_resumer(std::coroutine_handle<> handle) :
+    m_handle(handle)
+  {}
+  coroutine_resumer(coroutine_resumer&& rhs) noexcept :
+    m_handle(rhs.m_handle)
+  {
+    rhs.m_handle = nullptr;
+  }
+  coroutine_resumer(const coroutine_resumer&) = delete;
+
+  ~coroutine_resumer(void) {
+    if (m_handle)
+      m_handle.destroy();
+  }
+
+private:
+  std::coroutine_handle<> m_handle;
+
+public:
+  void operator()(void) {
+    auto handle = m_handle;
+    m_handle = nullptr;
+    handle.resume();
+  }
+};
+
+/// <summary>
+/// Awaiter for DispatchQueue::schedule
+/// </summary>
+class dispatch_schedule_awaiter {
+public:
+  explicit dispatch_schedule_awaiter(DispatchQueue& queue) :
+    m_queue(queue)
+  {}
+
+private:
+  DispatchQueue& m_queue;
+
+public:
+  bool await_ready(void) const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    // The coroutine may be resumed or destroyed before this call returns, so nothing belonging to the
+    // coroutine frame, including this awaiter, may be touched after the pend
+    DispatchQueue& queue = m_queue;
+    queue += coroutine_resumer{ handle };
+  }
+
+  void await_resume(void) const noexcept {}
+};
+
+/// <summary>
+/// Awaiter for AutoPacket::Await
+/// </summary>
+template<class T>
+class packet_awaiter {
+public:
+  explicit packet_awaiter(AutoPacket& packet) :
+    m_packet(packet)
+  {}
+
+private:
+  AutoPacket& m_packet;
+
+  // The decoration, or null if it was found to be unsatisfiable
+  std::shared_ptr<const T> m_value;
+
+public:
+  bool await_ready(void) {
+    return m_packet.Get(m_value) && m_value;
+  }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    // A shared pointer input is optional, so the recipient is called once T is attached or marked
+    // unsatisfiable.  The teardown listener covers a packet that is released first.  Whichever runs
+    // first resumes the coroutine, possibly before this call returns, so the awaiter may not be
+    // touched here after the recipient is added.
+    AutoPacket& packet = m_packet;
+    auto resumed = std::make_shared<std::atomic<bool>>(false);
+    packet.AddTeardownListener(
+      [handle, resumed] {
+        if (!resumed->exchange(true))
+          handle.resume();
+      }
+    );
+    auto recipient = [this, handle, resumed](std::shared_ptr<const T> value) {
+      if (resumed->exchange(true))
+        return;
+      m_value = std::move(value);
+      handle.resume();
+    };
+    packet.AddRecipient(AutoFilterDescriptor(std::move(recipient)));
+  }
+
+  const T& await_resume(void) const {
+    if (!m_value)
+      throw autowiring_error("Awaited decoration will never be attached to this packet");
+    return *m_value;
+  }
+};
+
+inline dispatch_schedule_awaiter operator co_await(dispatch_schedule rhs) {
+  return dispatch_schedule_awaiter{ rhs.queue };
+}
+
+template<class T>
+packet_awaiter<T> operator co_await(packet_await<T> rhs) {
+  return packet_awaiter<T>{ rhs.packet };
+}
+
+}
+
+#endif
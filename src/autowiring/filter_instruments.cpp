@@ -0,0 +1,32 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "filter_instruments.h"
+#include "thread_specific_ptr.h"
+
+using namespace autowiring;
+
+// Instruments of the AutoFilter being invoked on this thread, not owned
+static thread_specific_ptr<filter_instruments> currentInstruments([] (void*) {});
+
+filter_instruments::filter_instruments(const AutoFilterArgument* pArgs, size_t arity) :
+  pArgs(pArgs),
+  arity(arity),
+  deliveries(new std::atomic<size_t>[arity])
+{
+  for (size_t i = 0; i < arity; i++)
+    deliveries[i] = 0;
+}
+
+filter_instruments* filter_instruments::current(void) {
+  return currentInstruments.get();
+}
+
+filter_instruments::scope::scope(filter_instruments* pInstruments) :
+  m_pPrior(currentInstruments.get())
+{
+  currentInstruments.reset(pInstruments);
+}
+
+filter_instruments::scope::~scope(void) {
+  currentInstruments.reset(m_pPrior);
+}
@@ -0,0 +1,116 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include "AutoFilterArgument.h"
+#include "latency_histogram.h"
+#include <atomic>
+#include CHRONO_HEADER
+#include MEMORY_HEADER
+
+namespace autowiring {
+
+/// <summary>
+/// Instrumentation attached to an AutoFilter while it is registered with an AutoPacketFactory
+/// </summary>
+/// <remarks>
+/// The factory creates one instance per AutoFilter when the AutoFilter is registered and stores a pointer to
+/// it on the descriptor it keeps, so saturation counters reach the delivery counters and latency histogram
+/// without a lookup.  The factory keeps every instance alive until no packet that could refer to it remains.
+///
+/// Deliveries are counted in place by the packet:  an input is counted when its decoration is delivered to
+/// the AutoFilter's saturation counter, and an output is counted when the AutoFilter attaches it to the
+/// packet.  The packet is never queried for the purpose of counting.
+/// </remarks>
+struct filter_instruments {
+  filter_instruments(const AutoFilterArgument* pArgs, size_t arity);
+  filter_instruments(const filter_instruments&) = delete;
+
+  // The arguments of the AutoFilter
+  const AutoFilterArgument* const pArgs;
+  const size_t arity;
+
+  // Delivery counters, one per argument.  These are shared by all subscribers and are only updated while
+  // there is at least one, so a subscriber must account for the counts made before it subscribed.
+  const std::unique_ptr<std::atomic<size_t>[]> deliveries;
+  std::atomic<size_t> nDeliverySubscribers{0};
+
+  // Set while the wall time of each call is being recorded, and the histogram of those times
+  std::atomic<bool> timing{false};
+  latency_histogram latency;
+
+  /// <returns>True if deliveries are being counted</returns>
+  bool is_counting(void) const { return nDeliverySubscribers.load(std::memory_order_relaxed) != 0; }
+
+  /// <returns>True if call latencies are being recorded</returns>
+  bool is_timing(void) const { return timing.load(std::memory_order_relaxed); }
+
+  /// <returns>True if any instrumentation is active</returns>
+  bool is_active(void) const { return is_counting() || is_timing(); }
+
+  /// <summary>
+  /// Counts a delivery on the specified argument
+  /// </summary>
+  void record(size_t argIndex) { deliveries[argIndex].fetch_add(1, std::memory_order_relaxed); }
+
+  /// <summary>
+  /// Counts a delivery on the pure output argument of the specified type, if the AutoFilter has one
+  /// </summary>
+  void record_output(auto_id id) {
+    for (size_t i = 0; i < arity; i++)
+      if (pArgs[i].id == id && pArgs[i].is_output && !pArgs[i].is_input) {
+        record(i);
+        return;
+      }
+  }
+
+  /// <returns>The instruments of the AutoFilter being invoked on the calling thread, or nullptr</returns>
+  /// <remarks>
+  /// Deferred AutoFilters capture this value when they are pended, and make it current again when the call
+  /// is actually made, so that the call is timed and its outputs counted
+  /// </remarks>
+  static filter_instruments* current(void);
+
+  /// <summary>
+  /// Records a single call of the AutoFilter as it is made
+  /// </summary>
+  /// <remarks>
+  /// Timing starts when this object is constructed.  Calls that do not reach complete, such as those that
+  /// throw, are not recorded.  Any of the methods may be used with null instruments.
+  /// </remarks>
+  class invocation {
+  public:
+    invocation(filter_instruments* pInstruments) :
+      m_pInstruments(pInstruments),
+      m_timed(pInstruments && pInstruments->is_timing())
+    {
+      if (m_timed)
+        m_start = std::chrono::high_resolution_clock::now();
+    }
+
+    /// <summary>
+    /// Records the latency of the call
+    /// </summary>
+    void complete(void) {
+      if (m_timed)
+        m_pInstruments->latency.record(std::chrono::high_resolution_clock::now() - m_start);
+    }
+
+  private:
+    filter_instruments* const m_pInstruments;
+    const bool m_timed;
+    std::chrono::high_resolution_clock::time_point m_start;
+  };
+
+  /// <summary>
+  /// Makes the specified instruments current on the calling thread for the lifetime of this object
+  /// </summary>
+  class scope {
+  public:
+    scope(filter_instruments* pInstruments);
+    ~scope(void);
+
+  private:
+    filter_instruments* const m_pPrior;
+  };
+};
+
+}
@@ -3,6 +3,9 @@
 #include "Decompose.h"
 #include "Deferred.h"
 #include "is_any.h"
+#include <utility>
+#include <vector>
+#include MEMORY_HEADER
 
 class AutoPacket;
 
@@ -16,12 +19,14 @@ namespace autowiring {
 /// Determines whether the return value of a function is allowed for an AutoFilter:
 /// - void
 /// - Deferred
+/// - DeferredBatch
 /// </summary>
 template<class W, bool Selector = true>
 struct has_autofilter_return :
   std::integral_constant<bool,
     std::is_same<void, typename Decompose<decltype(&W::AutoFilter)>::retType>::value ||
-    std::is_same<Deferred, typename Decompose<decltype(&W::AutoFilter)>::retType>::value
+    std::is_same<Deferred, typename Decompose<decltype(&W::AutoFilter)>::retType>::value ||
+    std::is_same<DeferredBatch, typename Decompose<decltype(&W::AutoFilter)>::retType>::value
   >
 {};
 
@@ -92,6 +97,22 @@ struct has_unambiguous_autofilter
       >::value;
 };
 
+/// <summary>
+/// Determines whether W has a batch routine suitable for use with a DeferredBatch AutoFilter
+/// </summary>
+template<class W>
+struct has_autofilter_batch {
+  template<class U>
+  static std::true_type select(
+    decltype(std::declval<U&>().AutoFilterBatch(std::declval<const std::vector<std::shared_ptr<AutoPacket>>&>()))*
+  );
+
+  template<class U>
+  static std::false_type select(...);
+
+  static const bool value = decltype(select<W>(nullptr))::value;
+};
+
 // Inheriting from this class ensures the existence of a valid AutoFilter method.
 // This is used to distinguish between a no AutoFilter methods
 // and multiple AutoFilter definitions.
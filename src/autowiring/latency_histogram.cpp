@@ -0,0 +1,157 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "latency_histogram.h"
+#include "thread_specific_ptr.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace autowiring;
+
+const size_t latency_histogram::sub_buckets;
+const size_t latency_histogram::bucket_count;
+
+// Index to be assigned to the next histogram created
+static std::atomic<size_t> s_nextIndex{0};
+
+// Each thread's shards, indexed by the histogram they belong to.  Entries of destroyed histograms are
+// never consulted again, because indices are not reused.
+static thread_specific_ptr<std::vector<void*>> s_shardTables;
+
+// Number of low-order bits used to select a linear bucket within a power of two
+static const unsigned sub_bucket_bits = 4;
+static_assert(latency_histogram::sub_buckets == 1 << sub_bucket_bits, "Sub-bucket count must agree with sub-bucket bits");
+
+/// <returns>The index of the most significant set bit of a nonzero value</returns>
+static unsigned msb(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long retVal;
+#if defined(_M_X64)
+  _BitScanReverse64(&retVal, value);
+#else
+  if (value >> 32) {
+    _BitScanReverse(&retVal, (unsigned long)(value >> 32));
+    retVal += 32;
+  }
+  else
+    _BitScanReverse(&retVal, (unsigned long)value);
+#endif
+  return retVal;
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+std::chrono::nanoseconds latency_snapshot::mean(void) const {
+  return std::chrono::nanoseconds(count ? sum / count : 0);
+}
+
+std::chrono::nanoseconds latency_snapshot::percentile(double fraction) const {
+  if (!count)
+    return std::chrono::nanoseconds(0);
+
+  // Rank of the sample we are looking for, one-based
+  uint64_t rank = (uint64_t)(fraction * count + 0.5);
+  if (rank < 1)
+    rank = 1;
+  if (rank > count)
+    rank = count;
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts.size(); i++) {
+    seen += counts[i];
+    if (seen >= rank) {
+      // The bucket's upper bound is never more accurate than the largest sample actually seen
+      uint64_t bound = latency_histogram::bucket_upper_bound(i);
+      return std::chrono::nanoseconds(bound < max ? bound : max);
+    }
+  }
+  return std::chrono::nanoseconds(max);
+}
+
+latency_histogram::latency_histogram(void) :
+  m_index(s_nextIndex++)
+{}
+
+latency_histogram::shard& latency_histogram::local_shard(void) {
+  std::vector<void*>* table = s_shardTables.get();
+  if (table && m_index < table->size() && (*table)[m_index])
+    return *static_cast<shard*>((*table)[m_index]);
+
+  // First sample recorded by this thread, value initialization zeroes the shard
+  shard* retVal = new shard();
+  std::lock_guard<std::mutex>{m_lock},
+    m_shards.emplace_back(retVal);
+
+  if (!table) {
+    table = new std::vector<void*>;
+    s_shardTables.reset(table);
+  }
+  if (table->size() <= m_index)
+    table->resize(m_index + 1);
+  (*table)[m_index] = retVal;
+  return *retVal;
+}
+
+size_t latency_histogram::bucket_index(uint64_t value) {
+  // Values in the first two powers of two have a bucket each
+  if (value < 2 * sub_buckets)
+    return (size_t)value;
+
+  // Beyond that, the shift determines the power of two and the top bits the position within it
+  unsigned shift = msb(value) - sub_bucket_bits;
+  size_t index = shift * sub_buckets + (size_t)(value >> shift);
+  return index < bucket_count ? index : bucket_count - 1;
+}
+
+uint64_t latency_histogram::bucket_upper_bound(size_t index) {
+  if (index < 2 * sub_buckets)
+    return index;
+
+  unsigned shift = (unsigned)(index / sub_buckets - 1);
+  uint64_t top = index % sub_buckets + sub_buckets;
+  return ((top + 1) << shift) - 1;
+}
+
+void latency_histogram::record(std::chrono::nanoseconds duration) {
+  uint64_t value = duration.count() > 0 ? (uint64_t)duration.count() : 0;
+  shard& s = local_shard();
+
+  s.counts[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+  s.sum.fetch_add(value, std::memory_order_relaxed);
+
+  // Maximum is only updated when it changes, which is rare once the histogram has warmed up
+  uint64_t prior = s.max.load(std::memory_order_relaxed);
+  while (prior < value && !s.max.compare_exchange_weak(prior, value, std::memory_order_relaxed));
+}
+
+latency_snapshot latency_histogram::snapshot(void) const {
+  latency_snapshot retVal;
+  retVal.counts.resize(bucket_count);
+
+  std::lock_guard<std::mutex> lk(m_lock);
+  for (const auto& s : m_shards) {
+    retVal.sum += s->sum.load(std::memory_order_relaxed);
+
+    uint64_t max = s->max.load(std::memory_order_relaxed);
+    if (retVal.max < max)
+      retVal.max = max;
+
+    for (size_t j = 0; j < bucket_count; j++) {
+      uint64_t count = s->counts[j].load(std::memory_order_relaxed);
+      retVal.counts[j] += count;
+      retVal.count += count;
+    }
+  }
+  return retVal;
+}
+
+void latency_histogram::reset(void) {
+  std::lock_guard<std::mutex> lk(m_lock);
+  for (const auto& s : m_shards) {
+    s->sum.store(0, std::memory_order_relaxed);
+    s->max.store(0, std::memory_order_relaxed);
+    for (auto& count : s->counts)
+      count.store(0, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,112 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include MEMORY_HEADER
+#include MUTEX_HEADER
+#include CHRONO_HEADER
+
+namespace autowiring {
+
+/// <summary>
+/// A point-in-time copy of the contents of a latency_histogram
+/// </summary>
+struct latency_snapshot {
+  // Total number of samples and the sum of all samples, in nanoseconds
+  uint64_t count = 0;
+  uint64_t sum = 0;
+
+  // The largest sample recorded
+  uint64_t max = 0;
+
+  // Sample counts, indexed by bucket
+  std::vector<uint64_t> counts;
+
+  /// <returns>The mean of all samples, or zero if there are no samples</returns>
+  std::chrono::nanoseconds mean(void) const;
+
+  /// <summary>
+  /// Estimates the value below which the specified fraction of samples fall
+  /// </summary>
+  /// <param name="fraction">A fraction in the range [0, 1], such as 0.99</param>
+  /// <returns>
+  /// The upper bound of the bucket containing the requested rank, which overestimates the true value by no
+  /// more than the precision of the histogram, or zero if there are no samples
+  /// </returns>
+  std::chrono::nanoseconds percentile(double fraction) const;
+
+  std::chrono::nanoseconds p50(void) const { return percentile(0.5); }
+  std::chrono::nanoseconds p99(void) const { return percentile(0.99); }
+  std::chrono::nanoseconds p999(void) const { return percentile(0.999); }
+};
+
+/// <summary>
+/// A log-linear histogram of durations which may be recorded concurrently without a lock
+/// </summary>
+/// <remarks>
+/// Buckets are arranged in the manner of an HDR histogram:  each power of two is divided into
+/// sub_buckets linear buckets, so every recorded value is accurate to within about 6% of itself.
+/// Values of about 2.4 hours or more are all recorded in the last bucket.
+///
+/// Each thread records into its own copy of the buckets, which is created the first time that thread
+/// records a sample and is found through a thread local table, so recording threads never share a cache
+/// line.  Copies are only merged when a snapshot is requested, so a snapshot taken while samples are
+/// being recorded may be slightly inconsistent.  Copies are retained after their threads exit so that
+/// no samples are lost.
+/// </remarks>
+class latency_histogram {
+public:
+  latency_histogram(void);
+  latency_histogram(const latency_histogram&) = delete;
+
+  // Linear buckets per power of two, and the total number of buckets
+  static const size_t sub_buckets = 16;
+  static const size_t bucket_count = 40 * sub_buckets;
+
+private:
+  // The samples recorded by a single thread.  Only that thread writes to the shard, other threads
+  // read it when taking a snapshot or write it when resetting.
+  struct shard {
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t> counts[bucket_count];
+  };
+
+  // Index of this histogram in each thread's table of shards, indices are never reused
+  const size_t m_index;
+
+  // Every shard created for this histogram
+  mutable std::mutex m_lock;
+  std::vector<std::unique_ptr<shard>> m_shards;
+
+  /// <returns>The calling thread's shard, which is created if this thread has not recorded before</returns>
+  shard& local_shard(void);
+
+public:
+  /// <returns>The index of the bucket that records the specified value, in nanoseconds</returns>
+  static size_t bucket_index(uint64_t value);
+
+  /// <returns>The largest value that is recorded in the specified bucket</returns>
+  static uint64_t bucket_upper_bound(size_t index);
+
+  /// <summary>
+  /// Records a single sample
+  /// </summary>
+  void record(std::chrono::nanoseconds duration);
+
+  /// <summary>
+  /// Merges the samples recorded by all threads into a snapshot
+  /// </summary>
+  latency_snapshot snapshot(void) const;
+
+  /// <summary>
+  /// Discards all recorded samples
+  /// </summary>
+  /// <remarks>
+  /// Samples recorded concurrently with a call to reset may or may not be discarded
+  /// </remarks>
+  void reset(void);
+};
+
+}
@@ -0,0 +1,35 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include <cstddef>
+
+namespace autowiring {
+
+/// <summary>
+/// A read-only memory mapping of the entire contents of a file
+/// </summary>
+/// <remarks>
+/// The file is mapped at construction and unmapped at destruction.  No handle to the file is held
+/// while the mapping is alive.  An empty file produces an empty mapping with a null data pointer.
+/// </remarks>
+class mapped_file {
+public:
+  /// <summary>
+  /// Maps the specified file, throws autowiring_error if the file cannot be opened or mapped
+  /// </summary>
+  explicit mapped_file(const char* path);
+  mapped_file(const mapped_file&) = delete;
+  ~mapped_file(void);
+
+private:
+  const char* m_pData = nullptr;
+  size_t m_size = 0;
+
+public:
+  /// <returns>The mapped contents of the file</returns>
+  const char* data(void) const { return m_pData; }
+
+  /// <returns>The size of the file, in bytes</returns>
+  size_t size(void) const { return m_size; }
+};
+
+}
@@ -0,0 +1,40 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "mapped_file.h"
+#include "autowiring_error.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace autowiring;
+
+mapped_file::mapped_file(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    throw autowiring_error(std::string("Failed to open ") + path);
+
+  struct stat st;
+  if (fstat(fd, &st)) {
+    close(fd);
+    throw autowiring_error(std::string("Failed to obtain the size of ") + path);
+  }
+
+  m_size = (size_t)st.st_size;
+  if (m_size) {
+    void* pData = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pData == MAP_FAILED) {
+      close(fd);
+      throw autowiring_error(std::string("Failed to map ") + path);
+    }
+    m_pData = static_cast<const char*>(pData);
+  }
+
+  // The mapping holds its own reference to the file
+  close(fd);
+}
+
+mapped_file::~mapped_file(void) {
+  if (m_pData)
+    munmap(const_cast<char*>(m_pData), m_size);
+}
@@ -0,0 +1,40 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "mapped_file.h"
+#include "autowiring_error.h"
+#include <Windows.h>
+
+using namespace autowiring;
+
+mapped_file::mapped_file(const char* path) {
+  HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+    throw autowiring_error(std::string("Failed to open ") + path);
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(hFile, &size)) {
+    CloseHandle(hFile);
+    throw autowiring_error(std::string("Failed to obtain the size of ") + path);
+  }
+
+  m_size = (size_t)size.QuadPart;
+  if (m_size) {
+    HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* pData = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    // The view holds its own reference to the mapping and the file
+    if (hMapping)
+      CloseHandle(hMapping);
+    if (!pData) {
+      CloseHandle(hFile);
+      throw autowiring_error(std::string("Failed to map ") + path);
+    }
+    m_pData = static_cast<const char*>(pData);
+  }
+  CloseHandle(hFile);
+}
+
+mapped_file::~mapped_file(void) {
+  if (m_pData)
+    UnmapViewOfFile(m_pData);
+}
@@ -1,12 +1,13 @@
 // Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
 #pragma once
+#include "numeric_format.h"
 #include <atomic>
 #include <initializer_list>
-#include <cmath>
 #include <limits>
 #include <stdexcept>
 
 #include <string>
+#include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
 #include TYPE_TRAITS_HEADER
@@ -35,6 +36,30 @@ namespace autowiring {
     /// <param name="ptr">A pointer to the memory region where the output will be stored</param>
     virtual void unmarshal(void* ptr, const char* szValue) const = 0;
 
+    /// <summary>
+    /// Verifies that the specified string value can be converted to the output type
+    /// </summary>
+    /// <remarks>
+    /// Throws the same exception that unmarshal would throw for this value.  The default
+    /// implementation accepts every value.
+    /// </remarks>
+    virtual void validate(const char* szValue) const {}
+
+    /// <summary>
+    /// Converts the specified string value in the same way as unmarshal, but holds back any change
+    /// notification the output type raises until notify is called
+    /// </summary>
+    /// <remarks>
+    /// The ConfigManager uses this to assign every field of an object that is affected by a change
+    /// before any of those fields announces its new value.  The default implementation is unmarshal.
+    /// </remarks>
+    virtual void stage(void* ptr, const char* szValue) const { unmarshal(ptr, szValue); }
+
+    /// <summary>
+    /// Raises the change notification held back by a prior call to stage
+    /// </summary>
+    virtual void notify(void* ptr) const {}
+
     /// <summary>
     /// Copies the value on the right-hand side to the left-hand side without translation.
     /// </summary>
@@ -81,13 +106,20 @@ namespace autowiring {
       return *static_cast<const bool*>(ptr) ? "true" : "false";
     }
 
-    void unmarshal(void* ptr, const char* szValue) const override {
+    static bool parse(const char* szValue) {
       if (!strcmp("true", szValue))
-        *static_cast<bool*>(ptr) = true;
-      else if (!strcmp("false", szValue))
-        *static_cast<bool*>(ptr) = false;
-      else
-        throw std::invalid_argument("Boolean unmarshaller expects true or false keyword");
+        return true;
+      if (!strcmp("false", szValue))
+        return false;
+      throw std::invalid_argument("Boolean unmarshaller expects true or false keyword");
+    }
+
+    void unmarshal(void* ptr, const char* szValue) const override {
+      *static_cast<bool*>(ptr) = parse(szValue);
+    }
+
+    void validate(const char* szValue) const override {
+      parse(szValue);
     }
 
     void copy(void* lhs, const void* rhs) const override {
@@ -107,38 +139,31 @@ namespace autowiring {
     typedef typename std::remove_volatile<T>::type type;
 
     std::string marshal(const void* ptr) const override {
-      std::string retVal;
-      type val = *static_cast<const type*>(ptr);
-      if (val == 0)
-        return "0";
-
-      bool pos = 0 < val;
-      if (!pos)
-        val *= ~0;
-      for (; val; val /= 10) {
-        retVal.push_back(static_cast<char>(val % 10 + '0'));
-      }
-      if (!pos)
-        retVal.push_back('-');
-
-      for (
-        auto first = retVal.begin(), last = retVal.end();
-        (first != last) && (first != --last);
-        ++first
-        )
-        std::swap(*first, *last);
-      return retVal;
+      char buf[max_integer_chars];
+      return std::string(buf, format_integer(buf, *static_cast<const type*>(ptr)));
     }
 
-    void unmarshal(void* ptr, const char* szValue) const override {
-      type& value = *static_cast<type*>(ptr);
-      char* end = nullptr;
-      const auto llvalue = strtoll(szValue, &end, 10);
+    static type parse(const char* szValue) {
+      // Leading whitespace is permitted, as it always has been
+      while (isspace(static_cast<unsigned char>(*szValue)))
+        szValue++;
 
-      if (llvalue > std::numeric_limits<type>::max() || llvalue < std::numeric_limits<type>::min())
+      const char* szEnd = szValue + strlen(szValue);
+      type value;
+      parse_result result = parse_integer(szValue, szEnd, value);
+      if (result.ec == std::errc::result_out_of_range)
         throw std::range_error("Overflow error, value is outside the range representable by this type.");
+      if (result.ec != std::errc{} || result.ptr != szEnd)
+        throw std::invalid_argument(std::string("String value is not an integer: ") + szValue);
+      return value;
+    }
+
+    void unmarshal(void* ptr, const char* szValue) const override {
+      *static_cast<type*>(ptr) = parse(szValue);
+    }
 
-      value = static_cast<type>(llvalue);
+    void validate(const char* szValue) const override {
+      parse(szValue);
     }
 
     void copy(void* lhs, const void* rhs) const override {
@@ -153,98 +178,27 @@ namespace autowiring {
     typedef typename std::remove_volatile<T>::type type;
 
     std::string marshal(const void* ptr) const override {
-      std::string retVal;
-      type value = *static_cast<const type*>(ptr);
-      if (value == 0.0f)
-        return "0";
-
-      bool neg = value < 0.0f;
-      if (neg)
-        value *= -1.0f;
-
-      // Convert input value to scientific notation
-      int power = static_cast<int>(std::log10(value));
-
-      // We will be assembling the number backwards, need to keep track of the
-      // index of the current digit in the reassembled number.
-      int curDigit = std::numeric_limits<type>::digits10 - power;
-
-      // We only want a certain number of digits, this digit count will fit in
-      // a large integer and elimintes the loss of precision we experience when
-      // using floating point math to try to do digit shifts
-      uint64_t digits = static_cast<uint64_t>(value * std::pow(10.0, curDigit) + 0.5);
-
-      // Trailing zero introduction for integer multiples of 10
-      if (power > std::numeric_limits<type>::digits10)
-        retVal.append(power - std::numeric_limits<type>::digits10, '0');
-
-      // Trailing zero omission
-      while (0 < curDigit && 0 == (digits % 10)) {
-        digits /= 10;
-        curDigit--;
-      }
-
-      for(; digits; digits /= 10, curDigit--) {
-        char digit = static_cast<char>(digits % 10);
-
-        // String conversion step, straightforward mapping
-        retVal.push_back('0' + digit);
-        if (curDigit == 1)
-          retVal.push_back('.');
-
-        if (!digits)
-          // Short-circuit for precise representations
-          break;
-      }
-
-      // Zeroes before the decimal:
-      if (power < 0) {
-        retVal.append(-power, '0');
-        retVal.append(".0");
-      }
-
-      if (neg)
-        retVal.push_back('-');
-      for (
-        auto first = retVal.begin(), last = retVal.end();
-        (first != last) && (first != --last);
-        ++first
-      )
-        std::swap(*first, *last);
-      return retVal;
+      char buf[max_float_chars];
+      return std::string(buf, format_float(buf, *static_cast<const type*>(ptr)));
+    }
+
+    static type parse(const char* szValue) {
+      const char* szEnd = szValue + strlen(szValue);
+      type value;
+      parse_result result = parse_float(szValue, szEnd, value);
+      if (result.ec == std::errc::result_out_of_range)
+        throw std::range_error("Overflow error, value is outside the range representable by this type.");
+      if (result.ec != std::errc{} || result.ptr != szEnd)
+        throw std::invalid_argument(std::string("String value is not a decimal number: ") + szValue);
+      return value;
     }
 
     void unmarshal(void* ptr, const char* szValue) const override {
-      T& value = *static_cast<type*>(ptr);
-      bool negative = *szValue == '-';
-      if (negative)
-        szValue++;
+      *static_cast<type*>(ptr) = parse(szValue);
+    }
 
-      uint64_t whole = 0;
-      for (; *szValue; szValue++) {
-        // Detect the decimal marker, switch to fractional part
-        if (*szValue == '.') {
-          szValue++;
-          break;
-        }
-        if (*szValue < '0' || '9' < *szValue)
-          throw std::invalid_argument("String value is not a decimal number");
-        whole = whole * 10 + *szValue - '0';
-      }
-
-      uint64_t fractional = 0;
-      size_t n = 0;
-      for (; szValue[n]; n++) {
-        if (szValue[n] < '0' || '9' < szValue[n])
-          throw std::invalid_argument("String value is not a decimal number");
-        fractional = fractional * 10 + szValue[n] - '0';
-      }
-      value = static_cast<type>(fractional);
-      while(n--)
-        value /= 10.0f;
-      value += static_cast<type>(whole);
-      if (negative)
-        value *= -1.0f;
+    void validate(const char* szValue) const override {
+      parse(szValue);
     }
 
     void copy(void* lhs, const void* rhs) const override {
@@ -285,6 +239,10 @@ namespace autowiring {
       *static_cast<type*>(ptr) = std::move(value);
     }
 
+    void validate(const char* szValue) const override {
+      interior.validate(szValue);
+    }
+
     void copy(void* lhs, const void* rhs) const override {
       *static_cast<std::atomic<T>*>(lhs) = static_cast<const std::atomic<T>*>(rhs)->load();
     }
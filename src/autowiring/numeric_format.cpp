@@ -0,0 +1,601 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "numeric_format.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace autowiring;
+
+// Two-digit decimal strings for every value from 0 to 99, used to emit digits in pairs
+static const char sc_digitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static unsigned CountDigits(uint64_t value) {
+  unsigned n = 1;
+  for (;;) {
+    // Four orders of magnitude per iteration keeps the number of comparisons low
+    if (value < 10) return n;
+    if (value < 100) return n + 1;
+    if (value < 1000) return n + 2;
+    if (value < 10000) return n + 3;
+    value /= 10000;
+    n += 4;
+  }
+}
+
+char* autowiring::format_uint64(char* pBuf, uint64_t value) {
+  char* pEnd = pBuf + CountDigits(value);
+
+  // Digits are written back to front, two at a time
+  char* p = pEnd;
+  while (value >= 100) {
+    const char* pair = sc_digitPairs + (value % 100) * 2;
+    value /= 100;
+    *--p = pair[1];
+    *--p = pair[0];
+  }
+  if (value >= 10) {
+    const char* pair = sc_digitPairs + value * 2;
+    *--p = pair[1];
+    *--p = pair[0];
+  }
+  else
+    *--p = static_cast<char>('0' + value);
+  return pEnd;
+}
+
+namespace {
+  // Runtime conversions and limits for each floating point type
+  template<typename T>
+  struct float_traits;
+
+  template<>
+  struct float_traits<float> {
+    static const int max_exact_exp10 = 10;
+    static float from_string(const char* sz, char** pEnd) { return strtof(sz, pEnd); }
+    static int to_string(char* sz, size_t n, int precision, float value) { return snprintf(sz, n, "%.*e", precision, static_cast<double>(value)); }
+  };
+
+  template<>
+  struct float_traits<double> {
+    static const int max_exact_exp10 = 22;
+    static double from_string(const char* sz, char** pEnd) { return strtod(sz, pEnd); }
+    static int to_string(char* sz, size_t n, int precision, double value) { return snprintf(sz, n, "%.*e", precision, value); }
+  };
+
+  template<>
+  struct float_traits<long double> {
+    static const int max_exact_exp10 = 22;
+    static long double from_string(const char* sz, char** pEnd) { return strtold(sz, pEnd); }
+    static int to_string(char* sz, size_t n, int precision, long double value) { return snprintf(sz, n, "%.*Le", precision, value); }
+  };
+
+  // An unnormalized floating point value with a 64-bit significand, f * 2^e
+  struct diy_fp {
+    uint64_t f;
+    int e;
+
+    diy_fp operator-(const diy_fp& rhs) const { return{ f - rhs.f, e }; }
+
+    // Upper 64 bits of the 128-bit product, rounded
+    diy_fp operator*(const diy_fp& rhs) const {
+      const uint64_t a = f >> 32, b = f & 0xFFFFFFFF;
+      const uint64_t c = rhs.f >> 32, d = rhs.f & 0xFFFFFFFF;
+      const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+      uint64_t mid = (bd >> 32) + (ad & 0xFFFFFFFF) + (bc & 0xFFFFFFFF);
+      mid += 1ULL << 31;
+      return{ ac + (ad >> 32) + (bc >> 32) + (mid >> 32), e + rhs.e + 64 };
+    }
+
+    diy_fp normalize(void) const {
+      diy_fp retVal = *this;
+      while (!(retVal.f >> 63)) {
+        retVal.f <<= 1;
+        retVal.e--;
+      }
+      return retVal;
+    }
+  };
+
+  // The value to be formatted and its rounding boundaries, the boundaries share an exponent
+  struct boundaries {
+    diy_fp w;
+    diy_fp minus;
+    diy_fp plus;
+  };
+
+  template<typename T, typename Bits>
+  boundaries ComputeBoundaries(T value) {
+    static const int precision = std::numeric_limits<T>::digits;
+    static const int bias = std::numeric_limits<T>::max_exponent - 1 + (precision - 1);
+    static const uint64_t hiddenBit = 1ULL << (precision - 1);
+
+    Bits bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint64_t E = bits >> (precision - 1);
+    const uint64_t F = bits & (hiddenBit - 1);
+
+    const diy_fp v =
+      E ?
+      diy_fp{ F + hiddenBit, static_cast<int>(E) - bias } :
+      diy_fp{ F, 1 - bias };
+
+    // The lower boundary is closer if the significand is a power of two, except for the smallest
+    // normal value, whose predecessor is a denormal at the same spacing
+    const bool lowerCloser = !F && E > 1;
+    const diy_fp plus = diy_fp{ 2 * v.f + 1, v.e - 1 }.normalize();
+    diy_fp minus = lowerCloser ? diy_fp{ 4 * v.f - 1, v.e - 2 } : diy_fp{ 2 * v.f - 1, v.e - 1 };
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    return{ v.normalize(), minus, plus };
+  }
+
+  // Normalized approximations of 10^k for k = -300, -292, ..., 324
+  struct cached_power {
+    uint64_t f;
+    int e;
+  };
+
+  static const int sc_cachedPowersMinExp10 = -300;
+  static const int sc_cachedPowersStep = 8;
+  static const cached_power sc_cachedPowers[] = {
+  { 0xAB70FE17C79AC6CA, -1060 }, // 10^-300
+  { 0xFF77B1FCBEBCDC4F, -1034 }, // 10^-292
+  { 0xBE5691EF416BD60C, -1007 }, // 10^-284
+  { 0x8DD01FAD907FFC3C, -980 }, // 10^-276
+  { 0xD3515C2831559A83, -954 }, // 10^-268
+  { 0x9D71AC8FADA6C9B5, -927 }, // 10^-260
+  { 0xEA9C227723EE8BCB, -901 }, // 10^-252
+  { 0xAECC49914078536D, -874 }, // 10^-244
+  { 0x823C12795DB6CE57, -847 }, // 10^-236
+  { 0xC21094364DFB5637, -821 }, // 10^-228
+  { 0x9096EA6F3848984F, -794 }, // 10^-220
+  { 0xD77485CB25823AC7, -768 }, // 10^-212
+  { 0xA086CFCD97BF97F4, -741 }, // 10^-204
+  { 0xEF340A98172AACE5, -715 }, // 10^-196
+  { 0xB23867FB2A35B28E, -688 }, // 10^-188
+  { 0x84C8D4DFD2C63F3B, -661 }, // 10^-180
+  { 0xC5DD44271AD3CDBA, -635 }, // 10^-172
+  { 0x936B9FCEBB25C996, -608 }, // 10^-164
+  { 0xDBAC6C247D62A584, -582 }, // 10^-156
+  { 0xA3AB66580D5FDAF6, -555 }, // 10^-148
+  { 0xF3E2F893DEC3F126, -529 }, // 10^-140
+  { 0xB5B5ADA8AAFF80B8, -502 }, // 10^-132
+  { 0x87625F056C7C4A8B, -475 }, // 10^-124
+  { 0xC9BCFF6034C13053, -449 }, // 10^-116
+  { 0x964E858C91BA2655, -422 }, // 10^-108
+  { 0xDFF9772470297EBD, -396 }, // 10^-100
+  { 0xA6DFBD9FB8E5B88F, -369 }, // 10^-92
+  { 0xF8A95FCF88747D94, -343 }, // 10^-84
+  { 0xB94470938FA89BCF, -316 }, // 10^-76
+  { 0x8A08F0F8BF0F156B, -289 }, // 10^-68
+  { 0xCDB02555653131B6, -263 }, // 10^-60
+  { 0x993FE2C6D07B7FAC, -236 }, // 10^-52
+  { 0xE45C10C42A2B3B06, -210 }, // 10^-44
+  { 0xAA242499697392D3, -183 }, // 10^-36
+  { 0xFD87B5F28300CA0E, -157 }, // 10^-28
+  { 0xBCE5086492111AEB, -130 }, // 10^-20
+  { 0x8CBCCC096F5088CC, -103 }, // 10^-12
+  { 0xD1B71758E219652C, -77 }, // 10^-4
+  { 0x9C40000000000000, -50 }, // 10^4
+  { 0xE8D4A51000000000, -24 }, // 10^12
+  { 0xAD78EBC5AC620000, 3 }, // 10^20
+  { 0x813F3978F8940984, 30 }, // 10^28
+  { 0xC097CE7BC90715B3, 56 }, // 10^36
+  { 0x8F7E32CE7BEA5C70, 83 }, // 10^44
+  { 0xD5D238A4ABE98068, 109 }, // 10^52
+  { 0x9F4F2726179A2245, 136 }, // 10^60
+  { 0xED63A231D4C4FB27, 162 }, // 10^68
+  { 0xB0DE65388CC8ADA8, 189 }, // 10^76
+  { 0x83C7088E1AAB65DB, 216 }, // 10^84
+  { 0xC45D1DF942711D9A, 242 }, // 10^92
+  { 0x924D692CA61BE758, 269 }, // 10^100
+  { 0xDA01EE641A708DEA, 295 }, // 10^108
+  { 0xA26DA3999AEF774A, 322 }, // 10^116
+  { 0xF209787BB47D6B85, 348 }, // 10^124
+  { 0xB454E4A179DD1877, 375 }, // 10^132
+  { 0x865B86925B9BC5C2, 402 }, // 10^140
+  { 0xC83553C5C8965D3D, 428 }, // 10^148
+  { 0x952AB45CFA97A0B3, 455 }, // 10^156
+  { 0xDE469FBD99A05FE3, 481 }, // 10^164
+  { 0xA59BC234DB398C25, 508 }, // 10^172
+  { 0xF6C69A72A3989F5C, 534 }, // 10^180
+  { 0xB7DCBF5354E9BECE, 561 }, // 10^188
+  { 0x88FCF317F22241E2, 588 }, // 10^196
+  { 0xCC20CE9BD35C78A5, 614 }, // 10^204
+  { 0x98165AF37B2153DF, 641 }, // 10^212
+  { 0xE2A0B5DC971F303A, 667 }, // 10^220
+  { 0xA8D9D1535CE3B396, 694 }, // 10^228
+  { 0xFB9B7CD9A4A7443C, 720 }, // 10^236
+  { 0xBB764C4CA7A44410, 747 }, // 10^244
+  { 0x8BAB8EEFB6409C1A, 774 }, // 10^252
+  { 0xD01FEF10A657842C, 800 }, // 10^260
+  { 0x9B10A4E5E9913129, 827 }, // 10^268
+  { 0xE7109BFBA19C0C9D, 853 }, // 10^276
+  { 0xAC2820D9623BF429, 880 }, // 10^284
+  { 0x80444B5E7AA7CF85, 907 }, // 10^292
+  { 0xBF21E44003ACDD2D, 933 }, // 10^300
+  { 0x8E679C2F5E44FF8F, 960 }, // 10^308
+  { 0xD433179D9C8CB841, 986 }, // 10^316
+  { 0x9E19DB92B4E31BA9, 1013 }, // 10^324
+  };
+
+  // Target window for the binary exponent of the scaled value, [alpha, gamma]
+  static const int sc_alpha = -60;
+
+  // Obtains a cached power c = 10^k such that the product of c with a value with binary exponent e
+  // has a binary exponent in [alpha, gamma]
+  void GetCachedPower(int e, diy_fp& c, int& k) {
+    // ceil((alpha - e - 1) * log10(2)), computed with a fixed point approximation of log10(2)
+    const int f = sc_alpha - e - 1;
+    const int approx = (f * 78913) / (1 << 18) + (f > 0);
+    const int index = (-sc_cachedPowersMinExp10 + approx + (sc_cachedPowersStep - 1)) / sc_cachedPowersStep;
+    c = { sc_cachedPowers[index].f, sc_cachedPowers[index].e };
+    k = sc_cachedPowersMinExp10 + index * sc_cachedPowersStep;
+  }
+
+  // Moves the last generated digit closer to w while it stays within the unsafe interval, then
+  // verifies that the result is the shortest digit string closest to w despite the imprecision
+  // of the scaled values, which are only known to within unit
+  bool RoundWeed(char* digits, int len, uint64_t distTooHigh, uint64_t unsafe, uint64_t rest, uint64_t tenK, uint64_t unit) {
+    const uint64_t smallDist = distTooHigh - unit;
+    const uint64_t bigDist = distTooHigh + unit;
+    while (
+      rest < smallDist &&
+      unsafe - rest >= tenK &&
+      (rest + tenK < smallDist || smallDist - rest >= rest + tenK - smallDist)
+    ) {
+      digits[len - 1]--;
+      rest += tenK;
+    }
+
+    // If the digit could also have been moved toward the far end of w's uncertainty, we cannot
+    // tell which candidate is closer
+    if (
+      rest < bigDist &&
+      unsafe - rest >= tenK &&
+      (rest + tenK < bigDist || bigDist - rest > rest + tenK - bigDist)
+    )
+      return false;
+
+    // The candidate must lie within the safe interval
+    return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+  }
+
+  // Generates the digits of the shortest number in the interval (low, high), choosing the one
+  // closest to w.  Returns false if the imprecision of the inputs leaves the choice uncertain.
+  bool GenerateDigits(char* digits, int& len, int& exp10, diy_fp low, diy_fp w, diy_fp high) {
+    uint64_t unit = 1;
+    const diy_fp tooLow = { low.f - unit, low.e };
+    const diy_fp tooHigh = { high.f + unit, high.e };
+    uint64_t unsafe = (tooHigh - tooLow).f;
+
+    const int shift = -w.e;
+    const uint64_t one = 1ULL << shift;
+    uint32_t p1 = static_cast<uint32_t>(tooHigh.f >> shift);
+    uint64_t p2 = tooHigh.f & (one - 1);
+
+    // Integral part
+    uint32_t pow10 = 1;
+    int n = 1;
+    while (n < 10 && p1 >= pow10 * 10) {
+      pow10 *= 10;
+      n++;
+    }
+
+    for (; n > 0; pow10 /= 10) {
+      const uint32_t d = p1 / pow10;
+      p1 %= pow10;
+      digits[len++] = static_cast<char>('0' + d);
+      n--;
+
+      const uint64_t rest = (static_cast<uint64_t>(p1) << shift) + p2;
+      if (rest < unsafe) {
+        exp10 += n;
+        return RoundWeed(digits, len, (tooHigh - w).f, unsafe, rest, static_cast<uint64_t>(pow10) << shift, unit);
+      }
+    }
+
+    // Fractional part
+    int m = 0;
+    for (;;) {
+      p2 *= 10;
+      unit *= 10;
+      unsafe *= 10;
+      digits[len++] = static_cast<char>('0' + (p2 >> shift));
+      p2 &= one - 1;
+      m++;
+      if (p2 < unsafe) {
+        exp10 -= m;
+        return RoundWeed(digits, len, (tooHigh - w).f * unit, unsafe, p2, one, unit);
+      }
+    }
+  }
+
+  // Generates the shortest digit string for a finite positive value, value = digits * 10^exp10.
+  // Returns false for the small fraction of values where the result cannot be guaranteed.
+  template<typename T, typename Bits>
+  bool Grisu3(T value, char* digits, int& len, int& exp10) {
+    const boundaries b = ComputeBoundaries<T, Bits>(value);
+
+    diy_fp c;
+    int k;
+    GetCachedPower(b.plus.e, c, k);
+
+    len = 0;
+    exp10 = -k;
+    return GenerateDigits(digits, len, exp10, b.minus * c, b.w * c, b.plus * c);
+  }
+
+  // Generates the shortest digit string for a finite positive value by asking the runtime for
+  // successively more digits until they read back as the same value.  This is exact, but slow.
+  template<typename T>
+  void ShortestExact(T value, char* digits, int& len, int& exp10) {
+    char sz[64];
+    for (int precision = 1;; precision++) {
+      float_traits<T>::to_string(sz, sizeof(sz), precision - 1, value);
+      if (precision >= std::numeric_limits<T>::max_digits10 || float_traits<T>::from_string(sz, nullptr) == value)
+        break;
+    }
+
+    // The output has the form d.ddde+xx, the decimal point is skipped as it may be localized
+    const char* p = sz;
+    for (len = 0; *p != 'e'; p++)
+      if ('0' <= *p && *p <= '9')
+        digits[len++] = *p;
+    exp10 = atoi(p + 1) - (len - 1);
+
+    while (len > 1 && digits[len - 1] == '0') {
+      len--;
+      exp10++;
+    }
+  }
+
+  template<typename T, typename Bits>
+  void ShortestDigits(T value, char* digits, int& len, int& exp10) {
+    if (!Grisu3<T, Bits>(value, digits, len, exp10))
+      ShortestExact(value, digits, len, exp10);
+  }
+
+  // Lays out a digit string in positional or scientific notation
+  char* Layout(char* pBuf, const char* digits, int len, int exp10) {
+    // Position of the decimal point relative to the first digit
+    const int point = len + exp10;
+
+    if (0 < point && point <= 21) {
+      memcpy(pBuf, digits, len);
+      if (exp10 >= 0) {
+        // Integer, pad with zeroes
+        memset(pBuf + len, '0', exp10);
+        return pBuf + point;
+      }
+
+      memmove(pBuf + point + 1, pBuf + point, len - point);
+      pBuf[point] = '.';
+      return pBuf + len + 1;
+    }
+
+    if (-6 < point && point <= 0) {
+      // Leading zeroes after the decimal point
+      *pBuf++ = '0';
+      *pBuf++ = '.';
+      memset(pBuf, '0', -point);
+      memcpy(pBuf - point, digits, len);
+      return pBuf - point + len;
+    }
+
+    // Scientific notation, one digit before the decimal point
+    *pBuf++ = digits[0];
+    if (len > 1) {
+      *pBuf++ = '.';
+      memcpy(pBuf, digits + 1, len - 1);
+      pBuf += len - 1;
+    }
+    *pBuf++ = 'e';
+    *pBuf++ = point - 1 < 0 ? '-' : '+';
+    return format_uint64(pBuf, static_cast<uint64_t>(point - 1 < 0 ? 1 - point : point - 1));
+  }
+
+  template<typename T, void(*Shortest)(T, char*, int&, int&)>
+  char* FormatFloat(char* pBuf, T value) {
+    if (std::isnan(value)) {
+      memcpy(pBuf, "nan", 3);
+      return pBuf + 3;
+    }
+    if (std::signbit(value)) {
+      *pBuf++ = '-';
+      value = -value;
+    }
+    if (std::isinf(value)) {
+      memcpy(pBuf, "inf", 3);
+      return pBuf + 3;
+    }
+    if (value == 0) {
+      *pBuf = '0';
+      return pBuf + 1;
+    }
+
+    char digits[std::numeric_limits<long double>::max_digits10 + 1];
+    int len, exp10;
+    Shortest(value, digits, len, exp10);
+    return Layout(pBuf, digits, len, exp10);
+  }
+}
+
+char* autowiring::format_float(char* pBuf, float value) {
+  return FormatFloat<float, &ShortestDigits<float, uint32_t>>(pBuf, value);
+}
+
+char* autowiring::format_float(char* pBuf, double value) {
+  return FormatFloat<double, &ShortestDigits<double, uint64_t>>(pBuf, value);
+}
+
+char* autowiring::format_float(char* pBuf, long double value) {
+  // No fast path, extended precision formats vary too much between platforms
+  return FormatFloat<long double, &ShortestExact<long double>>(pBuf, value);
+}
+
+parse_result autowiring::parse_magnitude(const char* first, const char* last, uint64_t& magnitude, bool& negative) {
+  const char* p = first;
+  negative = p != last && *p == '-';
+  if (p != last && (*p == '-' || *p == '+'))
+    p++;
+
+  const char* pDigits = p;
+  uint64_t value = 0;
+  bool overflow = false;
+  for (; p != last && '0' <= *p && *p <= '9'; p++) {
+    const uint64_t d = static_cast<uint64_t>(*p - '0');
+    if (value > (std::numeric_limits<uint64_t>::max() - d) / 10)
+      overflow = true;
+    value = value * 10 + d;
+  }
+
+  if (p == pDigits)
+    return{ first, std::errc::invalid_argument };
+  if (overflow)
+    return{ p, std::errc::result_out_of_range };
+  magnitude = value;
+  return{ p, std::errc{} };
+}
+
+namespace {
+  // Case-insensitive match of a keyword at the start of [first, last)
+  bool MatchKeyword(const char* first, const char* last, const char* keyword) {
+    for (; *keyword; first++, keyword++)
+      if (first == last || (*first | 0x20) != *keyword)
+        return false;
+    return true;
+  }
+
+  // Powers of ten that are exactly representable in a double
+  static const double sc_exactPowers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  template<typename T>
+  parse_result ParseFloat(const char* first, const char* last, T& value) {
+    const char* p = first;
+    const bool negative = p != last && *p == '-';
+    if (p != last && (*p == '-' || *p == '+'))
+      p++;
+
+    if (MatchKeyword(p, last, "inf")) {
+      p += MatchKeyword(p, last, "infinity") ? 8 : 3;
+      value = negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+      return{ p, std::errc{} };
+    }
+    if (MatchKeyword(p, last, "nan")) {
+      value = std::numeric_limits<T>::quiet_NaN();
+      return{ p + 3, std::errc{} };
+    }
+
+    // Accumulate up to 19 significant digits, which always fit in 64 bits
+    uint64_t significand = 0;
+    int nSignificant = 0;
+    int exp10 = 0;
+    bool truncated = false;
+    bool anyDigits = false;
+    for (; p != last && '0' <= *p && *p <= '9'; p++) {
+      anyDigits = true;
+      if (nSignificant < 19) {
+        significand = significand * 10 + (*p - '0');
+        nSignificant += significand != 0;
+      }
+      else {
+        truncated |= *p != '0';
+        exp10++;
+      }
+    }
+    if (p != last && *p == '.') {
+      for (p++; p != last && '0' <= *p && *p <= '9'; p++) {
+        anyDigits = true;
+        if (nSignificant < 19) {
+          significand = significand * 10 + (*p - '0');
+          nSignificant += significand != 0;
+          exp10--;
+        }
+        else
+          truncated |= *p != '0';
+      }
+    }
+    if (!anyDigits)
+      return{ first, std::errc::invalid_argument };
+
+    // Optional exponent, only consumed if it is well-formed
+    if (p != last && (*p == 'e' || *p == 'E')) {
+      uint64_t exponent;
+      bool expNegative;
+      parse_result r = parse_magnitude(p + 1, last, exponent, expNegative);
+      if (r.ec != std::errc::invalid_argument) {
+        // Absurd exponents saturate, the runtime will report them as over- or underflow
+        if (r.ec == std::errc::result_out_of_range || exponent > 100000)
+          exponent = 100000;
+        exp10 += expNegative ? -static_cast<int>(exponent) : static_cast<int>(exponent);
+        p = r.ptr;
+      }
+    }
+
+    // Fast path: both the significand and the power of ten are exact in T, so a single correctly
+    // rounded operation yields the correctly rounded result
+    const uint64_t maxExact =
+      std::numeric_limits<T>::digits < 64 ?
+      1ULL << (std::numeric_limits<T>::digits % 64) :
+      ~0ULL;
+    if (!truncated && significand <= maxExact) {
+      T result = static_cast<T>(significand);
+      if (!significand)
+        exp10 = 0;
+      if (0 <= exp10 && exp10 <= float_traits<T>::max_exact_exp10) {
+        result *= static_cast<T>(sc_exactPowers[exp10]);
+        value = negative ? -result : result;
+        return{ p, std::errc{} };
+      }
+      if (-float_traits<T>::max_exact_exp10 <= exp10 && exp10 < 0) {
+        result /= static_cast<T>(sc_exactPowers[-exp10]);
+        value = negative ? -result : result;
+        return{ p, std::errc{} };
+      }
+    }
+
+    // Slow path, the runtime handles arbitrary precision.  The validated text is copied so that
+    // the runtime sees exactly what was consumed here.
+    const std::string text(first, p);
+    char* pEnd;
+    errno = 0;
+    const T result = float_traits<T>::from_string(text.c_str(), &pEnd);
+    if (pEnd != text.c_str() + text.size())
+      // Runtime disagrees with our grammar, probably because of a non-C locale
+      return{ first, std::errc::invalid_argument };
+    if (errno == ERANGE && std::isinf(result))
+      return{ p, std::errc::result_out_of_range };
+    value = result;
+    return{ p, std::errc{} };
+  }
+}
+
+parse_result autowiring::parse_float(const char* first, const char* last, float& value) {
+  return ParseFloat(first, last, value);
+}
+
+parse_result autowiring::parse_float(const char* first, const char* last, double& value) {
+  return ParseFloat(first, last, value);
+}
+
+parse_result autowiring::parse_float(const char* first, const char* last, long double& value) {
+  return ParseFloat(first, last, value);
+}
@@ -0,0 +1,126 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <system_error>
+#include TYPE_TRAITS_HEADER
+
+namespace autowiring {
+  /// <summary>
+  /// The outcome of a numeric parse
+  /// </summary>
+  struct parse_result {
+    // One past the last character that was consumed.  If no number was present, this is the
+    // first character of the input.
+    const char* ptr;
+
+    // std::errc{} on success, std::errc::invalid_argument if no number was present, and
+    // std::errc::result_out_of_range if the number does not fit in the destination type
+    std::errc ec;
+  };
+
+  // Buffer sizes sufficient to format any integer or floating point value, respectively
+  static const size_t max_integer_chars = 20;
+  static const size_t max_float_chars = 32;
+
+  /// <summary>
+  /// Writes the decimal representation of the specified value into pBuf
+  /// </summary>
+  /// <returns>One past the last character written, no null terminator is written</returns>
+  char* format_uint64(char* pBuf, uint64_t value);
+
+  /// <summary>
+  /// Writes the decimal representation of an integer into pBuf
+  /// </summary>
+  /// <remarks>
+  /// pBuf must have room for at least max_integer_chars characters.
+  /// </remarks>
+  /// <returns>One past the last character written, no null terminator is written</returns>
+  template<typename T>
+  char* format_integer(char* pBuf, T value) {
+    static_assert(std::is_integral<T>::value, "Only integral types may be formatted with format_integer");
+    if (std::is_signed<T>::value && value < static_cast<T>(0)) {
+      *pBuf++ = '-';
+
+      // Unsigned negation is well-defined for the minimum value of the signed type
+      return format_uint64(pBuf, 0 - static_cast<uint64_t>(static_cast<int64_t>(value)));
+    }
+    return format_uint64(pBuf, static_cast<uint64_t>(value));
+  }
+
+  /// <summary>
+  /// Writes the shortest decimal representation of value that parses back to exactly the same value
+  /// </summary>
+  /// <remarks>
+  /// Digits for float and double are generated with the Grisu3 algorithm.  The few values for which
+  /// Grisu3 cannot prove its result shortest, and all long double values, are converted by asking the
+  /// runtime for successively more digits until they read back as the same value.  Where there is more
+  /// than one shortest representation, the one closest to value is chosen.
+  ///
+  /// Values whose decimal exponent is between -6 and 20 inclusive are written in positional notation,
+  /// integers without a decimal point; all other values are written in scientific notation, such as
+  /// 1.5e+300.  Infinities are written as inf and -inf, and NaN as nan.  pBuf must have room for at
+  /// least max_float_chars characters.
+  /// </remarks>
+  /// <returns>One past the last character written, no null terminator is written</returns>
+  char* format_float(char* pBuf, float value);
+  char* format_float(char* pBuf, double value);
+  char* format_float(char* pBuf, long double value);
+
+  /// <summary>
+  /// Parses an optionally signed decimal magnitude
+  /// </summary>
+  /// <remarks>
+  /// Magnitudes that overflow 64 bits are consumed in their entirety and reported as out of range.
+  /// </remarks>
+  parse_result parse_magnitude(const char* first, const char* last, uint64_t& magnitude, bool& negative);
+
+  /// <summary>
+  /// Parses a decimal integer from [first, last)
+  /// </summary>
+  /// <remarks>
+  /// An optional leading sign is accepted, no whitespace is skipped.  Parsing stops at the first
+  /// character that is not a digit; callers that require the entire input to be consumed should
+  /// compare the returned pointer against last.  value is only modified on success.
+  /// </remarks>
+  template<typename T>
+  parse_result parse_integer(const char* first, const char* last, T& value) {
+    static_assert(std::is_integral<T>::value, "Only integral types may be parsed with parse_integer");
+
+    uint64_t magnitude;
+    bool negative;
+    parse_result retVal = parse_magnitude(first, last, magnitude, negative);
+    if (retVal.ec != std::errc{})
+      return retVal;
+
+    // Largest magnitude representable in the requested direction
+    const uint64_t limit =
+      !negative ?
+      static_cast<uint64_t>(std::numeric_limits<T>::max()) :
+      std::is_signed<T>::value ?
+      static_cast<uint64_t>(std::numeric_limits<T>::max()) + 1 :
+      0;
+    if (magnitude > limit)
+      retVal.ec = std::errc::result_out_of_range;
+    else if (negative && magnitude)
+      value = static_cast<T>(-static_cast<int64_t>(magnitude - 1) - 1);
+    else
+      value = static_cast<T>(magnitude);
+    return retVal;
+  }
+
+  /// <summary>
+  /// Parses a decimal floating point number from [first, last)
+  /// </summary>
+  /// <remarks>
+  /// Accepts an optional sign, digits with an optional fractional part, and an optional exponent, as
+  /// well as inf, infinity, and nan.  The result is correctly rounded.  Inputs whose significand and
+  /// power of ten are both exactly representable in the destination type are converted with a single
+  /// multiplication or division; all others are delegated to the C runtime.  Values too large for the
+  /// destination are reported as out of range.  value is only modified on success.
+  /// </remarks>
+  parse_result parse_float(const char* first, const char* last, float& value);
+  parse_result parse_float(const char* first, const char* last, double& value);
+  parse_result parse_float(const char* first, const char* last, long double& value);
+}
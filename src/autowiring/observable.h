@@ -94,6 +94,23 @@ struct marshaller<observable<T>> :
     *static_cast<type*>(ptr) = std::move(value);
   }
 
+  void validate(const char* szValue) const override {
+    interior.validate(szValue);
+  }
+
+  void stage(void* ptr, const char* szValue) const override {
+    T value;
+    interior.unmarshal(&value, szValue);
+
+    type& obs = *static_cast<type*>(ptr);
+    obs.onBeforeChanged(obs.get(), value);
+    obs.get() = std::move(value);
+  }
+
+  void notify(void* ptr) const override {
+    static_cast<type*>(ptr)->onChanged();
+  }
+
   void copy(void* lhs, const void* rhs) const override {
     *static_cast<observable<T>*>(lhs) = *static_cast<const observable<T>*>(rhs);
   }
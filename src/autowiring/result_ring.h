@@ -0,0 +1,250 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include "at_exit.h"
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include MEMORY_HEADER
+#include MUTEX_HEADER
+
+namespace autowiring {
+
+/// <summary>
+/// A bounded ring of result slots, used to collect the outputs of jobs
+/// </summary>
+/// <remarks>
+/// Producers reserve a ticket before a job is started; the ticket identifies the slot that will
+/// eventually receive the job's result.  At most capacity tickets may be outstanding at once, so
+/// reservation blocks once the consumer falls behind.  Results are stored by value in place and
+/// are consumed by exactly one consumer thread in slot order.  Slots are assigned either in
+/// ticket order, see fulfill, or in completion order, see fulfill_any.
+///
+/// Slot state transitions are lock-free.  The internal mutex is only taken when a producer or the
+/// consumer actually needs to park, and notifiers only take it when someone is known to be parked.
+/// </remarks>
+template<typename T>
+class result_ring {
+public:
+  explicit result_ring(size_t capacity) :
+    m_capacity(capacity ? capacity : 1),
+    m_slots(new slot[m_capacity])
+  {}
+
+  result_ring(const result_ring&) = delete;
+
+  ~result_ring(void) {
+    // Dispose of any results that were never consumed
+    for (size_t i = 0; i < m_capacity; i++)
+      if (m_slots[i].state.load(std::memory_order_acquire) == slot_state::ready)
+        m_slots[i].get().~T();
+  }
+
+private:
+  enum class slot_state : uint8_t {
+    empty,
+    ready,
+    failed
+  };
+
+  struct slot {
+    std::atomic<slot_state> state{ slot_state::empty };
+    typename std::aligned_storage<sizeof(T), AUTO_ALIGNOF(T)>::type storage;
+    std::exception_ptr ex;
+
+    T& get(void) { return *reinterpret_cast<T*>(&storage); }
+  };
+
+  const size_t m_capacity;
+  const std::unique_ptr<slot[]> m_slots;
+
+  // Tickets handed out and slots consumed, respectively:
+  std::atomic<uint64_t> m_reserved{ 0 };
+  std::atomic<uint64_t> m_consumed{ 0 };
+
+  // Slots claimed in completion order by fulfill_any:
+  std::atomic<uint64_t> m_claimed{ 0 };
+
+  // Number of threads currently parked, and the parking lot proper:
+  std::atomic<size_t> m_nWaiters{ 0 };
+  std::mutex m_lock;
+  std::condition_variable m_cv;
+
+  slot& slot_for(uint64_t ticket) { return m_slots[ticket % m_capacity]; }
+
+  /// <summary>
+  /// Parks the caller until the predicate is satisfied
+  /// </summary>
+  template<typename Pred>
+  void wait(Pred&& pred) {
+    if (pred())
+      return;
+
+    m_nWaiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+      std::unique_lock<std::mutex> lk(m_lock);
+      m_cv.wait(lk, pred);
+    }
+    m_nWaiters.fetch_sub(1);
+  }
+
+  /// <summary>
+  /// Wakes all parked threads, if there are any
+  /// </summary>
+  void notify(void) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_nWaiters.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lk(m_lock);
+      m_cv.notify_all();
+    }
+  }
+
+public:
+  /// <returns>The maximum number of tickets that may be outstanding at once</returns>
+  size_t capacity(void) const { return m_capacity; }
+
+  /// <returns>The number of tickets reserved but not yet consumed</returns>
+  size_t size(void) const { return (size_t)(m_reserved.load(std::memory_order_acquire) - m_consumed.load(std::memory_order_acquire)); }
+
+  /// <returns>True if there are no tickets outstanding</returns>
+  bool empty(void) const { return !size(); }
+
+  /// <summary>
+  /// Obtains a ticket without blocking
+  /// </summary>
+  /// <returns>False if the ring is at capacity</returns>
+  bool try_reserve(uint64_t& ticket) {
+    uint64_t reserved = m_reserved.load(std::memory_order_relaxed);
+    do {
+      if (reserved - m_consumed.load(std::memory_order_acquire) >= m_capacity)
+        return false;
+    } while (!m_reserved.compare_exchange_weak(reserved, reserved + 1, std::memory_order_acq_rel));
+    ticket = reserved;
+    return true;
+  }
+
+  /// <summary>
+  /// Obtains a ticket, blocking until the consumer has made room if the ring is at capacity
+  /// </summary>
+  uint64_t reserve(void) {
+    uint64_t ticket;
+    wait([&] { return try_reserve(ticket); });
+    return ticket;
+  }
+
+  /// <summary>
+  /// Stores the result for the specified ticket
+  /// </summary>
+  template<typename U>
+  void emplace(uint64_t ticket, U&& value) {
+    slot& s = slot_for(ticket);
+    new (&s.storage) T(std::forward<U>(value));
+    s.state.store(slot_state::ready, std::memory_order_release);
+    notify();
+  }
+
+  /// <summary>
+  /// Records that the job for the specified ticket threw an exception
+  /// </summary>
+  void fail(uint64_t ticket, std::exception_ptr ex) {
+    slot& s = slot_for(ticket);
+    s.ex = ex;
+    s.state.store(slot_state::failed, std::memory_order_release);
+    notify();
+  }
+
+  /// <summary>
+  /// Invokes fx and stores its result, or its exception, for the specified ticket
+  /// </summary>
+  template<typename Fx>
+  void fulfill(uint64_t ticket, Fx& fx) {
+    try { emplace(ticket, fx()); }
+    catch (...) { fail(ticket, std::current_exception()); }
+  }
+
+  /// <summary>
+  /// Invokes fx and stores its result, or its exception, in the next slot in completion order
+  /// </summary>
+  /// <remarks>
+  /// The caller must have reserved a ticket before fx was started, but the ticket itself is not
+  /// used; the slot is claimed only once fx has returned.  Exactly one slot is claimed per call,
+  /// and if moving the result into that slot throws, the exception is stored in the same slot.  A
+  /// ring must be filled either entirely with fulfill or entirely with fulfill_any.  Because the
+  /// number of reserved tickets never exceeds the capacity, a claimed slot is always free.
+  /// </remarks>
+  template<typename Fx>
+  void fulfill_any(Fx& fx) {
+    std::exception_ptr ex;
+    try {
+      T value(fx());
+      uint64_t ticket = m_claimed.fetch_add(1, std::memory_order_relaxed);
+      try { emplace(ticket, std::move(value)); }
+      catch (...) { fail(ticket, std::current_exception()); }
+      return;
+    }
+    catch (...) {
+      ex = std::current_exception();
+    }
+    fail(m_claimed.fetch_add(1, std::memory_order_relaxed), ex);
+  }
+
+  /// <summary>
+  /// Removes the result with the lowest outstanding ticket, blocking until it is available
+  /// </summary>
+  /// <remarks>
+  /// Only one thread may consume from a ring.  If the job that produced the result threw an
+  /// exception, that exception is rethrown here and the slot is consumed.
+  /// </remarks>
+  T pop(void) {
+    uint64_t ticket = m_consumed.load(std::memory_order_relaxed);
+    if (ticket == m_reserved.load(std::memory_order_acquire))
+      throw std::out_of_range("No outstanding jobs");
+
+    slot& s = slot_for(ticket);
+    wait([&] { return s.state.load(std::memory_order_acquire) != slot_state::empty; });
+    return consume(ticket, s);
+  }
+
+  /// <summary>
+  /// Removes the result with the lowest outstanding ticket if it is available
+  /// </summary>
+  /// <returns>False if the next result in order is not yet available</returns>
+  bool try_pop(T& value) {
+    uint64_t ticket = m_consumed.load(std::memory_order_relaxed);
+    if (ticket == m_reserved.load(std::memory_order_acquire))
+      return false;
+
+    slot& s = slot_for(ticket);
+    if (s.state.load(std::memory_order_acquire) == slot_state::empty)
+      return false;
+    value = consume(ticket, s);
+    return true;
+  }
+
+private:
+  T consume(uint64_t ticket, slot& s) {
+    std::exception_ptr ex;
+    if (s.state.load(std::memory_order_relaxed) == slot_state::failed) {
+      ex = std::move(s.ex);
+      s.ex = nullptr;
+    }
+
+    // Release the slot and advance the consumer sequence once the value has been moved out
+    auto release = MakeAtExit([&] {
+      s.state.store(slot_state::empty, std::memory_order_release);
+      m_consumed.store(ticket + 1, std::memory_order_release);
+      notify();
+    });
+
+    if (ex)
+      std::rethrow_exception(ex);
+
+    T retVal(std::move(s.get()));
+    s.get().~T();
+    return retVal;
+  }
+};
+
+}
@@ -0,0 +1,391 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include "Decompose.h"
+#include "index_tuple.h"
+#include "is_any.h"
+#include "is_shared_ptr.h"
+#include <tuple>
+#include TYPE_TRAITS_HEADER
+
+class AutoPacket;
+
+namespace autowiring {
+
+template<class... Filters>
+class static_pipeline;
+
+namespace detail {
+
+/// <summary>
+/// Classifies a single argument of an AutoFilter in a static pipeline
+/// </summary>
+/// <remarks>
+/// Only by-value and const reference inputs and by-reference outputs are supported.  Other argument
+/// forms rely on the packet's runtime machinery and are rejected.
+/// </remarks>
+template<class Arg>
+struct static_arg {
+  static_assert(
+    !std::is_pointer<Arg>::value && !is_shared_ptr<Arg>::value,
+    "static_pipeline AutoFilters may only take arguments of the form T, const T&, or T&"
+  );
+  typedef Arg id_type;
+  static const bool is_input = true;
+  static const bool is_output = false;
+};
+
+template<class T>
+struct static_arg<const T&> {
+  static_assert(!is_shared_ptr<T>::value, "static_pipeline AutoFilters may only take arguments of the form T, const T&, or T&");
+  typedef T id_type;
+  static const bool is_input = true;
+  static const bool is_output = false;
+};
+
+template<class T>
+struct static_arg<T&> {
+  static_assert(
+    !is_shared_ptr<T>::value && !std::is_same<T, AutoPacket>::value,
+    "static_pipeline AutoFilters may only take arguments of the form T, const T&, or T&"
+  );
+  typedef T id_type;
+  static const bool is_input = false;
+  static const bool is_output = true;
+};
+
+template<class T>
+struct static_arg<T&&> {
+  static_assert(!std::is_same<T, T>::value, "static_pipeline AutoFilters may not take rvalue arguments");
+};
+
+/// <summary>
+/// Concatenation of type packs
+/// </summary>
+template<class... Packs>
+struct pack_concat {
+  typedef TemplatePack<> type;
+};
+
+template<class... As>
+struct pack_concat<TemplatePack<As...>> {
+  typedef TemplatePack<As...> type;
+};
+
+template<class... As, class... Bs, class... Packs>
+struct pack_concat<TemplatePack<As...>, TemplatePack<Bs...>, Packs...>:
+  pack_concat<TemplatePack<As..., Bs...>, Packs...>
+{};
+
+/// <summary>
+/// Holds true if the pack contains T
+/// </summary>
+template<class Pack, class T>
+struct pack_contains;
+
+template<class... Ts, class T>
+struct pack_contains<TemplatePack<Ts...>, T>:
+  std::integral_constant<bool, is_any_same<T, Ts...>::value>
+{};
+
+/// <summary>
+/// Holds true if the pack contains every type in Needed
+/// </summary>
+template<class Pack, class Needed>
+struct pack_contains_all;
+
+template<class Pack, class... Needed>
+struct pack_contains_all<Pack, TemplatePack<Needed...>>:
+  std::integral_constant<bool, !is_any<!pack_contains<Pack, Needed>::value...>::value>
+{};
+
+/// <summary>
+/// The types in the pack that are not contained in Excluded, with duplicates removed
+/// </summary>
+template<class Pack, class Excluded, class Result = TemplatePack<>>
+struct pack_difference {
+  typedef Result type;
+};
+
+template<class T, class... Ts, class Excluded, class... Rs>
+struct pack_difference<TemplatePack<T, Ts...>, Excluded, TemplatePack<Rs...>>:
+  pack_difference<
+    TemplatePack<Ts...>,
+    Excluded,
+    typename std::conditional<
+      pack_contains<Excluded, T>::value || is_any_same<T, Rs...>::value,
+      TemplatePack<Rs...>,
+      TemplatePack<Rs..., T>
+    >::type
+  >
+{};
+
+/// <summary>
+/// The index of T in the pack, which must contain T
+/// </summary>
+template<class Pack, class T>
+struct pack_index;
+
+template<class T, class... Ts>
+struct pack_index<TemplatePack<T, Ts...>, T>:
+  std::integral_constant<int, 0>
+{};
+
+template<class U, class... Ts, class T>
+struct pack_index<TemplatePack<U, Ts...>, T>:
+  std::integral_constant<int, 1 + pack_index<TemplatePack<Ts...>, T>::value>
+{};
+
+/// <summary>
+/// The identities of the inputs, or of the outputs, of a single AutoFilter argument
+/// </summary>
+template<class Arg, bool output>
+struct static_arg_ids {
+  typedef typename std::conditional<
+    output ? static_arg<Arg>::is_output : static_arg<Arg>::is_input,
+    TemplatePack<typename static_arg<Arg>::id_type>,
+    TemplatePack<>
+  >::type type;
+};
+
+template<class FnType, bool output>
+struct static_filter_ids;
+
+template<class... Args, bool output>
+struct static_filter_ids<void(Args...), output>:
+  pack_concat<typename static_arg_ids<Args, output>::type...>
+{};
+
+/// <summary>
+/// Static description of a single AutoFilter in a static pipeline
+/// </summary>
+template<class Filter>
+struct static_filter {
+  typedef Decompose<decltype(&Filter::AutoFilter)> t_decompose;
+  static_assert(
+    std::is_void<typename t_decompose::retType>::value,
+    "static_pipeline AutoFilters must return void, Deferred AutoFilters cannot be called in line"
+  );
+
+  typedef typename t_decompose::fnType fnType;
+  typedef typename static_filter_ids<fnType, false>::type inputs;
+  typedef typename static_filter_ids<fnType, true>::type outputs;
+};
+
+/// <summary>
+/// Selects the first of the remaining filters whose inputs are all available
+/// </summary>
+/// <remarks>
+/// If no such filter exists, found is false and rest is empty, so that sorting terminates.
+/// </remarks>
+template<class Filters, class Available, class Skipped, class Remaining>
+struct pick_ready {
+  static const bool found = false;
+  static const int index = 0;
+  typedef index_tuple<> rest;
+};
+
+template<int I, class Rest>
+struct picked {
+  static const bool found = true;
+  static const int index = I;
+  typedef Rest rest;
+};
+
+template<class... Filters, class Available, int... Skipped, int I, int... Is>
+struct pick_ready<TemplatePack<Filters...>, Available, index_tuple<Skipped...>, index_tuple<I, Is...>>:
+  std::conditional<
+    pack_contains_all<
+      Available,
+      typename static_filter<typename std::tuple_element<I, std::tuple<Filters...>>::type>::inputs
+    >::value,
+    picked<I, index_tuple<Skipped..., Is...>>,
+    pick_ready<TemplatePack<Filters...>, Available, index_tuple<Skipped..., I>, index_tuple<Is...>>
+  >::type
+{};
+
+/// <summary>
+/// Orders filters so that each one is called after the filters producing its inputs
+/// </summary>
+/// <remarks>
+/// This is Kahn's algorithm, evaluated at compile time.  Filters whose dependencies are satisfied at
+/// the same time retain their declaration order.
+/// </remarks>
+template<class Filters, class Available, class Sorted, class Remaining>
+struct static_toposort {
+  typedef Sorted type;
+};
+
+template<class... Filters, class Available, int... Sorted, int I, int... Is>
+struct static_toposort<TemplatePack<Filters...>, Available, index_tuple<Sorted...>, index_tuple<I, Is...>> {
+  typedef pick_ready<TemplatePack<Filters...>, Available, index_tuple<>, index_tuple<I, Is...>> t_pick;
+  static_assert(t_pick::found, "static_pipeline AutoFilters contain a dependency cycle");
+
+  typedef typename static_toposort<
+    TemplatePack<Filters...>,
+    typename pack_concat<
+      Available,
+      typename static_filter<typename std::tuple_element<t_pick::index, std::tuple<Filters...>>::type>::outputs
+    >::type,
+    index_tuple<Sorted..., t_pick::index>,
+    typename t_pick::rest
+  >::type type;
+};
+
+template<class Derived, class Sources, class Outputs>
+class static_pipeline_base;
+
+/// <summary>
+/// Supplies the AutoFilter through which a static pipeline is attached to an AutoPacket
+/// </summary>
+/// <remarks>
+/// The pipeline's sources are its AutoFilter's inputs and the pipeline's products are its AutoFilter's
+/// outputs, so AutoFilters attached to the packet at runtime observe the products just as though each
+/// static filter had been attached individually.
+/// </remarks>
+template<class Derived, class... Sources, class... Outputs>
+class static_pipeline_base<Derived, TemplatePack<Sources...>, TemplatePack<Outputs...>> {
+public:
+  void AutoFilter(const Sources&... sources, Outputs&... outputs) {
+    std::tuple<const Sources&..., Outputs&...> decorations(sources..., outputs...);
+    static_cast<Derived*>(this)->Call(decorations);
+  }
+};
+
+template<class... Filters>
+struct static_pipeline_traits {
+  typedef TemplatePack<Filters...> filters;
+
+  // Every type produced by some filter, and every type consumed but not produced
+  typedef typename pack_concat<typename static_filter<Filters>::outputs...>::type outputs;
+  typedef typename pack_difference<
+    typename pack_concat<typename static_filter<Filters>::inputs...>::type,
+    outputs
+  >::type sources;
+
+  typedef typename static_toposort<
+    filters,
+    sources,
+    index_tuple<>,
+    typename make_index_tuple<sizeof...(Filters)>::type
+  >::type order;
+};
+
+template<class Sources, class Outputs>
+struct static_decorations;
+
+template<class... Sources, class... Outputs>
+struct static_decorations<TemplatePack<Sources...>, TemplatePack<Outputs...>> {
+  typedef TemplatePack<Sources..., Outputs...> ids;
+  typedef std::tuple<Sources..., Outputs...> type;
+};
+
+}
+
+/// <summary>
+/// A fixed pipeline of AutoFilters whose dependency graph is resolved entirely at compile time
+/// </summary>
+/// <remarks>
+/// Each filter type must have a single AutoFilter method returning void, whose arguments have the form
+/// T or const T& for inputs and T& for outputs.  Each decoration type may be produced by at most one
+/// filter.  Types that are consumed but never produced are the pipeline's sources.
+///
+/// Calling the pipeline invokes every filter once, in dependency order, as a straight-line sequence
+/// of calls on decorations held in a std::tuple; no saturation counters, decoration map, or locks are
+/// involved.  The pipeline is itself an AutoFilter taking its sources as inputs and its products as
+/// outputs, so it may be added to an AutoPacketFactory alongside dynamic AutoFilters which consume
+/// its products.
+/// </remarks>
+template<class... Filters>
+class static_pipeline:
+  public detail::static_pipeline_base<
+    static_pipeline<Filters...>,
+    typename detail::static_pipeline_traits<Filters...>::sources,
+    typename detail::static_pipeline_traits<Filters...>::outputs
+  >
+{
+public:
+  typedef detail::static_pipeline_traits<Filters...> t_traits;
+  typedef detail::static_decorations<typename t_traits::sources, typename t_traits::outputs> t_decorations;
+
+  static_assert(
+    !is_any_repeated<Filters...>::value,
+    "A filter type may appear in a static_pipeline at most once"
+  );
+  static_assert(
+    std::is_same<
+      typename detail::pack_difference<typename t_traits::outputs, TemplatePack<>>::type,
+      typename t_traits::outputs
+    >::value,
+    "Each decoration type may be produced by at most one filter in a static_pipeline"
+  );
+
+  /// <summary>
+  /// Decorations of the pipeline, sources first, then products in the order of declaration of the filters
+  /// </summary>
+  typedef typename t_decorations::type decorations;
+
+  /// <summary>
+  /// The order in which filters are called, as indices into Filters
+  /// </summary>
+  typedef typename t_traits::order order;
+
+  static_pipeline(void) = default;
+
+  template<class... Args>
+  explicit static_pipeline(Args&&... args) :
+    m_filters(std::forward<Args>(args)...)
+  {}
+
+private:
+  std::tuple<Filters...> m_filters;
+
+  template<class Filter, class Decorations, class... Args>
+  static void CallFilter(Filter& filter, Decorations& decorations, void (*)(Args...)) {
+    filter.AutoFilter(
+      std::get<detail::pack_index<typename t_decorations::ids, typename detail::static_arg<Args>::id_type>::value>(decorations)...
+    );
+  }
+
+  template<class Decorations, int... Is>
+  void CallAll(Decorations& decorations, index_tuple<Is...>) {
+    bool dummy[] = {
+      (
+        CallFilter(
+          std::get<Is>(m_filters),
+          decorations,
+          (typename detail::static_filter<typename std::tuple_element<Is, std::tuple<Filters...>>::type>::fnType*)nullptr
+        ),
+        false
+      )...,
+      false
+    };
+    (void)dummy;
+  }
+
+public:
+  /// <returns>The filter of type T held by this pipeline</returns>
+  template<class T>
+  T& get(void) {
+    return std::get<detail::pack_index<TemplatePack<Filters...>, T>::value>(m_filters);
+  }
+
+  /// <returns>The decoration of type T held in the specified decorations</returns>
+  template<class T>
+  static T& get(decorations& decs) {
+    return std::get<detail::pack_index<typename t_decorations::ids, T>::value>(decs);
+  }
+
+  /// <summary>
+  /// Invokes every filter in dependency order
+  /// </summary>
+  /// <param name="decorations">
+  /// A tuple of decorations, or of references to decorations, laid out as the decorations type.  Sources
+  /// must be assigned before the call; products are assigned by the filters that produce them.
+  /// </param>
+  template<class Decorations>
+  void Call(Decorations& decorations) {
+    CallAll(decorations, order{});
+  }
+};
+
+}
@@ -4,7 +4,11 @@
 #include <autowiring/config.h>
 #include <autowiring/ConfigRegistry.h>
 #include <autowiring/observable.h>
+#include <autowiring/at_exit.h>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <thread>
 
 namespace aw = autowiring;
 
@@ -96,6 +100,65 @@ TEST_F(AutoConfigTest, ConfigFieldAssign) {
   ASSERT_TRUE(x.is_dirty()) << "Config values are assumed to be initially dirty";
 }
 
+TEST_F(AutoConfigTest, ReadGuardOutlivesUpdate) {
+  autowiring::config<std::string> x{ "Hello world!" };
+  x.clear_dirty();
+
+  auto guard = x.read();
+  x.force_assign("Goodbye world!");
+  ASSERT_TRUE(x.clear_dirty());
+  ASSERT_STREQ("Goodbye world!", x->c_str()) << "Assigned value not made active by clear_dirty";
+  ASSERT_STREQ("Hello world!", guard->c_str()) << "Read guard did not retain the value it was constructed with";
+}
+
+TEST_F(AutoConfigTest, ReferenceOutlivesOnePublication) {
+  autowiring::config<std::string> x{ "Hello world!" };
+  x.clear_dirty();
+
+  const std::string& value = x;
+  x.force_assign("Goodbye world!");
+  ASSERT_TRUE(x.clear_dirty());
+  ASSERT_EQ("Goodbye world!", x.get()) << "Assigned value not made active by clear_dirty";
+  ASSERT_EQ("Hello world!", value) << "Reference to the prior value did not survive a publication";
+  ASSERT_EQ(&x.get(), &*x) << "Accessors did not refer to the active value in place";
+}
+
+TEST_F(AutoConfigTest, MovedFromIsValid) {
+  autowiring::config<std::string> x{ "Hello world!" };
+  autowiring::config<std::string> y{ std::move(x) };
+  ASSERT_EQ("Hello world!", *y) << "Value was not transferred by a move";
+  ASSERT_TRUE(x->empty()) << "Moved-from config did not hold a default value";
+}
+
+TEST_F(AutoConfigTest, ConcurrentReaders) {
+  autowiring::config<std::vector<int>> x{ std::vector<int>(64, 0) };
+  std::atomic<bool> done{ false };
+  std::atomic<bool> consistent{ true };
+
+  // Each published vector has every element equal, a torn read would show mixed values
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < 4; i++)
+    readers.emplace_back([&] {
+      while (!done) {
+        auto guard = x.read();
+        for (int v : *guard)
+          if (v != guard->front())
+            consistent = false;
+      }
+    });
+
+  for (int i = 1; i <= 1000; i++) {
+    x.force_assign(std::vector<int>(64, i));
+    x.clear_dirty();
+  }
+  done = true;
+  for (auto& t : readers)
+    t.join();
+
+  ASSERT_TRUE(consistent) << "A reader observed a partially updated value";
+  ASSERT_EQ(1000, x->front()) << "Final value was not published";
+}
+
 TEST_F(AutoConfigTest, ConfigFieldSetBad) {
   MyConfigurableClass c;
 
@@ -272,6 +335,255 @@ TEST_F(AutoConfigTest, SubContextDelayedPropagation) {
   ASSERT_EQ(mcc->b, 10442) << "Setting of the \'b\' config was not propogated to the sub context when it was injected after \'b\' was set.";
 }
 
+TEST_F(AutoConfigTest, InternedKey) {
+  AutoCurrentContext ctxt;
+  AutoRequired<MyConfigurableClass> mcc;
+
+  auto key = ctxt->Config.Intern("b");
+  ASSERT_TRUE(key) << "Interned key was not valid";
+  ASSERT_EQ("b", key.name());
+  ASSERT_EQ("929", ctxt->Config.Get(key)) << "Interned key did not report the default value";
+
+  ctxt->Config.Set(key, "10442");
+  ASSERT_EQ(10442, mcc->b) << "Value set through an interned key was not propagated to the backing field";
+  ASSERT_EQ("10442", ctxt->Config.Get("b")) << "Value set through an interned key not visible by name";
+}
+
+TEST_F(AutoConfigTest, InternedKeyInheritance) {
+  AutoCurrentContext ctxt;
+  AutoCreateContext subCtxt(ctxt);
+
+  auto key = subCtxt->Config.Intern("b");
+  ctxt->Config.Set("b", "1029");
+  ASSERT_EQ("1029", subCtxt->Config.Get(key)) << "Interned key in a child did not observe the parent's value";
+
+  subCtxt->Config.Set(key, "1030");
+  ctxt->Config.Set("b", "1031");
+  ASSERT_EQ("1030", subCtxt->Config.Get(key)) << "Override through an interned key was replaced by the parent's value";
+}
+
+TEST_F(AutoConfigTest, DeepInheritance) {
+  AutoCurrentContext ctxt;
+  AutoCreateContext mid(ctxt);
+  AutoCreateContext leaf(mid);
+
+  // Only the leaf has an attached field, the intermediate context merely reads through
+  AutoRequired<MyConfigurableClass> mcc{ leaf };
+  auto midKey = mid->Config.Intern("b");
+
+  ctxt->Config.Set("b", "1029");
+  ASSERT_EQ("1029", mid->Config.Get(midKey)) << "Intermediate context did not read through to the root";
+  ASSERT_EQ(1029, mcc->b) << "Leaf field not updated by a change at the root";
+
+  mid->Config.Set(midKey, "1030");
+  ASSERT_EQ(1030, mcc->b) << "Leaf field not updated by an override in an intermediate context";
+
+  ctxt->Config.Set("b", "1031");
+  ASSERT_EQ("1031", ctxt->Config.Get("b"));
+  ASSERT_EQ("1030", leaf->Config.Get("b")) << "Override in an intermediate context was replaced by the root's value";
+  ASSERT_EQ(1030, mcc->b) << "Leaf field was updated by a root change shadowed by an intermediate override";
+}
+
+TEST_F(AutoConfigTest, ClearRetainsInheritedValue) {
+  auto parent = std::make_shared<aw::ConfigManager>();
+  auto child = std::make_shared<aw::ConfigManager>(parent);
+  auto key = child->Intern("b");
+
+  parent->Set("b", "2");
+  ASSERT_EQ("2", child->Get(key));
+
+  child->Clear();
+  parent->Set("b", "3");
+  ASSERT_EQ("2", child->Get(key)) << "Detached manager did not retain its inherited value, or observed a change on its former parent";
+}
+
+TEST_F(AutoConfigTest, ConcurrentInheritedReads) {
+  auto root = std::make_shared<aw::ConfigManager>();
+  auto mid = std::make_shared<aw::ConfigManager>(root);
+  auto leaf = std::make_shared<aw::ConfigManager>(mid);
+  auto key = leaf->Intern("b");
+  root->Set("b", "0");
+
+  std::atomic<bool> proceed{ true };
+  std::thread writer([&] {
+    for (int i = 1; proceed; i++) {
+      root->Set("b", std::to_string(i));
+      root->Set("unrelated", std::to_string(i));
+    }
+  });
+  auto join = MakeAtExit([&] {
+    proceed = false;
+    writer.join();
+  });
+
+  // Values read through to an ancestor must never move backwards
+  int last = 0;
+  for (size_t i = 0; i < 10000; i++) {
+    int value = std::stoi(leaf->Get(key));
+    ASSERT_LE(last, value) << "Inherited value regressed while its ancestor was being updated";
+    last = value;
+  }
+}
+
+TEST_F(AutoConfigTest, Parse) {
+  const char text[] =
+    "# Comment line\n"
+    "a = Hello world\r\n"
+    "\n"
+    "  b=10442  \n"
+    "c=";
+  auto values = aw::ConfigManager::Parse(text, sizeof(text) - 1);
+  ASSERT_EQ(3UL, values.size()) << "Incorrect number of entries parsed";
+  ASSERT_EQ("a", values[0].first);
+  ASSERT_EQ("Hello world", values[0].second);
+  ASSERT_EQ("b", values[1].first);
+  ASSERT_EQ("10442", values[1].second);
+  ASSERT_EQ("c", values[2].first);
+  ASSERT_EQ("", values[2].second);
+
+  const char bad[] = "a=1\nnot a pair\n";
+  ASSERT_ANY_THROW(aw::ConfigManager::Parse(bad, sizeof(bad) - 1)) << "Malformed line was not rejected";
+}
+
+TEST_F(AutoConfigTest, Apply) {
+  AutoCurrentContext ctxt;
+  AutoCreateContext child(ctxt);
+  AutoRequired<MyConfigurableClass> mcc{ child };
+
+  size_t nChanged = 0;
+  mcc->obs.onChanged += [&] { nChanged++; };
+
+  ctxt->Config.Apply({
+    { "obs", "1" },
+    { "b", "1029" },
+    { "obs", "2" },
+    { "a", "second" }
+  });
+  ASSERT_EQ(1029, mcc->b) << "Bulk value not propagated to a child context";
+  ASSERT_EQ(2, *mcc->obs) << "Last value for a repeated key was not used";
+  ASSERT_EQ(1UL, nChanged) << "Listener was not notified exactly once for a repeated key";
+
+  auto keys = std::vector<aw::ConfigManager::Key>{ child->Config.Intern("a"), child->Config.Intern("b") };
+  auto values = child->Config.Get(keys);
+  ASSERT_EQ("second", values[0]);
+  ASSERT_EQ("1029", values[1]);
+}
+
+TEST_F(AutoConfigTest, ApplyIsAtomic) {
+  AutoCurrentContext ctxt;
+  std::vector<aw::ConfigManager::Key> keys;
+  for (size_t i = 0; i < 64; i++)
+    keys.push_back(ctxt->Config.Intern("atomic" + std::to_string(i)));
+
+  std::atomic<bool> proceed{ true };
+  std::thread writer([&] {
+    std::vector<std::pair<std::string, std::string>> values;
+    for (size_t gen = 0; proceed; gen++) {
+      values.clear();
+      for (size_t i = 0; i < keys.size(); i++)
+        values.emplace_back("atomic" + std::to_string(i), std::to_string(gen));
+      ctxt->Config.Apply(values);
+    }
+  });
+  auto join = MakeAtExit([&] {
+    proceed = false;
+    writer.join();
+  });
+
+  for (size_t i = 0; i < 1000; i++) {
+    auto values = ctxt->Config.Get(keys);
+    for (const auto& value : values)
+      ASSERT_EQ(values[0], value) << "Observed a partially applied configuration set";
+  }
+}
+
+TEST_F(AutoConfigTest, ApplyRejectsInvalidBatch) {
+  AutoCurrentContext ctxt;
+  AutoCreateContext child(ctxt);
+  AutoRequired<MyConfigurableClass> mcc{ child };
+
+  ctxt->Config.Apply({
+    { "a", "first" },
+    { "b", "1029" }
+  });
+
+  ASSERT_ANY_THROW(
+    ctxt->Config.Apply({
+      { "a", "second" },
+      { "b", "not an integer" }
+    })
+  ) << "A value that an inheriting field cannot unmarshal was not rejected";
+  mcc->a.clear_dirty();
+  ASSERT_EQ("first", *mcc->a) << "A rejected batch was partially applied";
+  ASSERT_EQ(1029, mcc->b) << "A rejected batch was partially applied";
+  ASSERT_EQ("first", ctxt->Config.Get("a")) << "A rejected batch was published to the parent";
+}
+
+namespace {
+  class PairedConfigurableClass {
+  public:
+    autowiring::observable<int> x{ 0 };
+    autowiring::observable<int> y{ 0 };
+
+    static autowiring::config_descriptor GetConfigDescriptor(void) {
+      return {
+        { "x", &PairedConfigurableClass::x },
+        { "y", &PairedConfigurableClass::y }
+      };
+    }
+  };
+}
+
+TEST_F(AutoConfigTest, ApplyUpdatesObjectAsGroup) {
+  AutoCurrentContext ctxt;
+  AutoCreateContext child(ctxt);
+  AutoRequired<PairedConfigurableClass> pcc{ child };
+
+  size_t nChanged = 0;
+  std::vector<std::pair<int, int>> observed;
+  auto record = [&] {
+    nChanged++;
+    observed.emplace_back(*pcc->x, *pcc->y);
+  };
+  pcc->x.onChanged += record;
+  pcc->y.onChanged += record;
+
+  ctxt->Config.Apply({
+    { "x", "1" },
+    { "y", "2" }
+  });
+  ASSERT_EQ(2UL, nChanged) << "Each changed field was not notified exactly once";
+  for (const auto& values : observed) {
+    ASSERT_EQ(1, values.first) << "A field was notified before the rest of the batch was assigned";
+    ASSERT_EQ(2, values.second) << "A field was notified before the rest of the batch was assigned";
+  }
+}
+
+TEST_F(AutoConfigTest, ApplyFile) {
+  const char* path = "AutoConfigTest_ApplyFile.cfg";
+  {
+    std::ofstream os(path);
+    os << "# Test file\n" << "b = 929292\n" << "a=From file\n";
+  }
+  auto rm = MakeAtExit([path] { std::remove(path); });
+
+  AutoCurrentContext ctxt;
+  AutoRequired<MyConfigurableClass> mcc;
+  ctxt->Config.ApplyFile(path);
+  ASSERT_EQ(929292, mcc->b) << "Value from file not applied";
+  ASSERT_EQ("From file", ctxt->Config.Get("a"));
+
+  ASSERT_ANY_THROW(ctxt->Config.ApplyFile("AutoConfigTest_Missing.cfg")) << "Missing file did not cause an exception";
+}
+
+TEST_F(AutoConfigTest, ManyKeys) {
+  AutoCurrentContext ctxt;
+  for (size_t i = 0; i < 1000; i++)
+    ctxt->Config.Set("key" + std::to_string(i), std::to_string(i));
+  for (size_t i = 0; i < 1000; i++)
+    ASSERT_EQ(std::to_string(i), ctxt->Config.Get("key" + std::to_string(i))) << "Value was lost after many insertions";
+}
+
 namespace {
   class slider
   {
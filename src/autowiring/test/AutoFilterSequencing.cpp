@@ -91,6 +91,15 @@ TEST_F(AutoFilterSequencing, PacketReverseSuccessor) {
   ASSERT_EQ(packet2, packet1->Successor()) << "Successor packet obtained after generation from the factory did not match as expected";
 }
 
+TEST_F(AutoFilterSequencing, IssuedPacketsNotRetained) {
+  AutoRequired<AutoPacketFactory> factory;
+  auto packet1 = factory->NewPacket();
+
+  std::weak_ptr<AutoPacket> packet2 = factory->NewPacket();
+  ASSERT_TRUE(packet2.expired()) << "An issued packet was kept alive by its predecessor";
+  ASSERT_EQ(nullptr, packet1->Successor()) << "A destroyed successor was returned";
+}
+
 TEST_F(AutoFilterSequencing, ManySuccessors) {
   AutoRequired<AutoPacketFactory> factory;
   {
@@ -274,6 +283,69 @@ TEST_F(AutoFilterSequencing, DoublePrev) {
   ASSERT_EQ(2, filter->m_num_empty_prev) << "Prev should only be null for the first two calls";
 }
 
+TEST_F(AutoFilterSequencing, PrevWaitsForPredecessor) {
+  AutoRequired<AutoPacketFactory> factory;
+  AutoRequired<PrevFilter> filter;
+
+  auto packet1 = factory->NewPacket();
+  auto packet2 = factory->NewPacket();
+
+  packet2->Decorate(2);
+  ASSERT_EQ(0, filter->m_called) << "Filter was called before its timeshifted input was available";
+
+  filter->m_prev_value = 1;
+  packet1->Decorate(1);
+  ASSERT_EQ(2, filter->m_called) << "Decorating a predecessor did not satisfy its successor's timeshifted input";
+  ASSERT_EQ(1, filter->m_num_empty_prev) << "Only the first packet should lack a prior value";
+}
+
+TEST_F(AutoFilterSequencing, DeepPrev) {
+  AutoRequired<AutoPacketFactory> factory;
+
+  int nCalled = 0;
+  int nEmpty = 0;
+  bool consistent = true;
+  *factory += [&](const int& current, auto_prev<int, 5> prev) {
+    nCalled++;
+    if (!prev)
+      nEmpty++;
+    else
+      consistent = consistent && *prev == current - 5;
+  };
+
+  for (int i = 0; i < 100; i++)
+    factory->NewPacket()->Decorate(i);
+
+  ASSERT_EQ(100, nCalled) << "Filter not called for every packet";
+  ASSERT_EQ(5, nEmpty) << "Only the first five packets should lack a prior value";
+  ASSERT_TRUE(consistent) << "A timeshifted input did not match the value decorated five packets earlier";
+}
+
+namespace {
+  struct CountedValue {
+    CountedValue(void) { nLive++; }
+    CountedValue(const CountedValue&) { nLive++; }
+    ~CountedValue(void) { nLive--; }
+    static int nLive;
+  };
+  int CountedValue::nLive = 0;
+}
+
+TEST_F(AutoFilterSequencing, RemovedPrevReleasesHistory) {
+  AutoRequired<AutoPacketFactory> factory;
+
+  auto reader = *factory += [](const CountedValue&, auto_prev<CountedValue, 3>) {};
+  for (int i = 0; i < 5; i++)
+    factory->NewPacket()->Decorate(CountedValue());
+  ASSERT_LT(0, CountedValue::nLive) << "History was not retained for a timeshifted reader";
+
+  // Without a timeshifted reader, packets must not keep earlier decorations alive
+  *factory -= reader;
+  for (int i = 0; i < 5; i++)
+    factory->NewPacket()->Decorate(CountedValue());
+  ASSERT_EQ(0, CountedValue::nLive) << "History was retained after the last timeshifted reader was removed";
+}
+
 class ConcurrentAutoPrev:
   public CoreThread
 {
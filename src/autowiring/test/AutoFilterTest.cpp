@@ -424,6 +424,37 @@ public:
   }
 };
 
+TEST_F(AutoFilterTest, ImmediateDirectAndGeneralSubscribers) {
+  AutoRequired<AutoPacketFactory> factory;
+
+  // Two filters waiting only on the immediate type, one of which produces an ordinary decoration
+  int direct = 0;
+  int downstream = 0;
+  *factory += [&direct](const Decoration<0>& dec, Decoration<1>& out) {
+    direct += dec.i;
+    out.i = dec.i + 1;
+  };
+  *factory += [&direct](const Decoration<0>& dec) { direct += dec.i; };
+  *factory += [&downstream](const Decoration<1>& dec) { downstream = dec.i; };
+
+  {
+    auto packet = factory->NewPacket();
+    packet->DecorateImmediate(Decoration<0>(5));
+    ASSERT_EQ(10, direct) << "Subscribers waiting only on an immediate decoration were not all invoked";
+    ASSERT_EQ(6, downstream) << "Output of an immediately satisfied filter did not propagate";
+    ASSERT_TRUE(packet->IsUnsatisfiable<Decoration<0>>()) << "Immediate decoration was still available after the call";
+  }
+
+  // A filter that also waits on another type cannot be called, its outputs must become unsatisfiable
+  *factory += [](const Decoration<0>&, const Decoration<2>&, Decoration<3>&) {};
+  {
+    auto packet = factory->NewPacket();
+    packet->DecorateImmediate(Decoration<0>(1));
+    ASSERT_EQ(12, direct) << "Subscribers were not invoked when another subscriber was not satisfied";
+    ASSERT_TRUE(packet->IsUnsatisfiable<Decoration<3>>()) << "Output of an unsatisfied subscriber was not marked unsatisfiable";
+  }
+}
+
 TEST_F(AutoFilterTest, NoImplicitDecorationCaching) {
   AutoRequired<AutoPacketFactory> factory;
   auto ptr = std::make_shared<int>(1012);
@@ -933,3 +964,109 @@ TEST_F(AutoFilterTest, AutoOut4) {
     ASSERT_EQ(1, d[DecorationKey(auto_id_t<int>(),0)].m_decorations.size()) << "Incorrect `int` decoration disposition.";
   }
 }
+
+class BatchedIntegerFilter:
+  public DispatchQueue
+{
+public:
+  std::vector<int> values;
+
+  DeferredBatch AutoFilter(const int& val, Decoration<0>& out) {
+    values.push_back(val);
+    out.i = val;
+    return DeferredBatch(this);
+  }
+};
+
+TEST_F(AutoFilterTest, DeferredBatchSingleDispatch) {
+  AutoRequired<AutoPacketFactory> factory;
+  AutoRequired<BatchedIntegerFilter> filter;
+
+  size_t nDownstream = 0;
+  *factory += [&nDownstream](const Decoration<0>&) { nDownstream++; };
+
+  for (int i = 0; i < 100; i++)
+    factory->NewPacket()->Decorate(i);
+
+  ASSERT_EQ(1UL, filter->GetDispatchQueueLength()) << "Batched deferred filter should have exactly one pending dispatcher";
+  ASSERT_EQ(100UL, factory->GetOutstandingPacketCount()) << "Batch inbox should be holding every packet";
+  ASSERT_EQ(1, filter->DispatchAllEvents()) << "Entire batch should be processed in one dispatch";
+
+  ASSERT_EQ(100UL, filter->values.size()) << "Filter was not invoked for every packet";
+  for (int i = 0; i < 100; i++)
+    ASSERT_EQ(i, filter->values[i]) << "Packets were not processed in the order they became ready";
+  ASSERT_EQ(100UL, nDownstream) << "Outputs of a batched filter were not attached";
+  ASSERT_EQ(0UL, factory->GetOutstandingPacketCount()) << "Packets were not released after their batch was processed";
+}
+
+class BatchRoutineFilter:
+  public DispatchQueue
+{
+public:
+  std::vector<size_t> batchSizes;
+
+  DeferredBatch AutoFilter(const int&) {
+    return DeferredBatch(this);
+  }
+
+  void AutoFilterBatch(const std::vector<std::shared_ptr<AutoPacket>>& packets) {
+    batchSizes.push_back(packets.size());
+    for (auto& packet : packets)
+      packet->Decorate(Decoration<1>(packet->Get<int>()));
+  }
+};
+
+TEST_F(AutoFilterTest, DeferredBatchRoutine) {
+  AutoRequired<AutoPacketFactory> factory;
+  AutoRequired<BatchRoutineFilter> filter;
+
+  int sum = 0;
+  *factory += [&sum](const Decoration<1>& dec) { sum += dec.i; };
+
+  for (int i = 1; i <= 10; i++)
+    factory->NewPacket()->Decorate(i);
+  filter->DispatchAllEvents();
+
+  for (int i = 11; i <= 15; i++)
+    factory->NewPacket()->Decorate(i);
+  filter->DispatchAllEvents();
+
+  ASSERT_EQ(2UL, filter->batchSizes.size()) << "Batch routine should have been invoked once per dispatch";
+  ASSERT_EQ(10UL, filter->batchSizes[0]) << "First batch did not contain every ready packet";
+  ASSERT_EQ(5UL, filter->batchSizes[1]) << "Second batch did not contain every ready packet";
+  ASSERT_EQ(120, sum) << "Decorations attached by the batch routine were not delivered";
+}
+
+class PartialBatchRoutineFilter:
+  public DispatchQueue
+{
+public:
+  DeferredBatch AutoFilter(const int&, auto_out<Decoration<2>>) {
+    return DeferredBatch(this);
+  }
+
+  void AutoFilterBatch(const std::vector<std::shared_ptr<AutoPacket>>& packets) {
+    // Only even packets are given an output
+    for (auto& packet : packets)
+      if (!(packet->Get<int>() % 2))
+        packet->Decorate(Decoration<2>());
+  }
+};
+
+TEST_F(AutoFilterTest, DeferredBatchRoutineConcludesOutputs) {
+  AutoRequired<AutoPacketFactory> factory;
+  AutoRequired<PartialBatchRoutineFilter> filter;
+
+  std::vector<std::shared_ptr<AutoPacket>> packets;
+  for (int i = 0; i < 4; i++) {
+    packets.push_back(factory->NewPacket());
+    packets.back()->Decorate(i);
+  }
+  filter->DispatchAllEvents();
+
+  for (int i = 0; i < 4; i++)
+    if (i % 2)
+      ASSERT_TRUE(packets[i]->IsUnsatisfiable<Decoration<2>>()) << "An output not attached by the batch routine was not marked unsatisfiable when it returned";
+    else
+      ASSERT_TRUE(packets[i]->Has<Decoration<2>>()) << "An output attached by the batch routine was lost";
+}
@@ -2,6 +2,7 @@
 #include "stdafx.h"
 #include <autowiring/CoreThread.h>
 #include CHRONO_HEADER
+#include FUTURE_HEADER
 #include THREAD_HEADER
 
 class AutoPacketFactoryTest:
@@ -252,3 +253,164 @@ TEST_F(AutoPacketFactoryTest, IsRunningWhilePacketIssued) {
   ctxt->SignalShutdown();
   ASSERT_TRUE(factory->IsRunning()) << "Factory should be considered to be running as long as packets are outstanding";
 }
+
+TEST_F(AutoPacketFactoryTest, LatencyHistograms) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<AutoPacketFactory> factory;
+  ASSERT_FALSE(factory->IsLatencyHistogramsEnabled()) << "Latency histograms should be disabled by default";
+
+  *factory += [](const int&) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  };
+  factory->EnableLatencyHistograms();
+
+  const size_t nPackets = 10;
+  for (size_t i = 0; i < nPackets; i++)
+    factory->NewPacket()->Decorate(1);
+
+  auto latencies = factory->GetFilterLatencies();
+  ASSERT_EQ(1UL, latencies.size()) << "Expected exactly one filter latency histogram";
+  const auto& filter = latencies[0].second;
+  ASSERT_EQ(nPackets, filter.count) << "Every filter call should have been recorded";
+  ASSERT_LE(std::chrono::milliseconds(1), filter.p50()) << "Median filter latency was shorter than the filter's sleep";
+  ASSERT_LE(filter.p50(), filter.p99()) << "Percentiles were not monotonic";
+  ASSERT_LE(filter.p99(), filter.p999()) << "Percentiles were not monotonic";
+
+  auto packet = factory->GetPacketLatency();
+  ASSERT_EQ(nPackets, packet.count) << "Every packet lifespan should have been recorded";
+  ASSERT_LE(filter.p50(), packet.p50()) << "Packets cannot have a shorter life than the filters invoked on them";
+
+  factory->EnableLatencyHistograms(false);
+  ASSERT_TRUE(factory->GetFilterLatencies().empty()) << "Disabling latency histograms should discard them";
+  ASSERT_EQ(0UL, factory->GetPacketLatency().count) << "Disabling latency histograms should discard packet lifespans";
+}
+
+namespace {
+  class SlowDeferredFilter:
+    public CoreThread
+  {
+  public:
+    SlowDeferredFilter(void) :
+      CoreThread("SlowDeferredFilter")
+    {}
+
+    Deferred AutoFilter(const int&) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      return Deferred(this);
+    }
+  };
+}
+
+TEST_F(AutoPacketFactoryTest, DeferredLatencyTimesCall) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<AutoPacketFactory> factory;
+  AutoRequired<SlowDeferredFilter> filter;
+  factory->EnableLatencyHistograms();
+
+  const size_t nPackets = 5;
+  for (size_t i = 0; i < nPackets; i++)
+    factory->NewPacket()->Decorate(1);
+
+  // Wait for the deferred calls to be made
+  auto called = std::make_shared<std::promise<void>>();
+  *filter += [called] { called->set_value(); };
+  ASSERT_EQ(std::future_status::ready, called->get_future().wait_for(std::chrono::seconds(5))) << "Deferred calls were not made in time";
+
+  auto latencies = factory->GetFilterLatencies();
+  ASSERT_EQ(1UL, latencies.size()) << "Expected exactly one filter latency histogram";
+  const auto& deferred = latencies[0].second;
+  ASSERT_EQ(nPackets, deferred.count) << "Every deferred call should have been recorded";
+  ASSERT_LE(std::chrono::milliseconds(2), deferred.p50()) << "Deferred latency did not include the time spent in the call";
+}
+
+TEST_F(AutoPacketFactoryTest, OutstandingLimitDropNewest) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<AutoPacketFactory> factory;
+  factory->SetOutstandingLimit(2, AdmissionPolicy::DropNewest);
+
+  auto packet1 = factory->NewPacket();
+  auto packet2 = factory->NewPacket();
+  ASSERT_NE(nullptr, packet2) << "Packet was refused before the outstanding limit was reached";
+  ASSERT_EQ(nullptr, factory->NewPacket()) << "Packet was issued in excess of the outstanding limit";
+  ASSERT_EQ(1UL, factory->GetRejectedPacketCount()) << "Refused packet was not counted";
+
+  packet1.reset();
+  ASSERT_NE(nullptr, factory->NewPacket()) << "Releasing a packet did not make room for another";
+  ASSERT_EQ(0UL, factory->GetAbandonedPacketCount()) << "No packets should be abandoned under the DropNewest policy";
+}
+
+TEST_F(AutoPacketFactoryTest, OutstandingLimitBlocks) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<AutoPacketFactory> factory;
+  factory->SetOutstandingLimit(1);
+
+  auto packet = factory->NewPacket();
+  auto next = std::async(
+    std::launch::async,
+    [&] { return factory->NewPacket(); }
+  );
+  ASSERT_EQ(std::future_status::timeout, next.wait_for(std::chrono::milliseconds(50))) << "Packet was issued in excess of the outstanding limit";
+
+  packet.reset();
+  ASSERT_EQ(std::future_status::ready, next.wait_for(std::chrono::seconds(5))) << "Blocked packet request was not admitted when a packet was released";
+  ASSERT_NE(nullptr, next.get()) << "Blocking request yielded an empty packet";
+  ASSERT_EQ(0UL, factory->GetRejectedPacketCount()) << "Blocking request was counted as rejected";
+}
+
+TEST_F(AutoPacketFactoryTest, OutstandingLimitTimedWait) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<AutoPacketFactory> factory;
+  factory->SetOutstandingLimit(1);
+
+  auto packet = factory->NewPacketFor(std::chrono::milliseconds(1));
+  ASSERT_NE(nullptr, packet) << "Timed request was refused before the outstanding limit was reached";
+  ASSERT_EQ(nullptr, factory->NewPacketFor(std::chrono::milliseconds(10))) << "Timed request was admitted in excess of the outstanding limit";
+  ASSERT_EQ(1UL, factory->GetRejectedPacketCount()) << "Timed out request was not counted";
+
+  factory->ResetPacketStatistics();
+  ASSERT_EQ(0UL, factory->GetRejectedPacketCount()) << "Rejected count was not reset with the packet statistics";
+}
+
+TEST_F(AutoPacketFactoryTest, OutstandingLimitDropOldest) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<AutoPacketFactory> factory;
+  factory->SetOutstandingLimit(1, AdmissionPolicy::DropOldest);
+
+  size_t nCalls = 0;
+  *factory += [&nCalls](const int&) { nCalls++; };
+
+  auto packet1 = factory->NewPacket();
+  auto packet2 = factory->NewPacket();
+  ASSERT_NE(nullptr, packet2) << "Packet was refused under the DropOldest policy";
+  ASSERT_TRUE(packet1->IsAbandoned()) << "Oldest packet was not abandoned to make room";
+  ASSERT_FALSE(packet2->IsAbandoned()) << "Newest packet was abandoned";
+  ASSERT_EQ(1UL, factory->GetAbandonedPacketCount()) << "Abandoned packet was not counted";
+
+  packet1->Decorate(1);
+  ASSERT_EQ(0UL, nCalls) << "AutoFilter was invoked on an abandoned packet";
+  packet2->Decorate(1);
+  ASSERT_EQ(1UL, nCalls) << "AutoFilter was not invoked on an admitted packet";
+
+  // Releasing the abandoned packet makes no room, the admitted packet still counts against the limit
+  packet1.reset();
+  auto packet3 = factory->NewPacket();
+  ASSERT_TRUE(packet2->IsAbandoned()) << "Admitted packet was not abandoned to make room for another";
+}
+
+TEST_F(AutoPacketFactoryTest, OutstandingLimitStopWakesWaiters) {
+  AutoCurrentContext ctxt;
+  ctxt->Initiate();
+  AutoRequired<AutoPacketFactory> factory;
+  factory->SetOutstandingLimit(1);
+
+  auto packet = factory->NewPacket();
+  auto next = std::async(
+    std::launch::async,
+    [&] { return factory->NewPacket(); }
+  );
+  ASSERT_EQ(std::future_status::timeout, next.wait_for(std::chrono::milliseconds(10))) << "Packet was issued in excess of the outstanding limit";
+
+  ctxt->SignalShutdown();
+  ASSERT_EQ(std::future_status::ready, next.wait_for(std::chrono::seconds(5))) << "Stopping the factory did not wake a blocked packet request";
+  ASSERT_THROW(next.get(), autowiring_error) << "Blocked packet request did not fail when the factory was stopped";
+}
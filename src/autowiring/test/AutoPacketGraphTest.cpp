@@ -0,0 +1,158 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "TestFixtures/Decoration.hpp"
+#include <autowiring/autowiring.h>
+#include <autowiring/AutoPacketGraph.h>
+
+using namespace autowiring;
+
+class AutoPacketGraphTest:
+  public testing::Test
+{
+public:
+  AutoPacketGraphTest(void) {
+    AutoCurrentContext()->Initiate();
+  }
+};
+
+namespace {
+  class GraphProducer {
+  public:
+    void AutoFilter(const Decoration<0>&, Decoration<1>& out) {
+      out.i = 1;
+    }
+  };
+
+  class GraphConsumer {
+  public:
+    size_t m_called = 0;
+
+    void AutoFilter(const Decoration<1>&) {
+      m_called++;
+    }
+  };
+
+  class GraphSilentProducer {
+  public:
+    void AutoFilter(const Decoration<0>&, auto_out<Decoration<2>>) {}
+  };
+
+  class GraphOptionalConsumer {
+  public:
+    size_t m_called = 0;
+
+    void AutoFilter(const Decoration<1>&, std::shared_ptr<const Decoration<2>>, auto_out<Decoration<3>>) {
+      m_called++;
+    }
+  };
+
+  class LateGraph:
+    public AutoPacketGraph
+  {
+  public:
+    LateGraph(void) :
+      AutoPacketGraph(DeliveryMode::Counting)
+    {}
+  };
+}
+
+TEST_F(AutoPacketGraphTest, CountingModeRecordsDeliveries) {
+  AutoCurrentContext ctxt;
+  AutoRequired<GraphProducer> producer;
+  AutoRequired<GraphConsumer> consumer;
+  auto graph = ctxt->Inject<AutoPacketGraph>(AutoPacketGraph::DeliveryMode::Counting);
+  ASSERT_EQ(AutoPacketGraph::DeliveryMode::Counting, graph->GetDeliveryMode()) << "Graph did not retain its delivery mode";
+
+  AutoRequired<AutoPacketFactory> factory;
+  const size_t nPackets = 5;
+  for (size_t i = 0; i < nPackets; i++)
+    factory->NewPacket()->Decorate(Decoration<0>());
+  ASSERT_EQ(nPackets, consumer->m_called) << "Consumer was not called once per packet";
+
+  AutoFilterDescriptor producerDesc(static_cast<const std::shared_ptr<GraphProducer>&>(producer));
+  AutoFilterDescriptor consumerDesc(static_cast<const std::shared_ptr<GraphConsumer>&>(consumer));
+  ASSERT_EQ(
+    nPackets,
+    graph->GetDeliveryCount({ auto_id_t<Decoration<0>>{}, producerDesc, DeliveryEdge::ArgType::Input })
+  ) << "Producer input deliveries were not counted";
+  ASSERT_EQ(
+    nPackets,
+    graph->GetDeliveryCount({ auto_id_t<Decoration<1>>{}, producerDesc, DeliveryEdge::ArgType::Output })
+  ) << "Producer output deliveries were not counted";
+  ASSERT_EQ(
+    nPackets,
+    graph->GetDeliveryCount({ auto_id_t<Decoration<1>>{}, consumerDesc, DeliveryEdge::ArgType::Input })
+  ) << "Consumer input deliveries were not counted";
+}
+
+TEST_F(AutoPacketGraphTest, CountingModeSkipsAbsentArguments) {
+  AutoCurrentContext ctxt;
+  AutoRequired<GraphProducer> producer;
+  AutoRequired<GraphSilentProducer> silent;
+  AutoRequired<GraphOptionalConsumer> consumer;
+  auto graph = ctxt->Inject<AutoPacketGraph>(AutoPacketGraph::DeliveryMode::Counting);
+
+  AutoRequired<AutoPacketFactory> factory;
+  const size_t nPackets = 4;
+  for (size_t i = 0; i < nPackets; i++)
+    factory->NewPacket()->Decorate(Decoration<0>());
+  ASSERT_EQ(nPackets, consumer->m_called) << "Consumer was not called once per packet";
+
+  AutoFilterDescriptor consumerDesc(static_cast<const std::shared_ptr<GraphOptionalConsumer>&>(consumer));
+  ASSERT_EQ(
+    nPackets,
+    graph->GetDeliveryCount({ auto_id_t<Decoration<1>>{}, consumerDesc, DeliveryEdge::ArgType::Input })
+  ) << "Required input deliveries were not counted";
+  ASSERT_EQ(
+    0UL,
+    graph->GetDeliveryCount({ auto_id_t<Decoration<2>>{}, consumerDesc, DeliveryEdge::ArgType::Input })
+  ) << "An optional input that was never decorated was counted as delivered";
+  ASSERT_EQ(
+    0UL,
+    graph->GetDeliveryCount({ auto_id_t<Decoration<3>>{}, consumerDesc, DeliveryEdge::ArgType::Output })
+  ) << "An output that was never produced was counted as delivered";
+}
+
+TEST_F(AutoPacketGraphTest, CountingModeGraphsCountIndependently) {
+  AutoCurrentContext ctxt;
+  AutoRequired<GraphProducer> producer;
+  AutoRequired<GraphConsumer> consumer;
+  AutoRequired<AutoPacketFactory> factory;
+  auto graph = ctxt->Inject<AutoPacketGraph>(AutoPacketGraph::DeliveryMode::Counting);
+  factory->NewPacket()->Decorate(Decoration<0>());
+
+  AutoFilterDescriptor consumerDesc(static_cast<const std::shared_ptr<GraphConsumer>&>(consumer));
+  const DeliveryEdge edge{ auto_id_t<Decoration<1>>{}, consumerDesc, DeliveryEdge::ArgType::Input };
+
+  AutoRequired<LateGraph> late;
+  ASSERT_EQ(0UL, late->GetDeliveryCount(edge)) << "A graph counted deliveries made before it was created";
+  factory->NewPacket()->Decorate(Decoration<0>());
+  ASSERT_EQ(1UL, late->GetDeliveryCount(edge)) << "Second graph did not count deliveries";
+  ASSERT_EQ(2UL, graph->GetDeliveryCount(edge)) << "First graph did not count deliveries";
+
+  // Releasing some other subscription must not stop the graphs from counting
+  auto subscription = factory->SubscribeDeliveries(consumerDesc);
+  ASSERT_TRUE(subscription != nullptr) << "Could not subscribe to the deliveries of a registered filter";
+  subscription->nDeliverySubscribers--;
+  factory->NewPacket()->Decorate(Decoration<0>());
+  ASSERT_EQ(3UL, graph->GetDeliveryCount(edge)) << "Releasing another subscription stopped a graph from counting deliveries";
+}
+
+TEST_F(AutoPacketGraphTest, TeardownModeRecordsDeliveries) {
+  AutoCurrentContext ctxt;
+  AutoRequired<GraphProducer> producer;
+  AutoRequired<GraphConsumer> consumer;
+  AutoRequired<AutoPacketGraph> graph;
+  ASSERT_EQ(AutoPacketGraph::DeliveryMode::Teardown, graph->GetDeliveryMode()) << "Graph should default to teardown mode";
+
+  AutoRequired<AutoPacketFactory> factory;
+  const size_t nPackets = 3;
+  for (size_t i = 0; i < nPackets; i++)
+    factory->NewPacket()->Decorate(Decoration<0>());
+
+  AutoFilterDescriptor consumerDesc(static_cast<const std::shared_ptr<GraphConsumer>&>(consumer));
+  ASSERT_EQ(
+    nPackets,
+    graph->GetDeliveryCount({ auto_id_t<Decoration<1>>{}, consumerDesc, DeliveryEdge::ArgType::Input })
+  ) << "Consumer input deliveries were not counted on packet teardown";
+}
@@ -4,6 +4,8 @@
 #include <autowiring/BasicThread.h>
 #include <autowiring/CoreThread.h>
 #include <autowiring/thread_specific_ptr.h>
+#include <atomic>
+#include <vector>
 #include THREAD_HEADER
 
 class AutowiringUtilitiesTest:
@@ -51,3 +53,49 @@ TEST_F(AutowiringUtilitiesTest, ThreadSpecificPtr) {
  
   FAIL() << "Thread specific pointer did not increment to the destination value in a timely fashion";
 }
+
+namespace {
+  std::atomic<int> s_nCleanups{0};
+}
+
+TEST_F(AutowiringUtilitiesTest, ThreadSpecificPtrCleanup) {
+  autowiring::thread_specific_ptr<int> tsp([](void* ptr) {
+    if (ptr)
+      s_nCleanups++;
+    delete static_cast<int*>(ptr);
+  });
+
+  s_nCleanups = 0;
+  std::thread([&tsp] {
+    tsp.reset(new int(1));
+    ASSERT_EQ(1, *tsp) << "Value was not visible to the thread that set it";
+  }).join();
+  ASSERT_EQ(1, s_nCleanups) << "Cleanup function was not called when the thread exited";
+  ASSERT_EQ(nullptr, tsp.get()) << "Value set by another thread was visible on this thread";
+
+  // Released values are not cleaned up
+  std::thread([&tsp] {
+    tsp.reset(new int(2));
+    delete tsp.release();
+  }).join();
+  ASSERT_EQ(1, s_nCleanups) << "Cleanup function was called for a released value";
+}
+
+TEST_F(AutowiringUtilitiesTest, ThreadSpecificPtrMany) {
+  // More instances than there are fast slots, later instances must fall back transparently
+  std::vector<std::unique_ptr<autowiring::thread_specific_ptr<int>>> tsps;
+  for (int i = 0; i < 100; i++) {
+    tsps.emplace_back(new autowiring::thread_specific_ptr<int>);
+    tsps.back()->reset(new int(i));
+  }
+
+  std::thread([&tsps] {
+    for (auto& tsp : tsps) {
+      ASSERT_EQ(nullptr, tsp->get()) << "Value was visible on a thread that did not set it";
+      tsp->reset(new int(-1));
+    }
+  }).join();
+
+  for (int i = 0; i < 100; i++)
+    ASSERT_EQ(i, *tsps[i]->get()) << "Value was overwritten by another thread or another instance";
+}
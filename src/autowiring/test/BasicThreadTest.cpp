@@ -1,6 +1,8 @@
 // Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
 #include "stdafx.h"
 #include <autowiring/BasicThread.h>
+#include <autowiring/CoreThread.h>
+#include <vector>
 #include FUTURE_HEADER
 
 using namespace std::chrono;
@@ -75,3 +77,115 @@ TEST_F(BasicThreadTest, IsMainThread) {
   );
   ASSERT_FALSE(secondaryIsMain.get()) << "Secondary thread incorrectly identified as the main thread";
 }
+
+namespace {
+  template<int N>
+  class AffinityThread:
+    public CoreThread
+  {};
+}
+
+TEST_F(BasicThreadTest, ExclusiveCoreIsReserved) {
+  auto available = BasicThread::GetAvailableCores();
+  ASSERT_FALSE(available.empty()) << "No available cores were reported";
+
+  AutoRequired<AffinityThread<0>> first;
+  AutoRequired<AffinityThread<1>> second;
+  ASSERT_TRUE(first->SetExclusiveCore(available[0])) << "Failed to reserve an unreserved core";
+  ASSERT_EQ(std::vector<int>{available[0]}, first->GetAffinity()) << "Exclusive core was not reflected in the thread's affinity";
+  ASSERT_FALSE(second->SetExclusiveCore(available[0])) << "A core was reserved by two threads at once";
+
+  first->ClearAffinity();
+  ASSERT_TRUE(first->GetAffinity().empty()) << "Affinity was not cleared";
+  ASSERT_TRUE(second->SetExclusiveCore(available[0])) << "Clearing affinity did not release the core reservation";
+}
+
+TEST_F(BasicThreadTest, SpreadPolicyAssignsCores) {
+  auto available = BasicThread::GetAvailableCores();
+  AutoCurrentContext()->Initiate();
+
+  AutoCreateContext ctxt;
+  ctxt->SetThreadAffinityPolicy(ThreadAffinityPolicy::Spread);
+  CurrentContextPusher pshr(ctxt);
+
+  // Threads in a child context are placed by the policy they inherit
+  AutoCreateContext child;
+  AutoRequired<AffinityThread<0>> first(child);
+  AutoRequired<AffinityThread<1>> second(child);
+
+  // An explicit request takes precedence over the policy
+  AutoRequired<AffinityThread<2>> pinned(child);
+  pinned->SetAffinity(available);
+
+  ctxt->Initiate();
+  child->Initiate();
+  ASSERT_TRUE(first->Barrier(std::chrono::seconds(5)));
+  ASSERT_TRUE(second->Barrier(std::chrono::seconds(5)));
+  ASSERT_TRUE(pinned->Barrier(std::chrono::seconds(5)));
+
+  auto firstCores = first->GetAffinity();
+  auto secondCores = second->GetAffinity();
+  ASSERT_EQ(1UL, firstCores.size()) << "Spread policy did not pin a thread to a single core";
+  ASSERT_EQ(1UL, secondCores.size()) << "Spread policy did not pin a thread to a single core";
+  if (available.size() > 1)
+    ASSERT_NE(firstCores, secondCores) << "Spread policy placed two threads on the same core";
+  ASSERT_EQ(available, pinned->GetAffinity()) << "Spread policy overrode an explicit affinity request";
+
+  ctxt->SignalShutdown(true);
+}
+
+TEST_F(BasicThreadTest, AffinityToMemory) {
+  std::vector<char> buffer(4096, 1);
+  std::vector<int> cores;
+  if (!BasicThread::GetCoresForMemory(buffer.data(), cores))
+    // NUMA information is not available on this system
+    return;
+  ASSERT_FALSE(cores.empty()) << "Node of a buffer was found, but reported no cores";
+
+  AutoRequired<AffinityThread<0>> thread;
+  ASSERT_TRUE(thread->SetAffinityToMemory(buffer.data())) << "Failed to set affinity from a buffer's node";
+  ASSERT_EQ(cores, thread->GetAffinity()) << "Thread affinity does not match the buffer's node";
+}
+
+TEST_F(BasicThreadTest, SchedulingFallsBackGracefully) {
+  AutoCurrentContext()->Initiate();
+
+  // Realtime scheduling may or may not be permitted here, but the request must never fail outright
+  ThreadScheduling realtime;
+  realtime.policy = SchedulingPolicy::RoundRobin;
+  realtime.realtimePriority = 1;
+  realtime.stackPrefault = 64 * 1024;
+
+  AutoRequired<AffinityThread<0>> rr;
+  rr->SetScheduling(realtime);
+  ASSERT_EQ(SchedulingPolicy::RoundRobin, rr->GetScheduling().policy) << "Requested policy was not recorded";
+
+  // An impossible deadline reservation must fall back rather than fail
+  ThreadScheduling deadline;
+  deadline.policy = SchedulingPolicy::Deadline;
+  deadline.runtime = std::chrono::milliseconds(2);
+  deadline.period = std::chrono::milliseconds(1);
+
+  AutoRequired<AffinityThread<1>> dl;
+  dl->SetScheduling(deadline);
+
+  AutoRequired<AffinityThread<2>> defaulted;
+
+  bool ran = false;
+  *rr += [&ran] { ran = true; };
+  ASSERT_TRUE(rr->Barrier(std::chrono::seconds(5))) << "Thread did not run after a realtime scheduling request";
+  ASSERT_TRUE(ran) << "Thread did not run after a realtime scheduling request";
+  ASSERT_TRUE(dl->Barrier(std::chrono::seconds(5))) << "Thread did not run after an invalid deadline request";
+  ASSERT_TRUE(defaulted->Barrier(std::chrono::seconds(5)));
+
+  auto rrPolicy = rr->GetEffectiveSchedulingPolicy();
+  ASSERT_TRUE(rrPolicy == SchedulingPolicy::RoundRobin || rrPolicy == SchedulingPolicy::Default) << "Unexpected fallback policy";
+  ASSERT_NE(SchedulingPolicy::Deadline, dl->GetEffectiveSchedulingPolicy()) << "An invalid deadline reservation was reported as granted";
+  ASSERT_EQ(SchedulingPolicy::Default, defaulted->GetEffectiveSchedulingPolicy()) << "A thread was given a policy it did not request";
+  ASSERT_FALSE(rr->IsMemoryLocked()) << "Memory was reported locked without being requested";
+
+  // Going back to the default policy from the thread itself takes effect right away
+  *rr += [&rr] { rr->SetScheduling(ThreadScheduling{}); };
+  ASSERT_TRUE(rr->Barrier(std::chrono::seconds(5)));
+  ASSERT_EQ(SchedulingPolicy::Default, rr->GetEffectiveSchedulingPolicy()) << "Thread did not return to the default policy";
+}
@@ -1,7 +1,10 @@
 // Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
 #include "stdafx.h"
 #include <autowiring/CoreJob.h>
+#include FUTURE_HEADER
 #include THREAD_HEADER
+#include <set>
+#include <vector>
 
 class CoreJobTest:
   public testing::Test
@@ -179,3 +182,74 @@ TEST_F(CoreJobTest, RecursiveDeadlock) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   };
 }
+
+TEST_F(CoreJobTest, ReusesPoolThreads) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<CoreJob> job;
+
+  // Many short bursts, each run to completion before the next is pended
+  std::set<std::thread::id> threads;
+  std::vector<int> order;
+  for (int i = 0; i < 20; i++) {
+    *job += [&threads, &order, i] {
+      threads.insert(std::this_thread::get_id());
+      order.push_back(i);
+    };
+    ASSERT_TRUE(job->Barrier(std::chrono::seconds(5))) << "Burst " << i << " was not run";
+  }
+
+  for (int i = 0; i < 20; i++)
+    ASSERT_EQ(i, order[i]) << "Bursts were run out of order";
+  ASSERT_GT(20UL, threads.size()) << "Each burst was run on a new thread, pool threads were not reused";
+}
+
+TEST_F(CoreJobTest, BudgetedRunsRequeue) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<CoreJob> job;
+  job->SetDispatchBudget(4);
+
+  // Hold the first run until everything is pended, so that no run can drain the whole queue
+  auto gate = std::make_shared<std::promise<void>>();
+  std::shared_future<void> opened = gate->get_future();
+  *job += [opened] { opened.wait(); };
+
+  std::vector<int> order;
+  for (int i = 0; i < 20; i++)
+    *job += [&order, i] { order.push_back(i); };
+  gate->set_value();
+  ASSERT_TRUE(job->Barrier(std::chrono::seconds(5))) << "Budgeted job did not run all of its events";
+
+  ASSERT_EQ(20UL, order.size()) << "Not all events were run";
+  for (int i = 0; i < 20; i++)
+    ASSERT_EQ(i, order[i]) << "Events were run out of order across budgeted runs";
+  ASSERT_LT(0UL, job->GetDispatchQueueStats().nBudgetExhausted) << "No run exhausted its budget";
+}
+
+TEST_F(CoreJobTest, ConcurrentPendsRunSerially) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<CoreJob> job;
+
+  // Producers pend to an idle job at the same time, events must never overlap
+  std::atomic<int> running{0};
+  std::atomic<bool> overlapped{false};
+  std::atomic<int> nRun{0};
+  for (int round = 0; round < 100; round++) {
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 4; i++)
+      producers.emplace_back([&] {
+        *job += [&] {
+          if (running++)
+            overlapped = true;
+          std::this_thread::yield();
+          running--;
+          nRun++;
+        };
+      });
+    for (auto& producer : producers)
+      producer.join();
+    ASSERT_TRUE(job->Barrier(std::chrono::seconds(5))) << "Events were not run in round " << round;
+  }
+
+  ASSERT_FALSE(overlapped) << "Events pended to one job were run concurrently";
+  ASSERT_EQ(400, nRun) << "Not all events were run";
+}
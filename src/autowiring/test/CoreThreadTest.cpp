@@ -3,7 +3,10 @@
 #include "TestFixtures/SimpleThreaded.hpp"
 #include <autowiring/at_exit.h>
 #include <autowiring/autowiring.h>
+#include <autowiring/ContextTelemetry.h>
 #include <algorithm>
+#include <vector>
+#include FUTURE_HEADER
 #include THREAD_HEADER
 
 class CoreThreadTest:
@@ -654,3 +657,58 @@ TEST_F(CoreThreadTest, CanElevateAnyPriority) {
     ASSERT_EQ((ThreadPriority)i, ct->GetThreadPriority());
   }
 }
+
+TEST_F(CoreThreadTest, SpinThenParkDeliversAllEvents) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<CoreThread> ct;
+  ct->SetWaitPolicy(ThreadWaitPolicy::SpinThenPark, std::chrono::microseconds(200));
+  ASSERT_EQ(ThreadWaitPolicy::SpinThenPark, ct->GetWaitPolicy()) << "Wait policy was not updated";
+
+  // Closely spaced events should be picked up while the thread spins
+  std::vector<int> order;
+  for (int i = 0; i < 100; i++) {
+    *ct += [&order, i] { order.push_back(i); };
+    if (i % 10 == 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+  ASSERT_TRUE(ct->Barrier(std::chrono::seconds(5))) << "Closely spaced events were not all delivered";
+
+  // An event arriving well after the spin interval must still wake the parked thread
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  *ct += [&order] { order.push_back(100); };
+  ASSERT_TRUE(ct->Barrier(std::chrono::seconds(5))) << "Parked thread was not woken by a new event";
+
+  ASSERT_EQ(101UL, order.size()) << "Not all events were delivered";
+  for (int i = 0; i < 101; i++)
+    ASSERT_EQ(i, order[i]) << "Events were delivered out of order";
+}
+
+TEST_F(CoreThreadTest, ContextTelemetrySnapshot) {
+  AutoCurrentContext()->Initiate();
+  AutoCreateContext child;
+  child->Initiate();
+  auto thread = child->Inject<CoreThread>();
+
+  // Keep the thread busy for a little while so that it accrues CPU time
+  auto p = std::make_shared<std::promise<void>>();
+  *thread += [p] {
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+    while (std::chrono::steady_clock::now() < end);
+    p->set_value();
+  };
+  ASSERT_EQ(std::future_status::ready, p->get_future().wait_for(std::chrono::seconds(5))) << "Thread did not run its dispatcher";
+
+  auto telemetry = autowiring::GetContextTelemetry(AutoCurrentContext());
+  auto entry = std::find_if(
+    telemetry.begin(),
+    telemetry.end(),
+    [&](const autowiring::RunnableTelemetry& entry) { return entry.context == child; }
+  );
+  ASSERT_NE(telemetry.end(), entry) << "Runnable in a child context was not included in the snapshot";
+  ASSERT_TRUE(entry->isThread) << "CoreThread was not reported as a thread";
+  ASSERT_TRUE(entry->isDispatchQueue) << "CoreThread was not reported as a dispatch queue";
+  ASSERT_TRUE(entry->thread.running) << "Running thread was reported as stopped";
+  ASSERT_EQ(1UL, entry->queue.nDispatched) << "Dispatched event was not counted";
+  ASSERT_LE(std::chrono::milliseconds(10), entry->thread.kernelTime + entry->thread.userTime) << "Thread's CPU time was not reported";
+  ASSERT_LE(entry->thread.kernelTime + entry->thread.userTime, entry->thread.wallTime) << "Thread reported more CPU time than wall time";
+}
@@ -0,0 +1,112 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include <autowiring/coroutine.h>
+#include <autowiring/CoreThread.h>
+#include "TestFixtures/Decoration.hpp"
+#include FUTURE_HEADER
+#include THREAD_HEADER
+
+// Built as C++20 by the AutowiringCoroutineTest target, see CMakeLists.txt
+#if AUTOWIRING_HAS_COROUTINES
+
+using namespace autowiring;
+
+class CoroutineTest:
+  public testing::Test
+{
+public:
+  CoroutineTest(void) {
+    AutoCurrentContext()->Initiate();
+  }
+};
+
+namespace {
+  detached_task AwaitDecoration(AutoPacket& packet, int& value, bool& threw) {
+    try {
+      value = (co_await packet.Await<Decoration<0>>()).i;
+    }
+    catch (autowiring_error&) {
+      threw = true;
+    }
+  }
+
+  detached_task ResumeOn(DispatchQueue& queue, std::thread::id& resumedOn) {
+    co_await queue.schedule();
+    resumedOn = std::this_thread::get_id();
+  }
+
+  struct SetOnDestroy {
+    bool& destroyed;
+    ~SetOnDestroy(void) { destroyed = true; }
+  };
+
+  detached_task ResumeOnAborted(DispatchQueue& queue, bool& destroyed, bool& resumed) {
+    SetOnDestroy sod{ destroyed };
+    co_await queue.schedule();
+    resumed = true;
+  }
+}
+
+TEST_F(CoroutineTest, AwaitDecoration) {
+  AutoRequired<AutoPacketFactory> factory;
+  auto packet = factory->NewPacket();
+
+  int value = 0;
+  bool threw = false;
+  AwaitDecoration(*packet, value, threw);
+  ASSERT_EQ(0, value) << "Coroutine resumed before the decoration was attached";
+
+  packet->Decorate(Decoration<0>(55));
+  ASSERT_EQ(55, value) << "Coroutine was not resumed with the attached decoration";
+
+  // Awaiting a decoration that is already present must not suspend
+  value = 0;
+  AwaitDecoration(*packet, value, threw);
+  ASSERT_EQ(55, value) << "Coroutine did not complete when the decoration was already present";
+  ASSERT_FALSE(threw) << "Awaiting a present decoration threw an exception";
+}
+
+TEST_F(CoroutineTest, AwaitUnsatisfiable) {
+  AutoRequired<AutoPacketFactory> factory;
+  auto packet = factory->NewPacket();
+
+  int value = 0;
+  bool threw = false;
+  AwaitDecoration(*packet, value, threw);
+  packet->MarkUnsatisfiable<Decoration<0>>();
+  ASSERT_TRUE(threw) << "Awaiting an unsatisfiable decoration did not throw";
+}
+
+TEST_F(CoroutineTest, ScheduleOnThread) {
+  AutoRequired<CoreThread> thread;
+
+  std::thread::id resumedOn;
+  ResumeOn(*thread, resumedOn);
+
+  // Runs after the coroutine, and records the identity of the thread for comparison
+  std::thread::id threadId;
+  auto barrier = std::make_shared<std::promise<void>>();
+  *thread += [barrier, &threadId] {
+    threadId = std::this_thread::get_id();
+    barrier->set_value();
+  };
+  ASSERT_EQ(
+    std::future_status::ready,
+    barrier->get_future().wait_for(std::chrono::seconds(5))
+  ) << "Thread did not run the pended coroutine";
+  ASSERT_EQ(threadId, resumedOn) << "Coroutine was not resumed on the scheduled thread";
+}
+
+TEST_F(CoroutineTest, AbortDestroysCoroutine) {
+  DispatchQueue dq;
+  bool destroyed = false;
+  bool resumed = false;
+  ResumeOnAborted(dq, destroyed, resumed);
+  ASSERT_FALSE(destroyed) << "Coroutine was destroyed before its queue was aborted";
+
+  dq.Abort();
+  ASSERT_TRUE(destroyed) << "Coroutine frame was leaked when its queue was aborted";
+  ASSERT_FALSE(resumed) << "Coroutine was resumed by an aborted queue";
+}
+
+#endif
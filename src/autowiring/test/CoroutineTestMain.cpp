@@ -0,0 +1,7 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include <autotesting/gtest-all-guard.hpp>
+
+int main(int argc, const char* argv []) {
+  return autotesting_main(argc, argv);
+}
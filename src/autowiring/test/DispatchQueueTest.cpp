@@ -359,3 +359,169 @@ TEST_F(DispatchQueueTest, Rundown) {
   ASSERT_FALSE(*notCalled) << "Dispatcher was incorrectly invoked during rundown";
   ASSERT_TRUE(notCalled.unique()) << "Rejected dispatcher was leaked";
 }
+
+namespace {
+  class CountedBatchItem:
+    public autowiring::DispatchBatchItem
+  {
+  public:
+    CountedBatchItem(const void* key, std::vector<int>& sizes, std::shared_ptr<int> live) :
+      DispatchBatchItem(key, &Process),
+      sizes(sizes),
+      live(live)
+    {}
+
+    std::vector<int>& sizes;
+    std::shared_ptr<int> live;
+
+    static void Process(const void*, autowiring::DispatchBatchItem* const* ppItems, size_t nItems) {
+      static_cast<CountedBatchItem*>(ppItems[0])->sizes.push_back((int)nItems);
+    }
+  };
+}
+
+TEST_F(DispatchQueueTest, PendBatchGroupsByKey) {
+  std::vector<int> sizes;
+  auto live = std::make_shared<int>(0);
+  int keyA, keyB;
+
+  for (int i = 0; i < 6; i++)
+    ASSERT_TRUE(PendBatch(new CountedBatchItem(i % 3 ? &keyA : &keyB, sizes, live))) << "Failed to pend a batch item";
+  ASSERT_EQ(1UL, GetDispatchQueueLength()) << "Batch items should share a single dispatcher";
+
+  DispatchAllEvents();
+  ASSERT_EQ(2UL, sizes.size()) << "Expected one batch per key";
+  ASSERT_EQ(2, sizes[0]) << "Group of the first pended item should be processed first";
+  ASSERT_EQ(4, sizes[1]) << "Second group was not processed in full";
+  ASSERT_TRUE(live.unique()) << "Batch items were not destroyed after processing";
+}
+
+TEST_F(DispatchQueueTest, PendBatchAfterAbort) {
+  std::vector<int> sizes;
+  auto live = std::make_shared<int>(0);
+  int key;
+
+  ASSERT_TRUE(PendBatch(new CountedBatchItem(&key, sizes, live)));
+  Abort();
+  ASSERT_TRUE(live.unique()) << "Pending batch items were not discarded on abort";
+  ASSERT_FALSE(PendBatch(new CountedBatchItem(&key, sizes, live))) << "Batch item was accepted by an aborted queue";
+  ASSERT_TRUE(live.unique()) << "Rejected batch item was not destroyed";
+  ASSERT_TRUE(sizes.empty()) << "No batch should have been processed";
+}
+
+TEST_F(DispatchQueueTest, PendBatchWhenFull) {
+  std::vector<int> sizes;
+  auto live = std::make_shared<int>(0);
+  int key;
+
+  SetDispatcherCap(autowiring::DispatchPriority::Normal, 0);
+  ASSERT_FALSE(PendBatch(new CountedBatchItem(&key, sizes, live))) << "Batch item was accepted by a full queue";
+  ASSERT_TRUE(live.unique()) << "Rejected batch item was not destroyed";
+
+  SetDispatcherCap(autowiring::DispatchPriority::Normal, 1024);
+  ASSERT_TRUE(PendBatch(new CountedBatchItem(&key, sizes, live))) << "Inbox was not usable after a rejected item";
+  DispatchAllEvents();
+  ASSERT_EQ(1UL, sizes.size()) << "Batch was not processed";
+  ASSERT_EQ(1, sizes[0]) << "Rejected batch item was processed";
+}
+
+TEST_F(DispatchQueueTest, TelemetryCounters) {
+  SetDispatcherCap(100);
+  size_t nPended = 0;
+  for (size_t i = 0; i < 150; i++)
+    if (*this += [] {})
+      nPended++;
+  ASSERT_EQ(100UL, nPended) << "Dispatch cap was not enforced";
+
+  auto stats = GetDispatchQueueStats();
+  ASSERT_EQ(100UL, stats.nPended) << "Accepted dispatchers were not counted";
+  ASSERT_EQ(50UL, stats.nRejected) << "Dispatchers refused at the cap were not counted";
+  ASSERT_EQ(100UL, stats.maxDepth) << "Maximum depth did not reach the cap";
+  ASSERT_EQ(100UL, stats.dispatchCap) << "Dispatch cap was not reported";
+
+  DispatchAllEvents();
+  stats = GetDispatchQueueStats();
+  ASSERT_EQ(100UL, stats.nDispatched) << "Dispatched events were not counted";
+  ASSERT_EQ(0UL, stats.depth) << "Queue depth was not zero after all events were dispatched";
+  ASSERT_EQ(100UL, stats.maxDepth) << "Maximum depth should persist after the queue drains";
+  ASSERT_EQ((100 + c_latencySampleInterval - 1) / c_latencySampleInterval, stats.nLatencySamples) << "Unexpected number of latency samples";
+  ASSERT_LE(stats.MeanLatency(), stats.maxLatency) << "Mean latency exceeded maximum latency";
+}
+
+TEST_F(DispatchQueueTest, PriorityLanes) {
+  std::vector<int> order;
+  *this += [&] { order.push_back(2); };
+  *this += autowiring::DispatchPriority::Low, [&] { order.push_back(3); };
+  *this += autowiring::DispatchPriority::High, [&] { order.push_back(0); };
+  *this += autowiring::DispatchPriority::High, [&] { order.push_back(1); };
+
+  // A delayed dispatcher, once ready, waits in the normal lane
+  *this += std::chrono::steady_clock::now() - std::chrono::seconds(1), [&] { order.push_back(4); };
+
+  ASSERT_EQ(5, DispatchAllEvents()) << "Not all dispatchers were run";
+  std::vector<int> expected{0, 1, 2, 3, 4};
+  ASSERT_EQ(expected, order) << "Dispatchers were not run in priority order";
+}
+
+TEST_F(DispatchQueueTest, PriorityLaneCaps) {
+  SetDispatcherCap(2);
+  SetDispatcherCap(autowiring::DispatchPriority::High, 1);
+  ASSERT_TRUE(*this += [] {});
+  ASSERT_TRUE(*this += [] {});
+  ASSERT_FALSE(*this += [] {}) << "Normal lane accepted a dispatcher beyond its cap";
+
+  ASSERT_TRUE((*this += autowiring::DispatchPriority::High, [] {})) << "High lane refused a dispatcher because the normal lane was full";
+  ASSERT_FALSE((*this += autowiring::DispatchPriority::High, [] {})) << "High lane accepted a dispatcher beyond its cap";
+  ASSERT_EQ(2UL, GetDispatchQueueStats().nRejected) << "Refusals in all lanes should be counted";
+
+  Abort();
+  ASSERT_FALSE((*this += autowiring::DispatchPriority::High, [] {})) << "Aborted queue accepted a high-priority dispatcher";
+  ASSERT_FALSE((*this += autowiring::DispatchPriority::Low, [] {})) << "Aborted queue accepted a low-priority dispatcher";
+}
+
+TEST_F(DispatchQueueTest, PriorityStarvationProtection) {
+  size_t nLowRun = 0;
+  size_t nHighRun = 0;
+  *this += autowiring::DispatchPriority::Low, [&] { nLowRun++; };
+  for (size_t i = 0; i < 2 * c_maxBypass; i++)
+    *this += autowiring::DispatchPriority::High, [&] { nHighRun++; };
+
+  for (size_t i = 0; i <= c_maxBypass; i++)
+    ASSERT_TRUE(DispatchEvent());
+  ASSERT_EQ(1UL, nLowRun) << "Low-priority dispatcher was starved by a stream of high-priority dispatchers";
+  ASSERT_EQ(c_maxBypass, nHighRun) << "Low-priority dispatcher was run before it had been passed over";
+
+  DispatchAllEvents();
+  ASSERT_EQ(2 * c_maxBypass, nHighRun) << "Not all high-priority dispatchers were run";
+
+  // The retry path must put a failed dispatcher back at the front of its own lane
+  bool thrown = false;
+  std::vector<int> order;
+  *this += [&] { order.push_back(1); };
+  *this += autowiring::DispatchPriority::High, [&] {
+    if (!thrown) {
+      thrown = true;
+      throw std::runtime_error("retry");
+    }
+    order.push_back(0);
+  };
+  ASSERT_ANY_THROW(TryDispatchEvent());
+  ASSERT_EQ(2, DispatchAllEvents());
+  std::vector<int> expected{0, 1};
+  ASSERT_EQ(expected, order) << "Retried dispatcher was not returned to the front of its lane";
+}
+
+TEST_F(DispatchQueueTest, BudgetedDrain) {
+  for (size_t i = 0; i < 10; i++)
+    *this += [] {};
+
+  ASSERT_EQ(4, DispatchAllEvents(4, std::chrono::nanoseconds::max())) << "Event budget was not honored";
+  ASSERT_EQ(1UL, GetDispatchQueueStats().nBudgetExhausted) << "Exhausted budget was not counted";
+
+  // A drain that is already past its deadline starts nothing
+  ASSERT_EQ(0, DispatchAllEvents(100, std::chrono::nanoseconds(0))) << "Time budget was not honored";
+  ASSERT_EQ(2UL, GetDispatchQueueStats().nBudgetExhausted) << "Exhausted time budget was not counted";
+
+  ASSERT_EQ(6, DispatchAllEvents(6, std::chrono::seconds(5))) << "Remaining events were not dispatched";
+  ASSERT_EQ(2UL, GetDispatchQueueStats().nBudgetExhausted) << "A drain that emptied the queue should not count as exhausted";
+}
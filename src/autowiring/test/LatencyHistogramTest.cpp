@@ -0,0 +1,61 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include <autowiring/latency_histogram.h>
+#include THREAD_HEADER
+
+using namespace autowiring;
+
+class LatencyHistogramTest:
+  public testing::Test
+{};
+
+TEST_F(LatencyHistogramTest, BucketBounds) {
+  for (uint64_t value = 0; value < (1ULL << 42); value = value * 3 / 2 + 1) {
+    size_t index = latency_histogram::bucket_index(value);
+    ASSERT_LT(index, latency_histogram::bucket_count) << "Value " << value << " was assigned to a nonexistent bucket";
+    ASSERT_LE(value, latency_histogram::bucket_upper_bound(index)) << "Value " << value << " exceeds its bucket's upper bound";
+    if (index)
+      ASSERT_LT(latency_histogram::bucket_upper_bound(index - 1), value) << "Value " << value << " belongs in an earlier bucket";
+
+    // Precision guarantee of the histogram
+    ASSERT_LE(latency_histogram::bucket_upper_bound(index) - value, value / latency_histogram::sub_buckets) << "Bucket for value " << value << " is too wide";
+  }
+}
+
+TEST_F(LatencyHistogramTest, Percentiles) {
+  latency_histogram histogram;
+  for (int i = 1; i <= 1000; i++)
+    histogram.record(std::chrono::microseconds(i));
+
+  auto snapshot = histogram.snapshot();
+  ASSERT_EQ(1000UL, snapshot.count) << "Sample count was incorrect";
+  ASSERT_EQ(1000000UL, snapshot.max) << "Maximum sample was incorrect";
+  ASSERT_EQ(std::chrono::nanoseconds(500500), snapshot.mean()) << "Mean was incorrect";
+
+  auto within = [](std::chrono::nanoseconds actual, std::chrono::microseconds expected) {
+    return expected <= actual && actual <= expected + expected / latency_histogram::sub_buckets;
+  };
+  ASSERT_TRUE(within(snapshot.p50(), std::chrono::microseconds(500))) << "Median was " << snapshot.p50().count() << "ns";
+  ASSERT_TRUE(within(snapshot.p99(), std::chrono::microseconds(990))) << "p99 was " << snapshot.p99().count() << "ns";
+  ASSERT_TRUE(within(snapshot.p999(), std::chrono::microseconds(999))) << "p999 was " << snapshot.p999().count() << "ns";
+
+  histogram.reset();
+  ASSERT_EQ(0UL, histogram.snapshot().count) << "Reset did not discard samples";
+}
+
+TEST_F(LatencyHistogramTest, ConcurrentRecord) {
+  latency_histogram histogram;
+  const size_t nThreads = 8;
+  const size_t nSamples = 10000;
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < nThreads; i++)
+    threads.emplace_back([&histogram, i] {
+      for (size_t j = 0; j < nSamples; j++)
+        histogram.record(std::chrono::nanoseconds(i * 100 + j % 100));
+    });
+  for (auto& thread : threads)
+    thread.join();
+
+  ASSERT_EQ(nThreads * nSamples, histogram.snapshot().count) << "Samples were lost during concurrent recording";
+}
@@ -1,11 +1,41 @@
 // Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
 #include "stdafx.h"
 #include <autowiring/marshaller.h>
+#include <cmath>
+#include <cstring>
 
 class MarshallerTest:
   public testing::Test
 {};
 
+namespace {
+  // Significant digits of a formatted number, without sign, decimal point, exponent, or leading and trailing zeroes
+  std::string SignificantDigits(const char* sz) {
+    std::string retVal;
+    for (; *sz && *sz != 'e'; sz++)
+      if ('0' <= *sz && *sz <= '9' && (*sz != '0' || !retVal.empty()))
+        retVal.push_back(*sz);
+    while (!retVal.empty() && retVal.back() == '0')
+      retVal.pop_back();
+    return retVal;
+  }
+
+  double ReadBack(const char* sz, double) { return strtod(sz, nullptr); }
+  float ReadBack(const char* sz, float) { return strtof(sz, nullptr); }
+
+  // Significant digits of the shortest representation of a value that reads back exactly, found by brute force
+  template<typename T>
+  std::string ShortestDigits(T value) {
+    char sz[64];
+    for (int precision = 1;; precision++) {
+      snprintf(sz, sizeof(sz), "%.*e", precision - 1, static_cast<double>(value));
+      if (precision == std::numeric_limits<T>::max_digits10 || ReadBack(sz, value) == value)
+        break;
+    }
+    return SignificantDigits(sz);
+  }
+}
+
 TEST_F(MarshallerTest, DoubleMarshalTest) {
   autowiring::marshaller<double> b;
 
@@ -48,4 +78,154 @@ TEST_F(MarshallerTest, RoundTripTest) {
   b.unmarshal(&outX, valX.c_str());
 
   ASSERT_EQ(outX, x);
-}
\ No newline at end of file
+}
+
+TEST_F(MarshallerTest, IntegerLimits) {
+  autowiring::marshaller<int64_t> b;
+
+  int64_t x = std::numeric_limits<int64_t>::min();
+  ASSERT_STREQ("-9223372036854775808", b.marshal(&x).c_str());
+  x = std::numeric_limits<int64_t>::max();
+  ASSERT_STREQ("9223372036854775807", b.marshal(&x).c_str());
+
+  int64_t y;
+  b.unmarshal(&y, "-9223372036854775808");
+  ASSERT_EQ(std::numeric_limits<int64_t>::min(), y) << "Minimum value did not round trip";
+  ASSERT_THROW(b.unmarshal(&y, "9223372036854775808"), std::range_error) << "Overflow not detected";
+  ASSERT_THROW(b.unmarshal(&y, "99999999999999999999999"), std::range_error) << "Overflow of 64 bits not detected";
+
+  autowiring::marshaller<uint8_t> c;
+  uint8_t z;
+  c.unmarshal(&z, "255");
+  ASSERT_EQ(255, z);
+  ASSERT_THROW(c.unmarshal(&z, "256"), std::range_error) << "Narrow type overflow not detected";
+}
+
+TEST_F(MarshallerTest, IntegerParseErrors) {
+  autowiring::marshaller<int> b;
+  int x = 0;
+  ASSERT_THROW(b.unmarshal(&x, ""), std::invalid_argument) << "Empty string accepted as an integer";
+  ASSERT_THROW(b.unmarshal(&x, "-"), std::invalid_argument) << "Lone sign accepted as an integer";
+  ASSERT_THROW(b.unmarshal(&x, "12abc"), std::invalid_argument) << "Trailing characters not detected";
+  ASSERT_EQ(0, x) << "Value was modified by a failed parse";
+
+  b.unmarshal(&x, " \t42");
+  ASSERT_EQ(42, x) << "Leading whitespace was not skipped";
+
+  const char text[] = "1234,5";
+  int y;
+  auto result = autowiring::parse_integer(text, text + sizeof(text) - 1, y);
+  ASSERT_EQ(std::errc{}, result.ec);
+  ASSERT_EQ(text + 4, result.ptr) << "Parse did not stop at the first non-digit character";
+  ASSERT_EQ(1234, y);
+}
+
+TEST_F(MarshallerTest, FloatShortestRoundTrip) {
+  autowiring::marshaller<double> b;
+  autowiring::marshaller<float> f;
+
+  // Shortest representations, rather than the 17 digits needed in general
+  double x = 0.1;
+  ASSERT_STREQ("0.1", b.marshal(&x).c_str());
+  x = 1e22;
+  ASSERT_STREQ("1e+22", b.marshal(&x).c_str());
+  x = 5e-324;
+  ASSERT_STREQ("5e-324", b.marshal(&x).c_str());
+  x = 123456789012345680000.0;
+  ASSERT_STREQ("123456789012345680000", b.marshal(&x).c_str());
+  x = 0.000001;
+  ASSERT_STREQ("0.000001", b.marshal(&x).c_str());
+  x = 0.0000001;
+  ASSERT_STREQ("1e-7", b.marshal(&x).c_str());
+  x = -std::numeric_limits<double>::infinity();
+  ASSERT_STREQ("-inf", b.marshal(&x).c_str());
+
+  float y = 0.3f;
+  ASSERT_STREQ("0.3", f.marshal(&y).c_str());
+  y = std::numeric_limits<float>::max();
+  ASSERT_STREQ("3.4028235e+38", f.marshal(&y).c_str());
+
+  // Pseudorandom bit patterns must survive a round trip exactly
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < 100000; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    double d;
+    memcpy(&d, &state, sizeof(d));
+    if (std::isnan(d))
+      continue;
+    double dOut;
+    b.unmarshal(&dOut, b.marshal(&d).c_str());
+    ASSERT_EQ(0, memcmp(&d, &dOut, sizeof(d))) << "Double " << b.marshal(&d) << " did not round trip";
+
+    float s;
+    uint32_t bits = static_cast<uint32_t>(state >> 32);
+    memcpy(&s, &bits, sizeof(s));
+    if (std::isnan(s))
+      continue;
+    float sOut;
+    f.unmarshal(&sOut, f.marshal(&s).c_str());
+    ASSERT_EQ(0, memcmp(&s, &sOut, sizeof(s))) << "Float " << f.marshal(&s) << " did not round trip";
+  }
+}
+
+TEST_F(MarshallerTest, FloatIsShortest) {
+  autowiring::marshaller<double> b;
+  autowiring::marshaller<float> f;
+
+  uint64_t state = 0x2545F4914F6CDD1DULL;
+  for (size_t i = 0; i < 10000; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    double d;
+    memcpy(&d, &state, sizeof(d));
+    if (std::isfinite(d) && d != 0)
+      ASSERT_EQ(ShortestDigits(d), SignificantDigits(b.marshal(&d).c_str())) << "Double " << b.marshal(&d) << " is not the shortest representation";
+
+    float s;
+    uint32_t bits = static_cast<uint32_t>(state >> 32);
+    memcpy(&s, &bits, sizeof(s));
+    if (std::isfinite(s) && s != 0)
+      ASSERT_EQ(ShortestDigits(s), SignificantDigits(f.marshal(&s).c_str())) << "Float " << f.marshal(&s) << " is not the shortest representation";
+  }
+}
+
+TEST_F(MarshallerTest, LongDoubleRoundTrip) {
+  autowiring::marshaller<long double> b;
+
+  long double x = 0.1L;
+  ASSERT_STREQ("0.1", b.marshal(&x).c_str());
+
+  // Not representable as a double where long double has extended precision
+  x = 1.0L + std::numeric_limits<long double>::epsilon();
+  long double y;
+  b.unmarshal(&y, b.marshal(&x).c_str());
+  ASSERT_EQ(x, y) << "Long double " << b.marshal(&x) << " did not round trip";
+
+  x = -std::numeric_limits<long double>::max();
+  b.unmarshal(&y, b.marshal(&x).c_str());
+  ASSERT_EQ(x, y) << "Long double " << b.marshal(&x) << " did not round trip";
+}
+
+TEST_F(MarshallerTest, FloatParse) {
+  autowiring::marshaller<double> b;
+
+  double x;
+  b.unmarshal(&x, "1.5e3");
+  ASSERT_DOUBLE_EQ(1500.0, x);
+  b.unmarshal(&x, "-.25");
+  ASSERT_DOUBLE_EQ(-0.25, x);
+  b.unmarshal(&x, "3.14159265358979323846264338327950288");
+  ASSERT_EQ(3.141592653589793, x) << "Long significand not correctly rounded";
+  b.unmarshal(&x, "inf");
+  ASSERT_TRUE(std::isinf(x));
+
+  ASSERT_THROW(b.unmarshal(&x, "1e400"), std::range_error) << "Overflow not detected";
+  ASSERT_THROW(b.unmarshal(&x, "1.2.3"), std::invalid_argument) << "Malformed number accepted";
+  ASSERT_THROW(b.unmarshal(&x, "abc"), std::invalid_argument) << "Non-number accepted";
+  ASSERT_THROW(b.unmarshal(&x, ""), std::invalid_argument) << "Empty string accepted";
+}
@@ -90,3 +90,178 @@ TEST_F(ParallelTest, Barrier) {
   p.barrier();
   ASSERT_EQ(1000, x) << "Not all parallel watchers were completed on return from join";
 }
+
+TEST_F(ParallelTest, ParallelFor) {
+  autowiring::parallel p;
+
+  std::vector<std::atomic<int>> visited(10007);
+  for (auto& cur : visited)
+    cur = 0;
+
+  p.parallel_for(0, visited.size(), 16, [&](size_t i) { visited[i]++; });
+  for (size_t i = 0; i < visited.size(); i++)
+    ASSERT_EQ(1, visited[i]) << "Index " << i << " was not visited exactly once";
+}
+
+TEST_F(ParallelTest, ParallelForEmptyRange) {
+  autowiring::parallel p;
+
+  bool called = false;
+  p.parallel_for(5, 5, 1, [&](size_t) { called = true; });
+  ASSERT_FALSE(called) << "Function was invoked on an empty range";
+}
+
+TEST_F(ParallelTest, ParallelReduce) {
+  autowiring::parallel p;
+
+  uint64_t sum = p.parallel_reduce(
+    1, 100001, 64,
+    uint64_t(0),
+    [](uint64_t& partial, size_t i) { partial += i; },
+    [](uint64_t lhs, uint64_t rhs) { return lhs + rhs; }
+  );
+  ASSERT_EQ(5000050000ULL, sum) << "Parallel reduction produced an incorrect sum";
+}
+
+TEST_F(ParallelTest, ParallelForException) {
+  autowiring::parallel p;
+
+  ASSERT_THROW(
+    p.parallel_for(0, 1000, 1, [](size_t i) {
+      if (i == 500)
+        throw std::runtime_error("Chunk failure");
+    }),
+    std::runtime_error
+  ) << "Exception thrown by a chunk was not rethrown to the caller";
+}
+
+TEST_F(ParallelTest, OrderedStream) {
+  autowiring::parallel p;
+  auto stream = p.ordered<int>(4);
+
+  std::mt19937_64 mt(time(nullptr));
+  std::uniform_int_distribution<int> dist(0, 200);
+
+  // Interleave submission and consumption so that the stream is kept full
+  std::vector<int> result;
+  for (int i = 0; i < 100; i++) {
+    if (stream.size() == stream.depth())
+      result.push_back(stream.pop());
+
+    int sleepTime = dist(mt);
+    stream += [i, sleepTime] {
+      std::this_thread::sleep_for(sleepTime * std::chrono::microseconds(1));
+      return i;
+    };
+    ASSERT_LE(stream.size(), stream.depth()) << "Ordered stream exceeded its in-flight depth";
+  }
+  while (!stream.empty())
+    result.push_back(stream.pop());
+
+  ASSERT_EQ(100UL, result.size()) << "Didn't receive all values";
+  for (int i = 0; i < static_cast<int>(result.size()); i++)
+    ASSERT_EQ(i, result[i]) << "Results were not delivered in submission order";
+}
+
+TEST_F(ParallelTest, OrderedStreamBackpressure) {
+  autowiring::parallel p;
+  auto stream = p.ordered<int>(2);
+
+  stream += [] { return 1; };
+  stream += [] { return 2; };
+
+  // A third submission must block until the consumer makes room
+  std::atomic<bool> submitted{ false };
+  std::thread producer([&] {
+    stream += [] { return 3; };
+    submitted = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  bool blocked = !submitted;
+
+  // Make room and join the producer before asserting, so a failure cannot leave it joinable
+  int first = stream.pop();
+  producer.join();
+  ASSERT_TRUE(blocked) << "Submission did not block on a full stream";
+  ASSERT_EQ(1, first);
+  ASSERT_TRUE(submitted);
+  ASSERT_EQ(2, stream.pop());
+  ASSERT_EQ(3, stream.pop());
+  ASSERT_THROW(stream.pop(), std::out_of_range) << "Pop on an empty stream did not throw";
+}
+
+TEST_F(ParallelTest, OrderedStreamException) {
+  autowiring::parallel p;
+  auto stream = p.ordered<int>(4);
+
+  stream += [] { return 1; };
+  stream += []() -> int { throw std::runtime_error("Job failure"); };
+  stream += [] { return 3; };
+
+  ASSERT_EQ(1, stream.pop());
+  ASSERT_THROW(stream.pop(), std::runtime_error) << "Job exception was not rethrown in order";
+  ASSERT_EQ(3, stream.pop()) << "Stream did not recover after a failed job";
+}
+
+TEST_F(ParallelTest, Channel) {
+  autowiring::parallel p;
+  auto ch = p.channel<size_t>(16);
+
+  // Submit far more jobs than the channel can hold at once
+  std::vector<size_t> result;
+  for (size_t i = 0; i < 1000; i++) {
+    if (ch.size() == ch.capacity())
+      result.push_back(ch.pop());
+    ch += [i] { return i; };
+    ASSERT_LE(ch.size(), ch.capacity()) << "Channel exceeded its capacity";
+  }
+  while (!ch.empty())
+    result.push_back(ch.pop());
+
+  ASSERT_EQ(1000UL, result.size()) << "Didn't receive all values";
+  std::sort(result.begin(), result.end());
+  for (size_t i = 0; i < result.size(); i++)
+    ASSERT_EQ(i, result[i]) << "Didn't receive correct values";
+}
+
+TEST_F(ParallelTest, ChannelException) {
+  autowiring::parallel p;
+  auto ch = p.channel<int>(4);
+
+  ch += []() -> int { throw std::runtime_error("Job failure"); };
+  ASSERT_THROW(ch.pop(), std::runtime_error) << "Job exception was not delivered through the channel";
+  ASSERT_TRUE(ch.empty()) << "Failed job was not consumed";
+
+  ch += [] { return 2; };
+  ASSERT_EQ(2, ch.pop()) << "Channel did not recover after a failed job";
+}
+
+namespace {
+  // Throws when an armed instance is moved from, the moved-to instance is not armed
+  struct ThrowOnMove {
+    ThrowOnMove(int value, bool armed) : value(value), armed(armed) {}
+    ThrowOnMove(ThrowOnMove&& rhs) :
+      value(rhs.value),
+      armed(false)
+    {
+      if (rhs.armed)
+        throw std::runtime_error("Move failure");
+    }
+
+    int value;
+    bool armed;
+  };
+}
+
+TEST_F(ParallelTest, ChannelThrowingMove) {
+  autowiring::parallel p;
+  auto ch = p.channel<ThrowOnMove>(4);
+
+  ch += [] { return ThrowOnMove(1, true); };
+  ASSERT_THROW(ch.pop(), std::runtime_error) << "Exception thrown while storing a result was not delivered";
+  ASSERT_TRUE(ch.empty()) << "Slot that failed to store its result was not consumed";
+
+  ch += [] { return ThrowOnMove(2, false); };
+  ASSERT_EQ(2, ch.pop().value) << "Channel did not recover after a result failed to be stored";
+}
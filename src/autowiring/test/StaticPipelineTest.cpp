@@ -0,0 +1,93 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include <autowiring/autowiring.h>
+#include <autowiring/static_pipeline.h>
+#include <vector>
+
+using namespace autowiring;
+
+class StaticPipelineTest:
+  public testing::Test
+{};
+
+namespace {
+  struct Frame { int value = 0; };
+  struct Edges { int value = 0; };
+  struct Features { int value = 0; };
+  struct Histogram { int value = 0; };
+
+  // Declared ahead of the filter producing its input, so the pipeline must reorder it
+  class DetectsFeatures {
+  public:
+    std::vector<int>* calls = nullptr;
+
+    void AutoFilter(const Edges& edges, const Histogram& histogram, Features& features) {
+      if (calls)
+        calls->push_back(2);
+      features.value = edges.value + histogram.value;
+    }
+  };
+
+  class DetectsEdges {
+  public:
+    std::vector<int>* calls = nullptr;
+
+    void AutoFilter(const Frame& frame, Edges& edges) {
+      if (calls)
+        calls->push_back(1);
+      edges.value = frame.value * 10;
+    }
+  };
+
+  class ComputesHistogram {
+  public:
+    void AutoFilter(Frame frame, Histogram& histogram) {
+      histogram.value = frame.value;
+    }
+  };
+
+  typedef static_pipeline<DetectsFeatures, DetectsEdges, ComputesHistogram> t_visionPipeline;
+}
+
+static_assert(
+  std::is_same<t_visionPipeline::order, index_tuple<1, 2, 0>>::value,
+  "Static pipeline was not sorted in dependency order"
+);
+static_assert(
+  std::is_same<t_visionPipeline::decorations, std::tuple<Frame, Features, Edges, Histogram>>::value,
+  "Static pipeline decorations should list sources followed by products"
+);
+
+TEST_F(StaticPipelineTest, CallsInDependencyOrder) {
+  std::vector<int> calls;
+  t_visionPipeline pipeline;
+  pipeline.get<DetectsFeatures>().calls = &calls;
+  pipeline.get<DetectsEdges>().calls = &calls;
+
+  t_visionPipeline::decorations decorations;
+  t_visionPipeline::get<Frame>(decorations).value = 4;
+  pipeline.Call(decorations);
+
+  ASSERT_EQ((std::vector<int>{1, 2}), calls) << "Filters were not called in dependency order";
+  ASSERT_EQ(40, t_visionPipeline::get<Edges>(decorations).value) << "Edge decoration was not produced";
+  ASSERT_EQ(4, t_visionPipeline::get<Histogram>(decorations).value) << "By-value input was not delivered";
+  ASSERT_EQ(44, t_visionPipeline::get<Features>(decorations).value) << "Downstream filter did not observe upstream products";
+}
+
+TEST_F(StaticPipelineTest, InteroperatesWithPacket) {
+  AutoCurrentContext()->Initiate();
+  AutoRequired<AutoPacketFactory> factory;
+  AutoRequired<t_visionPipeline> pipeline;
+
+  // A dynamic filter consuming a product of the static pipeline
+  int observed = 0;
+  *factory += [&observed](const Features& features) { observed = features.value; };
+
+  auto packet = factory->NewPacket();
+  Frame frame;
+  frame.value = 2;
+  packet->Decorate(frame);
+
+  ASSERT_EQ(22, observed) << "Dynamic filter did not receive the product of the static pipeline";
+  ASSERT_EQ(20, packet->Get<Edges>().value) << "Intermediate product of the static pipeline was not decorated on the packet";
+}
@@ -3,8 +3,11 @@
 #include <autowiring/autowiring.h>
 #include <autowiring/ManualThreadPool.h>
 #include <autowiring/NullPool.h>
+#include <autowiring/StealingThreadPool.h>
 #include <autowiring/SystemThreadPoolStl.h>
 #include FUTURE_HEADER
+#include THREAD_HEADER
+#include <vector>
 
 #ifdef _MSC_VER
 #include <autowiring/SystemThreadPoolWinXP.hpp>
@@ -63,3 +66,82 @@ typedef ::testing::Types<
 > t_testTypes;
 
 INSTANTIATE_TYPED_TEST_CASE_P(My, ThreadPoolTest, t_testTypes);
+
+class StealingThreadPoolTest:
+  public testing::Test
+{
+public:
+  StealingThreadPoolTest(void) {
+    for (size_t i = 0; i < 4; i++) {
+      auto token = m_pool->PrepareJoin();
+      m_tokens.push_back(token);
+      m_threads.emplace_back([token] { token->pool->Join(token); });
+    }
+  }
+
+  ~StealingThreadPoolTest(void) {
+    for (auto& token : m_tokens)
+      token->Leave();
+    for (auto& thread : m_threads)
+      thread.join();
+  }
+
+  // Small rings, so that the overflow queue is exercised
+  std::shared_ptr<autowiring::StealingThreadPool> m_pool = std::make_shared<autowiring::StealingThreadPool>(4, 16);
+  std::vector<std::shared_ptr<autowiring::StealingThreadPoolToken>> m_tokens;
+  std::vector<std::thread> m_threads;
+};
+
+TEST_F(StealingThreadPoolTest, RunsAllWork) {
+  size_t cap = 1000;
+  auto ctr = std::make_shared<std::atomic<size_t>>(cap);
+  auto p = std::make_shared<std::promise<void>>();
+
+  for (size_t i = cap; i--;)
+    *m_pool += [=] {
+      if (!--*ctr)
+        p->set_value();
+    };
+
+  auto rs = p->get_future();
+  ASSERT_EQ(std::future_status::ready, rs.wait_for(std::chrono::seconds(5))) << "Stealing pool did not run all submitted work";
+}
+
+TEST_F(StealingThreadPoolTest, KeyedWorkIsOrdered) {
+  const size_t nKeys = 8;
+  const size_t nPerKey = 200;
+
+  // Each key's counter is only ever touched by that key's work, so no synchronization is needed
+  // if keyed work is serialized
+  auto seen = std::make_shared<std::vector<size_t>>(nKeys);
+  auto outOfOrder = std::make_shared<std::atomic<bool>>(false);
+  auto ctr = std::make_shared<std::atomic<size_t>>(nKeys * nPerKey);
+  auto p = std::make_shared<std::promise<void>>();
+
+  for (size_t i = 0; i < nPerKey; i++)
+    for (size_t key = 0; key < nKeys; key++)
+      m_pool->Submit(key, [=] {
+        if ((*seen)[key]++ != i)
+          *outOfOrder = true;
+        if (!--*ctr)
+          p->set_value();
+      });
+
+  auto rs = p->get_future();
+  ASSERT_EQ(std::future_status::ready, rs.wait_for(std::chrono::seconds(5))) << "Keyed work did not complete in a timely fashion";
+  ASSERT_FALSE(*outOfOrder) << "Work submitted with the same key was run out of order";
+}
+
+TEST_F(StealingThreadPoolTest, WorkSubmittedBeforeJoinRuns) {
+  auto pool = std::make_shared<autowiring::StealingThreadPool>(2, 4);
+  auto p = std::make_shared<std::promise<void>>();
+  *pool += [p] { p->set_value(); };
+
+  auto token = pool->PrepareJoin();
+  std::thread t([token] { token->pool->Join(token); });
+  auto rs = p->get_future();
+  bool ran = rs.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+  token->Leave();
+  t.join();
+  ASSERT_TRUE(ran) << "Work submitted before any thread joined the pool was not run";
+}
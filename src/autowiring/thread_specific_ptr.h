@@ -18,6 +18,14 @@ namespace autowiring {
 }
 #endif
 
+// Values are kept in a thread_local table where the compiler implements thread_local with direct TLS
+// access.  Elsewhere, thread_local may be emulated and is no faster than the platform's keys.
+#if !defined(_MSC_VER) && !defined(__APPLE__) && !defined(__ANDROID__)
+  #define AUTOWIRING_THREAD_LOCAL_SLOTS 1
+#else
+  #define AUTOWIRING_THREAD_LOCAL_SLOTS 0
+#endif
+
 namespace autowiring {
 
 class thread_specific_ptr_base {
@@ -30,18 +38,49 @@ protected:
     freeTLS();
   }
 
-  // Key to thread local storage
+  // Key to thread local storage, used if this instance has no slot
   TLS_KEY_TYPE m_key;
 
   // Cleanup routine for the entry in the key
   const t_cleanupFunction m_cleanupFunction;
 
-  // Gets teh assigned value
-  void* get(void) const;
+#if AUTOWIRING_THREAD_LOCAL_SLOTS
+public:
+  // Number of instances that can be given a slot.  Slots are not reused, instances created after
+  // these are exhausted fall back to platform keys.
+  static const int c_nSlots = 64;
+
+  // Invokes the cleanup routine for each value held by the exiting thread
+  static void cleanupSlots(void*);
+
+protected:
+  // Index of this instance's entry in the slot table, or -1 if it uses a platform key
+  int m_slot = -1;
+
+  // The calling thread's slot table.  This is zero-initialized and has no destructor, so accessing it
+  // requires no guard.  Cleanup at thread exit is arranged separately, see cleanupSlots.
+  static void** slots(void) {
+    static thread_local void* s_slots[c_nSlots];
+    return s_slots;
+  }
+#endif
+
+  // Gets the assigned value
+  void* get(void) const {
+#if AUTOWIRING_THREAD_LOCAL_SLOTS
+    if (m_slot >= 0)
+      return slots()[m_slot];
+#endif
+    return getKey();
+  }
 
   // Set thread specific value. Used by public facing "release" and "reset"
   void set(void* value);
 
+  // Accessors for the platform key
+  void* getKey(void) const;
+  void setKey(void* value);
+
   // Initialize thread specific storage
   void init();
 
@@ -52,6 +91,10 @@ protected:
 /// <summary>
 /// Holds a ptr in thread local storage. Same interface as autoboost::thread_specific_ptr
 /// </summary>
+/// <remarks>
+/// As with the platform's keys, the cleanup function is called with a thread's value when that thread
+/// exits, and values still held by other threads are not cleaned up when the instance is destroyed.
+/// </remarks>
 template<typename T>
 class thread_specific_ptr final :
   thread_specific_ptr_base
@@ -1,22 +1,98 @@
 // Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
 #include "stdafx.h"
 #include "thread_specific_ptr.h"
+#include <atomic>
+#include <limits.h>
 
 namespace autowiring {
 
-void* thread_specific_ptr_base::get() const {
+#if AUTOWIRING_THREAD_LOCAL_SLOTS
+// Next slot to be assigned
+static std::atomic<int> s_nextSlot{0};
+
+// Cleanup routine for each slot, cleared when the instance owning the slot is destroyed
+static std::atomic<t_cleanupFunction> s_slotCleanup[thread_specific_ptr_base::c_nSlots];
+
+// True once the calling thread has arranged for cleanupSlots to be called when it exits
+static thread_local bool t_exitRegistered = false;
+
+// A key whose destructor runs cleanupSlots.  Key destructors run at the same point in thread exit as
+// they would if each instance had a key of its own.
+static pthread_key_t GetExitKey(void) {
+  static const pthread_key_t key = [] {
+    pthread_key_t retVal;
+    pthread_key_create(&retVal, &thread_specific_ptr_base::cleanupSlots);
+    return retVal;
+  }();
+  return key;
+}
+
+void thread_specific_ptr_base::cleanupSlots(void*) {
+  // Values set by cleanup routines must also be cleaned up; a later set will register us again
+  t_exitRegistered = false;
+
+  void** pSlots = slots();
+  for (int pass = 0; pass < PTHREAD_DESTRUCTOR_ITERATIONS; pass++) {
+    bool any = false;
+    for (int i = 0; i < c_nSlots; i++) {
+      void* value = pSlots[i];
+      if (!value)
+        continue;
+
+      pSlots[i] = nullptr;
+      if (t_cleanupFunction fn = s_slotCleanup[i].load(std::memory_order_acquire)) {
+        fn(value);
+        any = true;
+      }
+    }
+    if (!any)
+      break;
+  }
+}
+#endif
+
+void* thread_specific_ptr_base::getKey() const {
   return pthread_getspecific(m_key);
 }
 
-void thread_specific_ptr_base::set(void* value) {
+void thread_specific_ptr_base::setKey(void* value) {
   pthread_setspecific(m_key, value);
 }
 
+void thread_specific_ptr_base::set(void* value) {
+#if AUTOWIRING_THREAD_LOCAL_SLOTS
+  if (m_slot >= 0) {
+    slots()[m_slot] = value;
+    if (value && !t_exitRegistered) {
+      t_exitRegistered = true;
+      pthread_setspecific(GetExitKey(), slots());
+    }
+    return;
+  }
+#endif
+  setKey(value);
+}
+
 void thread_specific_ptr_base::init() {
+#if AUTOWIRING_THREAD_LOCAL_SLOTS
+  int slot = s_nextSlot++;
+  if (slot < c_nSlots) {
+    s_slotCleanup[slot].store(m_cleanupFunction, std::memory_order_release);
+    m_slot = slot;
+    return;
+  }
+#endif
   pthread_key_create(&m_key, m_cleanupFunction);
 }
-  
+
 void thread_specific_ptr_base::freeTLS() {
+#if AUTOWIRING_THREAD_LOCAL_SLOTS
+  if (m_slot >= 0) {
+    // Values held by other threads are abandoned, as they would be by pthread_key_delete
+    s_slotCleanup[m_slot].store(nullptr, std::memory_order_release);
+    return;
+  }
+#endif
   pthread_key_delete(m_key);
 }
 
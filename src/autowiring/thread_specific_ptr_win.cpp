@@ -23,14 +23,18 @@ static const bool init = [] {
 
 namespace autowiring {
 
-void* thread_specific_ptr_base::get() const {
+void* thread_specific_ptr_base::getKey() const {
   return FlsGetValue(m_key);
 }
 
-void thread_specific_ptr_base::set(void* value) {
+void thread_specific_ptr_base::setKey(void* value) {
   FlsSetValue(m_key, value);
 }
 
+void thread_specific_ptr_base::set(void* value) {
+  setKey(value);
+}
+
 void thread_specific_ptr_base::init(void) {
   m_key = FlsAlloc(m_cleanupFunction);
   set(nullptr);
@@ -0,0 +1,74 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "timeshift_ring.h"
+
+using namespace autowiring;
+
+const uint64_t timeshift_ring::c_unused;
+
+void timeshift_ring::reserve(size_t capacity) {
+  if (capacity <= m_slots.size())
+    return;
+
+  // Entries must be moved to their positions under the new modulus.  Entries that have never been
+  // opened have a serial number that no packet will be assigned.
+  std::vector<std::shared_ptr<timeshift_entry>> slots(capacity);
+  for (auto& entry : m_slots)
+    if (entry->serial != c_unused)
+      slots[entry->serial % capacity] = std::move(entry);
+  for (auto& slot : slots)
+    if (!slot)
+      slot = std::make_shared<timeshift_entry>(auto_id{}, c_unused);
+  m_slots.swap(slots);
+}
+
+void timeshift_ring::shrink(size_t capacity) {
+  if (capacity >= m_slots.size())
+    return;
+  if (!capacity) {
+    m_slots.clear();
+    return;
+  }
+
+  // The most recent entries are those whose serial numbers are within capacity of the newest one
+  uint64_t newest = 0;
+  for (auto& entry : m_slots)
+    if (entry->serial != c_unused && entry->serial > newest)
+      newest = entry->serial;
+
+  std::vector<std::shared_ptr<timeshift_entry>> slots(capacity);
+  for (auto& entry : m_slots)
+    if (entry->serial != c_unused && entry->serial + capacity > newest)
+      slots[entry->serial % capacity] = std::move(entry);
+  for (auto& slot : slots)
+    if (!slot)
+      slot = std::make_shared<timeshift_entry>(auto_id{}, c_unused);
+  m_slots.swap(slots);
+}
+
+std::shared_ptr<timeshift_entry> timeshift_ring::open(auto_id id, uint64_t serial) {
+  auto& slot = m_slots[serial % m_slots.size()];
+  if (slot.use_count() != 1) {
+    // A packet still refers to the evicted entry, it must be left to that packet
+    slot = std::make_shared<timeshift_entry>(id, serial);
+    return slot;
+  }
+
+  // Only the ring refers to this entry, and only under the factory lock, so it may be reused.  The
+  // fence orders our writes after the accesses of the packet that released the entry.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  slot->id = id;
+  slot->serial = serial;
+  slot->complete = false;
+  slot->value = AnySharedPointer();
+  slot->waiters.clear();
+  return slot;
+}
+
+std::shared_ptr<timeshift_entry> timeshift_ring::find(uint64_t serial) const {
+  if (m_slots.empty())
+    return nullptr;
+
+  auto& slot = m_slots[serial % m_slots.size()];
+  return slot->serial == serial ? slot : nullptr;
+}
@@ -0,0 +1,109 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include "AnySharedPointer.h"
+#include "auto_id.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include MEMORY_HEADER
+#include MUTEX_HEADER
+
+class AutoPacket;
+
+namespace autowiring {
+
+/// <summary>
+/// The decoration of a single timeshifted type on a single packet, as seen by later packets
+/// </summary>
+/// <remarks>
+/// An entry is pending until its packet either decorates the type or is destroyed without doing
+/// so, at which point the entry is completed exactly once.  Packets that read the entry while it is
+/// pending register themselves as waiters and are decorated when the entry is completed.
+/// </remarks>
+struct timeshift_entry {
+  timeshift_entry(auto_id id, uint64_t serial) :
+    id(id),
+    serial(serial)
+  {}
+
+  // The decorated type, and the serial number of the packet that decorates it.  These change only
+  // when the ring reuses the entry, at which point no packet refers to it.
+  auto_id id;
+  uint64_t serial;
+
+  std::mutex lock;
+
+  // Set once the entry has been completed, value is empty if the type was never decorated
+  bool complete = false;
+  AnySharedPointer value;
+
+  // Packets waiting for this entry to complete, and the timeshift at which each one reads it
+  std::vector<std::pair<std::weak_ptr<AutoPacket>, int>> waiters;
+};
+
+/// <summary>
+/// A timeshifted decoration read by a packet from the entry of an earlier packet
+/// </summary>
+struct timeshift_read {
+  auto_id id;
+  int tshift;
+
+  // The entry being read, or nullptr if the earlier packet does not exist or is no longer retained
+  std::shared_ptr<timeshift_entry> entry;
+};
+
+/// <summary>
+/// The most recent timeshift entries of a single type, indexed by packet serial number
+/// </summary>
+/// <remarks>
+/// This type is not synchronized, the AutoPacketFactory guards it with its own lock.  Every slot
+/// holds an entry once the ring is reserved, and an entry is reused in place when its slot is
+/// opened again if no packet still refers to it.
+/// </remarks>
+class timeshift_ring {
+public:
+  timeshift_ring(void) = default;
+  timeshift_ring(const timeshift_ring&) = delete;
+  timeshift_ring(timeshift_ring&&) = default;
+
+private:
+  // Serial number of entries that have never been opened
+  static const uint64_t c_unused = ~uint64_t(0);
+
+  // Slots, indexed by serial number modulo the capacity of the ring
+  std::vector<std::shared_ptr<timeshift_entry>> m_slots;
+
+public:
+  /// <returns>The number of entries retained by this ring</returns>
+  size_t capacity(void) const { return m_slots.size(); }
+
+  /// <summary>
+  /// Increases the capacity of the ring, retaining all entries currently in it
+  /// </summary>
+  /// <remarks>
+  /// This method has no effect if capacity is less than or equal to the current capacity
+  /// </remarks>
+  void reserve(size_t capacity);
+
+  /// <summary>
+  /// Reduces the capacity of the ring, retaining the most recent entries that still fit
+  /// </summary>
+  /// <remarks>
+  /// This method has no effect if capacity is greater than or equal to the current capacity.  Packets
+  /// that refer to an entry which no longer fits continue to hold it.
+  /// </remarks>
+  void shrink(size_t capacity);
+
+  /// <summary>
+  /// Opens a pending entry for the specified serial number, evicting the oldest entry
+  /// </summary>
+  /// <remarks>
+  /// Serial numbers must be opened in increasing order
+  /// </remarks>
+  std::shared_ptr<timeshift_entry> open(auto_id id, uint64_t serial);
+
+  /// <returns>The entry for the specified serial number, or nullptr if it is not in the ring</returns>
+  std::shared_ptr<timeshift_entry> find(uint64_t serial) const;
+};
+
+}
@@ -0,0 +1,86 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "work_stealing.h"
+
+using namespace autowiring;
+
+bool stealable_range::pop_front(uint32_t& chunk) {
+  uint64_t bounds = m_bounds.load(std::memory_order_acquire);
+  do {
+    if (first(bounds) >= last(bounds))
+      return false;
+  } while (!m_bounds.compare_exchange_weak(bounds, pack(first(bounds) + 1, last(bounds)), std::memory_order_acq_rel));
+  chunk = first(bounds);
+  return true;
+}
+
+bool stealable_range::steal_from(stealable_range& victim, uint32_t& f, uint32_t& l) {
+  uint64_t bounds = victim.m_bounds.load(std::memory_order_acquire);
+  uint32_t mid;
+  do {
+    if (first(bounds) >= last(bounds))
+      return false;
+
+    // Take the back half, rounding up so that a single remaining chunk can be taken
+    mid = first(bounds) + (last(bounds) - first(bounds)) / 2;
+  } while (!victim.m_bounds.compare_exchange_weak(bounds, pack(first(bounds), mid), std::memory_order_acq_rel));
+  f = mid;
+  l = last(bounds);
+  return true;
+}
+
+work_stealing_job::work_stealing_job(size_t nWorkers, uint32_t nChunks) :
+  m_ranges(nWorkers),
+  m_remaining(nChunks)
+{
+  // Even initial division, the first few workers get one extra chunk each
+  uint32_t share = nChunks / (uint32_t)nWorkers;
+  uint32_t extra = nChunks % (uint32_t)nWorkers;
+  uint32_t first = 0;
+  for (size_t i = 0; i < nWorkers; i++) {
+    uint32_t last = first + share + (i < extra ? 1 : 0);
+    m_ranges[i].assign(first, last);
+    first = last;
+  }
+}
+
+bool work_stealing_job::next(size_t worker, uint32_t& chunk) {
+  stealable_range& mine = m_ranges[worker];
+  if (mine.pop_front(chunk))
+    return true;
+
+  // Our range is exhausted, look for a victim, starting with our neighbor so that thieves
+  // spread out rather than all converging on the same worker
+  for (size_t i = 1; i < m_ranges.size(); i++) {
+    uint32_t first, last;
+    if (!mine.steal_from(m_ranges[(worker + i) % m_ranges.size()], first, last))
+      continue;
+
+    // Keep the first stolen chunk for ourselves, expose the rest to other thieves
+    chunk = first;
+    mine.assign(first + 1, last);
+    return true;
+  }
+  return false;
+}
+
+void work_stealing_job::complete(void) {
+  if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    std::lock_guard<std::mutex> lk(m_lock);
+    m_done.notify_all();
+  }
+}
+
+void work_stealing_job::fail(std::exception_ptr ex) {
+  std::lock_guard<std::mutex> lk(m_lock);
+  if (!m_ex)
+    m_ex = ex;
+  m_cancelled = true;
+}
+
+void work_stealing_job::wait(void) {
+  std::unique_lock<std::mutex> lk(m_lock);
+  m_done.wait(lk, [this] { return !m_remaining.load(std::memory_order_acquire); });
+  if (m_ex)
+    std::rethrow_exception(m_ex);
+}
@@ -0,0 +1,129 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <vector>
+#include MUTEX_HEADER
+
+namespace autowiring {
+
+/// <summary>
+/// A contiguous range of chunk indices which is consumed from the front by its owner and split
+/// from the back by thieves
+/// </summary>
+/// <remarks>
+/// The beginning and end of the range are packed into a single 64-bit word so that both the owner
+/// and any thieves may update the range with a single compare-and-swap.  Ranges are therefore
+/// limited to 2^32 - 1 chunks.
+/// </remarks>
+class stealable_range {
+public:
+  stealable_range(void) = default;
+  stealable_range(const stealable_range&) = delete;
+
+private:
+  // Upper 32 bits are the first chunk, lower 32 bits are one past the last chunk
+  std::atomic<uint64_t> m_bounds{0};
+
+  // Padding, keeps the ranges of adjacent workers on separate cache lines
+  char m_pad[64 - sizeof(std::atomic<uint64_t>)];
+
+  static uint64_t pack(uint32_t first, uint32_t last) { return (uint64_t)first << 32 | last; }
+  static uint32_t first(uint64_t bounds) { return (uint32_t)(bounds >> 32); }
+  static uint32_t last(uint64_t bounds) { return (uint32_t)bounds; }
+
+public:
+  /// <summary>
+  /// Replaces the contents of this range.  Only the owner may call this method.
+  /// </summary>
+  void assign(uint32_t first, uint32_t last) { m_bounds.store(pack(first, last), std::memory_order_release); }
+
+  /// <summary>
+  /// Removes the first chunk from this range
+  /// </summary>
+  /// <returns>False if the range was empty</returns>
+  bool pop_front(uint32_t& chunk);
+
+  /// <summary>
+  /// Removes the back half of the victim's range, or its only chunk if it has just one
+  /// </summary>
+  /// <returns>False if the victim's range was empty</returns>
+  bool steal_from(stealable_range& victim, uint32_t& first, uint32_t& last);
+};
+
+/// <summary>
+/// Shared scheduling state for a single parallel_for or parallel_reduce invocation
+/// </summary>
+/// <remarks>
+/// The chunks of the job are initially divided evenly among the workers.  Each worker drains its
+/// own range from the front; once its range is exhausted it steals half of another worker's
+/// remaining range.  No lock is taken on the chunk pathway; the internal mutex is only used to
+/// wake the initiating thread when the final chunk has completed.
+/// </remarks>
+class work_stealing_job {
+public:
+  work_stealing_job(size_t nWorkers, uint32_t nChunks);
+  work_stealing_job(const work_stealing_job&) = delete;
+
+private:
+  // Ranges, one per worker
+  std::vector<stealable_range> m_ranges;
+
+  // Chunks not yet completed:
+  std::atomic<uint32_t> m_remaining;
+
+  // Set when a chunk has thrown, causes all subsequent chunks to be skipped
+  std::atomic<bool> m_cancelled{false};
+
+  // The first exception thrown by any chunk
+  std::exception_ptr m_ex;
+
+  // Used to wake the initiating thread when all chunks are done
+  std::mutex m_lock;
+  std::condition_variable m_done;
+
+public:
+  /// <returns>The number of workers this job was divided between</returns>
+  size_t size(void) const { return m_ranges.size(); }
+
+  /// <returns>True if a chunk has thrown an exception</returns>
+  bool cancelled(void) const { return m_cancelled.load(std::memory_order_relaxed); }
+
+  /// <summary>
+  /// Obtains the next chunk that the specified worker should process
+  /// </summary>
+  /// <returns>False if there is no more work for the worker to do</returns>
+  /// <remarks>
+  /// Every chunk returned by this method must be released with a call to complete
+  /// </remarks>
+  bool next(size_t worker, uint32_t& chunk);
+
+  /// <summary>
+  /// Marks a chunk obtained from next as having been completed
+  /// </summary>
+  void complete(void);
+
+  /// <summary>
+  /// Records an exception thrown while processing a chunk, and causes remaining chunks to be skipped
+  /// </summary>
+  void fail(std::exception_ptr ex);
+
+  /// <summary>
+  /// Blocks until all chunks are complete, rethrows the first exception generated by a chunk
+  /// </summary>
+  void wait(void);
+
+  /// <summary>
+  /// Drains the specified worker's share of the job, invoking (*pBody)(worker, chunk) for each chunk
+  /// </summary>
+  template<typename Body>
+  void run(size_t worker, Body* pBody) {
+    for (uint32_t chunk; next(worker, chunk); complete())
+      if (!cancelled())
+        try { (*pBody)(worker, chunk); }
+        catch (...) { fail(std::current_exception()); }
+  }
+};
+
+}
@@ -4,6 +4,7 @@
 #include "ContextSearchBm.h"
 #include "ContextTrackingBm.h"
 #include "DispatchQueueBm.h"
+#include "MarshallerBm.h"
 #include "ObjectPoolBm.h"
 #include "PrintableDuration.h"
 #include "PriorityBoost.h"
@@ -41,6 +42,7 @@ static std::map<std::string, Entry> sc_commands = {
   MakeUtilEntry("help", "Displays this information", &PrintUsage),
   MakeUtilEntry("all", "Runs all benchmarks", &All),
   MakeEntry("priority", "Thread priority boost behavior", &PriorityBoost::CanBoostPriority),
+  MakeEntry("jitter", "Wakeup jitter under each scheduling policy", &PriorityBoost::WakeupJitter),
   MakeEntry("search", "Autowiring context search cost", &ContextSearchBm::Search),
   MakeEntry("cache", "Autowiring cache behavior", &ContextSearchBm::Cache),
   MakeEntry("fast", "Autowired versus AutowiredFast", &ContextSearchBm::Fast),
@@ -48,6 +50,7 @@ static std::map<std::string, Entry> sc_commands = {
   MakeEntry("contextenum", "CoreContextEnumerator profiling", &ContextTrackingBm::ContextEnum),
   MakeEntry("contextmap", "ContextMap profiling", &ContextTrackingBm::ContextMap),
   MakeEntry("objpool", "Object pool behaviors", &ObjectPoolBm::Allocation),
+  MakeEntry("marshal", "Numeric marshaller throughput", &MarshallerBm::Numeric),
 };
 
 static Benchmark All(void) {
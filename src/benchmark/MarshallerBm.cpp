@@ -0,0 +1,106 @@
+// Copyright (C) 2012-2015 Leap Motion, Inc. All rights reserved.
+#include "stdafx.h"
+#include "MarshallerBm.h"
+#include "Benchmark.h"
+#include <autowiring/marshaller.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static const size_t n = 10000;
+
+// Values spanning many orders of magnitude, generated once so that all runs see the same inputs
+template<typename T>
+static const std::vector<T>& sample(void) {
+  static const std::vector<T> values = [] {
+    std::vector<T> retVal;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < n; i++) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      retVal.push_back(std::is_floating_point<T>::value ?
+        static_cast<T>(static_cast<double>(state >> 11) / (1ULL << (state % 53))) :
+        static_cast<T>(state >> (state % 64))
+      );
+    }
+    return retVal;
+  }();
+  return values;
+}
+
+template<typename T>
+static std::vector<std::string> sample_strings(void) {
+  autowiring::marshaller<T> m;
+  std::vector<std::string> retVal;
+  for (const T& value : sample<T>())
+    retVal.push_back(m.marshal(&value));
+  return retVal;
+}
+
+template<typename T>
+static void marshal(Stopwatch& sw) {
+  autowiring::marshaller<T> m;
+  size_t total = 0;
+  sw.Start();
+  for (const T& value : sample<T>())
+    total += m.marshal(&value).size();
+  sw.Stop(n);
+  (void)total;
+}
+
+template<typename T>
+static void unmarshal(Stopwatch& sw) {
+  autowiring::marshaller<T> m;
+  const std::vector<std::string> strings = sample_strings<T>();
+  T value;
+  sw.Start();
+  for (const std::string& str : strings)
+    m.unmarshal(&value, str.c_str());
+  sw.Stop(n);
+}
+
+static void snprintf_int64(Stopwatch& sw) {
+  char buf[32];
+  size_t total = 0;
+  sw.Start();
+  for (int64_t value : sample<int64_t>())
+    total += std::string(buf, snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(value))).size();
+  sw.Stop(n);
+  (void)total;
+}
+
+static void snprintf_double(Stopwatch& sw) {
+  char buf[32];
+  size_t total = 0;
+  sw.Start();
+  for (double value : sample<double>())
+    total += std::string(buf, snprintf(buf, sizeof(buf), "%.17g", value)).size();
+  sw.Stop(n);
+  (void)total;
+}
+
+static void strtod_double(Stopwatch& sw) {
+  const std::vector<std::string> strings = sample_strings<double>();
+  double total = 0;
+  sw.Start();
+  for (const std::string& str : strings)
+    total += strtod(str.c_str(), nullptr);
+  sw.Stop(n);
+  (void)total;
+}
+
+Benchmark MarshallerBm::Numeric(void) {
+  return {
+    { "int64 marshal", &marshal<int64_t> },
+    { "int64 snprintf", &snprintf_int64 },
+    { "int64 unmarshal", &unmarshal<int64_t> },
+    { "double marshal", &marshal<double> },
+    { "double snprintf %.17g", &snprintf_double },
+    { "double unmarshal", &unmarshal<double> },
+    { "double strtod", &strtod_double },
+    { "float marshal", &marshal<float> },
+    { "float unmarshal", &unmarshal<float> }
+  };
+}
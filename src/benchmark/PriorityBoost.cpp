@@ -3,6 +3,7 @@
 #include "PriorityBoost.h"
 #include "Benchmark.h"
 #include <autowiring/CoreThread.h>
+#include <algorithm>
 #include <stdexcept>
 #include <thread>
 
@@ -86,3 +87,81 @@ Benchmark PriorityBoost::CanBoostPriority(void) {
     {"High priority CPU time", std::chrono::nanoseconds{higher->val}},
   };
 }
+
+class MeasuresWakeupJitter:
+  public BasicThread
+{
+public:
+  MeasuresWakeupJitter(void) :
+    BasicThread("MeasuresWakeupJitter")
+  {}
+
+  std::chrono::nanoseconds mean{0};
+  std::chrono::nanoseconds worst{0};
+
+  void Run(void) override {
+    // Periodic wakeups, as a control loop would do.  Lateness of each wakeup is the jitter.
+    static const size_t n = 500;
+    const std::chrono::microseconds period{1000};
+
+    std::chrono::nanoseconds total{0};
+    auto next = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i++) {
+      next += period;
+      std::this_thread::sleep_until(next);
+
+      std::chrono::nanoseconds late = std::chrono::steady_clock::now() - next;
+      total += late;
+      worst = std::max(worst, late);
+    }
+    mean = total / n;
+  }
+};
+
+struct JitterCase {
+  SchedulingPolicy policy;
+  const char* meanName;
+  const char* worstName;
+  const char* fallbackName;
+};
+
+static void MeasureWakeupJitter(const JitterCase& jitterCase, std::vector<BenchmarkEntry>& entries) {
+  AutoCreateContext ctxt;
+  CurrentContextPusher pshr(ctxt);
+  AutoRequired<MeasuresWakeupJitter> jitter;
+
+  ThreadScheduling scheduling;
+  scheduling.policy = jitterCase.policy;
+  scheduling.realtimePriority = 50;
+  scheduling.runtime = std::chrono::microseconds(200);
+  scheduling.period = std::chrono::microseconds(1000);
+  scheduling.stackPrefault = 64 * 1024;
+  jitter->SetScheduling(scheduling);
+
+  ctxt->Initiate();
+  jitter->Wait();
+
+  if (jitter->GetEffectiveSchedulingPolicy() != jitterCase.policy) {
+    // Not permitted here, say so rather than report default-policy numbers under this policy's name
+    entries.push_back({jitterCase.fallbackName, std::chrono::nanoseconds{0}});
+    return;
+  }
+  entries.push_back({jitterCase.meanName, jitter->mean});
+  entries.push_back({jitterCase.worstName, jitter->worst});
+}
+
+Benchmark PriorityBoost::WakeupJitter(void) {
+  AutoCurrentContext()->Initiate();
+
+  static const JitterCase cases[] = {
+    {SchedulingPolicy::Default, "Default mean wakeup jitter", "Default worst wakeup jitter", "Default policy unavailable"},
+    {SchedulingPolicy::Fifo, "Fifo mean wakeup jitter", "Fifo worst wakeup jitter", "Fifo policy not permitted"},
+    {SchedulingPolicy::RoundRobin, "RoundRobin mean wakeup jitter", "RoundRobin worst wakeup jitter", "RoundRobin policy not permitted"},
+    {SchedulingPolicy::Deadline, "Deadline mean wakeup jitter", "Deadline worst wakeup jitter", "Deadline policy not permitted"},
+  };
+
+  Benchmark retVal{};
+  for (const auto& jitterCase : cases)
+    MeasureWakeupJitter(jitterCase, retVal.entries);
+  return retVal;
+}
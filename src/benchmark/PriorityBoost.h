@@ -6,4 +6,5 @@ struct Benchmark;
 class PriorityBoost {
 public:
   static Benchmark CanBoostPriority(void);
+  static Benchmark WakeupJitter(void);
 };